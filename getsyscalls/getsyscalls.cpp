@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -54,6 +56,77 @@ std::vector<SyscallInfo> readSyscalls(const std::string& filename)
     return syscalls;
 }
 
+// Hash used for the name to number lookup, must match SyscallNameHash in the header
+uint32_t nameHash(const std::string& name, uint32_t seed)
+{
+    uint32_t hash = 2166136261u ^ seed;
+    for (char c : name)
+    {
+        hash = (hash ^ (uint8_t)c) * 16777619u;
+    }
+    return hash;
+}
+
+// Function to build a perfect hash of the syscall names. Names are split into
+// buckets by their unseeded hash, then each bucket, largest first, gets the
+// first seed that puts all of its names in free slots.
+bool buildNameHash(const std::vector<SyscallInfo>& syscalls, std::vector<uint32_t>& seeds, std::vector<int>& slots)
+{
+    std::vector<std::vector<const SyscallInfo*>> buckets(seeds.size());
+    for (const auto& info : syscalls)
+    {
+        buckets[nameHash(info.name, 0) % buckets.size()].push_back(&info);
+    }
+
+    std::vector<size_t> order(buckets.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return buckets[a].size() > buckets[b].size(); });
+
+    std::fill(slots.begin(), slots.end(), -1);
+    for (size_t bucket : order)
+    {
+        if (buckets[bucket].empty())
+        {
+            continue;
+        }
+
+        bool placed = false;
+        for (uint32_t seed = 1; seed < 65536 && !placed; seed++)
+        {
+            std::vector<size_t> taken;
+            for (const SyscallInfo* info : buckets[bucket])
+            {
+                size_t slot = nameHash(info->name, seed) % slots.size();
+                if (slots[slot] != -1 || std::find(taken.begin(), taken.end(), slot) != taken.end())
+                {
+                    break;
+                }
+                taken.push_back(slot);
+            }
+
+            if (taken.size() == buckets[bucket].size())
+            {
+                for (size_t i = 0; i < taken.size(); i++)
+                {
+                    slots[taken[i]] = buckets[bucket][i]->number;
+                }
+                seeds[bucket] = seed;
+                placed = true;
+            }
+        }
+
+        if (!placed)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 // Function to write syscalls to a header file
 void writeSyscalls(const std::string& filename, const std::vector<SyscallInfo>& syscalls)
 {
@@ -62,6 +135,10 @@ void writeSyscalls(const std::string& filename, const std::vector<SyscallInfo>&
     outfile << "// AUTO GENERATED BY getsyscalls\n";
     outfile << "#ifndef SYSCALL_H\n";
     outfile << "#define SYSCALL_H\n\n";
+    outfile << "#include <cstdint>\n";
+    outfile << "#include <string>\n";
+    outfile << "#include <string_view>\n";
+    outfile << "#include <vector>\n\n";
     outfile << "struct SyscallInfo {\n";
     outfile << "    int number;\n";
     outfile << "    std::string category;\n";
@@ -76,6 +153,99 @@ void writeSyscalls(const std::string& filename, const std::vector<SyscallInfo>&
     }
     outfile << "};\n\n";
 
+    // names indexed by syscall number, so events only carry the number
+    int maxNumber = 0;
+    for (const auto& info : syscalls)
+    {
+        maxNumber = std::max(maxNumber, info.number);
+    }
+
+    std::vector<const SyscallInfo*> byNumber(maxNumber + 1, nullptr);
+    for (const auto& info : syscalls)
+    {
+        byNumber[info.number] = &info;
+    }
+
+    outfile << "constexpr int SYSCALL_NUMBER_COUNT = " << maxNumber + 1 << ";\n\n";
+    outfile << "constexpr const char* syscallNames[SYSCALL_NUMBER_COUNT] = {\n";
+    for (int number = 0; number <= maxNumber; number++)
+    {
+        if (byNumber[number] != nullptr)
+            outfile << "    \"" << byNumber[number]->name << "\",\n";
+        else
+            outfile << "    nullptr,\n";
+    }
+    outfile << "};\n\n";
+
+    // perfect hash of the names for the name to number lookup, with more
+    // slots than names so that a seed is found for every bucket quickly
+    size_t slotCount = 64;
+    while (slotCount < syscalls.size())
+    {
+        slotCount *= 2;
+    }
+
+    std::vector<uint32_t> seeds(slotCount / 4);
+    std::vector<int> slots(slotCount);
+    while (!buildNameHash(syscalls, seeds, slots))
+    {
+        seeds.resize(seeds.size() * 2);
+        slots.resize(slots.size() * 2);
+    }
+
+    outfile << "constexpr uint32_t SYSCALL_HASH_SEEDS = " << seeds.size() << ";\n\n";
+    outfile << "constexpr uint16_t syscallHashSeeds[SYSCALL_HASH_SEEDS] = {\n";
+    for (size_t i = 0; i < seeds.size(); i += 16)
+    {
+        outfile << "   ";
+        for (size_t j = i; j < i + 16 && j < seeds.size(); j++)
+        {
+            outfile << " " << seeds[j] << ",";
+        }
+        outfile << "\n";
+    }
+    outfile << "};\n\n";
+
+    outfile << "constexpr uint32_t SYSCALL_HASH_SLOTS = " << slots.size() << ";\n\n";
+    outfile << "constexpr int16_t syscallHashSlots[SYSCALL_HASH_SLOTS] = {\n";
+    for (size_t i = 0; i < slots.size(); i += 16)
+    {
+        outfile << "   ";
+        for (size_t j = i; j < i + 16 && j < slots.size(); j++)
+        {
+            outfile << " " << slots[j] << ",";
+        }
+        outfile << "\n";
+    }
+    outfile << "};\n\n";
+
+    outfile << "constexpr uint32_t SyscallNameHash(std::string_view name, uint32_t seed)\n";
+    outfile << "{\n";
+    outfile << "    uint32_t hash = 2166136261u ^ seed;\n";
+    outfile << "    for (char c : name)\n";
+    outfile << "    {\n";
+    outfile << "        hash = (hash ^ (uint8_t)c) * 16777619u;\n";
+    outfile << "    }\n";
+    outfile << "    return hash;\n";
+    outfile << "}\n\n";
+
+    outfile << "// Name of a syscall number, nullptr if there isn't one\n";
+    outfile << "constexpr const char* SyscallNameForNumber(int number)\n";
+    outfile << "{\n";
+    outfile << "    return number >= 0 && number < SYSCALL_NUMBER_COUNT ? syscallNames[number] : nullptr;\n";
+    outfile << "}\n\n";
+
+    outfile << "// Number of a syscall name, -1 if there isn't one\n";
+    outfile << "constexpr int SyscallNumberForName(std::string_view name)\n";
+    outfile << "{\n";
+    outfile << "    uint32_t seed = syscallHashSeeds[SyscallNameHash(name, 0) % SYSCALL_HASH_SEEDS];\n";
+    outfile << "    int number = syscallHashSlots[SyscallNameHash(name, seed) % SYSCALL_HASH_SLOTS];\n";
+    outfile << "    return number >= 0 && name == syscallNames[number] ? number : -1;\n";
+    outfile << "}\n\n";
+
+    outfile << "static_assert(SyscallNumberForName(\"" << syscalls.front().name << "\") == " << syscalls.front().number << ");\n";
+    outfile << "static_assert(SyscallNumberForName(\"" << syscalls.back().name << "\") == " << syscalls.back().number << ");\n\n";
+
     outfile << "#endif // SYSCALL_H\n";
 }
 
@@ -0,0 +1,183 @@
+/*
+    Procmon-for-Linux
+
+    Copyright (c) Microsoft Corporation
+
+    All rights reserved.
+
+    MIT License
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef BATCH_MERGE_H
+#define BATCH_MERGE_H
+
+#include "telemetry_record.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <vector>
+
+// Merges the batches of several decoders into timestamp order. Records
+// carry the time their syscall was entered but are decoded in the order
+// the syscalls returned, so neither a batch nor the batches of a decoder
+// are in timestamp order. Each batch is sorted once it is added and the
+// merge picks the oldest record of all of them. Along with its batches
+// each decoder hands over a watermark, the timestamp it has nothing older
+// than left to hand over. Only records below the lowest watermark are
+// merged, the rest are held back until every decoder caught up.
+class BatchMerge
+{
+  private:
+    // A batch and the order of its records by timestamp
+    struct Run
+    {
+        TelemetryBatch batch;
+        std::vector<uint32_t> order;
+
+        // position in order of the next record to merge
+        size_t next = 0;
+
+        uint64_t Timestamp() const { return batch[order[next]].timestamp; }
+        bool Done() const { return next >= order.size(); }
+    };
+
+    // next record of a run, for the heap picking the oldest one
+    struct Cursor
+    {
+        uint64_t timestamp;
+        size_t run;
+
+        bool operator>(const Cursor& other) const { return timestamp > other.timestamp; }
+    };
+
+    std::vector<uint64_t> watermarks;
+    std::vector<Run> runs;
+
+    // batches all records of which were merged
+    std::vector<TelemetryBatch> merged;
+
+    // orders of finished runs, kept so adding a batch doesn't allocate
+    std::vector<std::vector<uint32_t>> spareOrders;
+
+  public:
+    explicit BatchMerge(size_t inputCount) : watermarks(inputCount, 0) {}
+
+    // Records of the batch can be in any order
+    void Add(TelemetryBatch&& batch)
+    {
+        if (batch.Empty())
+        {
+            return;
+        }
+
+        Run run;
+        if (!spareOrders.empty())
+        {
+            run.order = std::move(spareOrders.back());
+            spareOrders.pop_back();
+        }
+
+        run.order.resize(batch.Size());
+        for (size_t i = 0; i < run.order.size(); i++)
+        {
+            run.order[i] = i;
+        }
+
+        // records with the same timestamp keep the order they were decoded in
+        std::stable_sort(run.order.begin(), run.order.end(),
+            [&batch](uint32_t a, uint32_t b) { return batch[a].timestamp < batch[b].timestamp; });
+
+        run.batch = std::move(batch);
+        runs.push_back(std::move(run));
+    }
+
+    // Watermarks only ever move forward
+    void Advance(size_t input, uint64_t watermark)
+    {
+        watermarks[input] = std::max(watermarks[input], watermark);
+    }
+
+    uint64_t Watermark() const
+    {
+        uint64_t watermark = UINT64_MAX;
+        for (auto input : watermarks)
+        {
+            watermark = std::min(watermark, input);
+        }
+
+        return watermark;
+    }
+
+    bool Empty() const
+    {
+        return runs.empty();
+    }
+
+    // Calls emit(batch, record) on the records below limit, oldest first.
+    // Returns the number of records merged.
+    template<typename F>
+    size_t Merge(uint64_t limit, F&& emit)
+    {
+        std::priority_queue<Cursor, std::vector<Cursor>, std::greater<Cursor>> heads;
+        for (size_t i = 0; i < runs.size(); i++)
+        {
+            heads.push({runs[i].Timestamp(), i});
+        }
+
+        size_t count = 0;
+        while (!heads.empty() && heads.top().timestamp < limit)
+        {
+            Cursor head = heads.top();
+            heads.pop();
+
+            Run& run = runs[head.run];
+            emit(run.batch, run.order[run.next]);
+            count++;
+
+            if (++run.next < run.order.size())
+            {
+                head.timestamp = run.Timestamp();
+                heads.push(head);
+            }
+        }
+
+        // runs finish in any order, hand back the batches of all that did
+        auto done = std::partition(runs.begin(), runs.end(), [](const Run& run) { return !run.Done(); });
+        for (auto run = done; run != runs.end(); ++run)
+        {
+            merged.push_back(std::move(run->batch));
+            spareOrders.push_back(std::move(run->order));
+        }
+        runs.erase(done, runs.end());
+
+        return count;
+    }
+
+    // Merges the records all inputs are past
+    template<typename F>
+    size_t MergeReady(F&& emit)
+    {
+        return Merge(Watermark(), std::forward<F>(emit));
+    }
+
+    // Hands back the batches merged so far, cleared, to be filled again
+    void TakeMerged(std::vector<TelemetryBatch>& free)
+    {
+        for (auto& batch : merged)
+        {
+            batch.Clear();
+            free.push_back(std::move(batch));
+        }
+        merged.clear();
+    }
+};
+
+#endif // BATCH_MERGE_H
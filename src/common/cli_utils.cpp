@@ -16,6 +16,12 @@
 
 #include "cli_utils.h"
 
+#include <errno.h>
+#include <map>
+#include <stdexcept>
+
+#define ERRNO_NAME(e) { #e, e }
+
 namespace CLIUtils
 {
     // An immediate exit with no cleanup/wind-down
@@ -34,12 +40,80 @@ namespace CLIUtils
         std::cout << "   OPTIONS" << std::endl;
         std::cout << "      -h/--help                Prints this help screen" << std::endl;
         std::cout << "      -p/--pids                Comma separated list of process ids to monitor" << std::endl;
+        std::cout << "      -F/--follow              Also monitor children forked by the monitored processes" << std::endl;
+        std::cout << "      --stack-ids              Deduplicate user stacks in the kernel and send only a stack id per event" << std::endl;
+        std::cout << "      --kernel-stacks          Also capture the kernel stack each system call blocked in" << std::endl;
+        std::cout << "      --summary                Only aggregate per process and syscall counts, errors and latencies in the kernel" << std::endl;
+        std::cout << "      --min-duration USEC      Only monitor system calls that take at least USEC microseconds" << std::endl;
+        std::cout << "      --errors-only            Only monitor system calls that fail" << std::endl;
+        std::cout << "      --errno LIST             Comma separated list of errno names or numbers to monitor, e.g. ENOENT,EACCES" << std::endl;
+        std::cout << "      --sample LIST            Comma separated list of SYSCALL=N to only monitor 1 in N calls, e.g. read=100" << std::endl;
+        std::cout << "      --rate-limit N           Events per second per CPU to send before falling back to sampling" << std::endl;
+        std::cout << "      --max-string BYTES       Capture string arguments such as paths up to BYTES in full, 0 for a short preview (default 4096)" << std::endl;
+        std::cout << "      --snaplen LIST           Comma separated list of read=BYTES or write=BYTES of data buffers to capture, e.g. read=64" << std::endl;
+        std::cout << "      --payload-budget BYTES   Bytes of data buffers per second per CPU to capture at most (default 1048576)" << std::endl;
+        std::cout << "      --decoders N             Threads decoding events, merged back in timestamp order (default 1)" << std::endl;
         std::cout << "      -e/--events              Comma separated list of system calls to monitor" << std::endl;
         std::cout << "      -c/--collect [FILEPATH]  Option to start Procmon in a headless mode" << std::endl;
+        std::cout << "      --control FILEPATH       Create a FIFO at FILEPATH to add or remove syscalls and pids at runtime in headless mode" << std::endl;
         std::cout << "      -f/--file FILEPATH       Open a Procmon trace file" << std::endl;
         std::cout << "      -l/--log FILEPATH        Log debug traces to file" << std::endl;
 
         if (shouldExit)
             FastExit();
     }
+
+    // Converts an errno name (e.g. ENOENT) or number to its value, -1 if unknown
+    int GetErrnoForName(const std::string& name)
+    {
+        static const std::map<std::string, int> errnoNames =
+        {
+            ERRNO_NAME(EPERM), ERRNO_NAME(ENOENT), ERRNO_NAME(ESRCH), ERRNO_NAME(EINTR),
+            ERRNO_NAME(EIO), ERRNO_NAME(ENXIO), ERRNO_NAME(E2BIG), ERRNO_NAME(ENOEXEC),
+            ERRNO_NAME(EBADF), ERRNO_NAME(ECHILD), ERRNO_NAME(EAGAIN), ERRNO_NAME(ENOMEM),
+            ERRNO_NAME(EACCES), ERRNO_NAME(EFAULT), ERRNO_NAME(EBUSY), ERRNO_NAME(EEXIST),
+            ERRNO_NAME(EXDEV), ERRNO_NAME(ENODEV), ERRNO_NAME(ENOTDIR), ERRNO_NAME(EISDIR),
+            ERRNO_NAME(EINVAL), ERRNO_NAME(ENFILE), ERRNO_NAME(EMFILE), ERRNO_NAME(ENOTTY),
+            ERRNO_NAME(ETXTBSY), ERRNO_NAME(EFBIG), ERRNO_NAME(ENOSPC), ERRNO_NAME(ESPIPE),
+            ERRNO_NAME(EROFS), ERRNO_NAME(EMLINK), ERRNO_NAME(EPIPE), ERRNO_NAME(ERANGE),
+            ERRNO_NAME(EDEADLK), ERRNO_NAME(ENAMETOOLONG), ERRNO_NAME(ENOSYS), ERRNO_NAME(ENOTEMPTY),
+            ERRNO_NAME(ELOOP), ERRNO_NAME(EWOULDBLOCK), ERRNO_NAME(ENODATA), ERRNO_NAME(ETIME),
+            ERRNO_NAME(EOVERFLOW), ERRNO_NAME(ENOTSOCK), ERRNO_NAME(EMSGSIZE), ERRNO_NAME(EOPNOTSUPP),
+            ERRNO_NAME(EADDRINUSE), ERRNO_NAME(EADDRNOTAVAIL), ERRNO_NAME(ENETDOWN), ERRNO_NAME(ENETUNREACH),
+            ERRNO_NAME(ECONNABORTED), ERRNO_NAME(ECONNRESET), ERRNO_NAME(ENOBUFS), ERRNO_NAME(EISCONN),
+            ERRNO_NAME(ENOTCONN), ERRNO_NAME(ETIMEDOUT), ERRNO_NAME(ECONNREFUSED), ERRNO_NAME(EHOSTUNREACH),
+            ERRNO_NAME(EALREADY), ERRNO_NAME(EINPROGRESS), ERRNO_NAME(ESTALE), ERRNO_NAME(EDQUOT),
+            ERRNO_NAME(ECANCELED), ERRNO_NAME(EOWNERDEAD)
+        };
+
+        auto it = errnoNames.find(name);
+        if (it != errnoNames.end())
+        {
+            return it->second;
+        }
+
+        try
+        {
+            size_t end = 0;
+            int error = std::stoi(name, &end, 10);
+            return end == name.size() ? error : -1;
+        }
+        catch(const std::exception& e)
+        {
+            return -1;
+        }
+    }
+
+    // Converts a number made of digits only, throws std::invalid_argument for
+    // anything else, e.g. a sign or a unit, and std::out_of_range if too large
+    unsigned long long ParseUnsigned(const std::string& value)
+    {
+        // std::stoull takes "-5" as a huge number and stops at "10ms" without saying so
+        if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos)
+        {
+            throw std::invalid_argument("\"" + value + "\" is not a number");
+        }
+
+        return std::stoull(value, nullptr, 10);
+    }
 }
\ No newline at end of file
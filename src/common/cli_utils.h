@@ -27,6 +27,13 @@ namespace CLIUtils
     // Prints usage string to terminal
     void DisplayUsage(bool shouldExit);
 
+    // Converts an errno name (e.g. ENOENT) or number to its value, -1 if unknown
+    int GetErrnoForName(const std::string& name);
+
+    // Converts a number made of digits only, throws std::invalid_argument for
+    // anything else, e.g. a sign or a unit, and std::out_of_range if too large
+    unsigned long long ParseUnsigned(const std::string& value);
+
     template <typename T>
     void ProtectArgNotNull(T& arg, std::string argName)
     {
@@ -0,0 +1,55 @@
+/*
+    Procmon-for-Linux
+
+    Copyright (c) Microsoft Corporation
+
+    All rights reserved.
+
+    MIT License
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef PROCESS_INFO_H
+#define PROCESS_INFO_H
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A process as it was when its events were traced, shared by all of them
+struct ProcessInfo
+{
+    pid_t pid = 0;
+    pid_t ppid = 0;
+    uint32_t uid = 0;
+
+    // monotonic time of the fork or last exec, 0 if the process was already
+    // running when tracing started. Tells recycled pids apart.
+    uint64_t startTime = 0;
+
+    std::string name;
+    std::string exe;
+    std::vector<std::string> argv;
+    std::string cgroup;
+
+    // argv joined with spaces, for display
+    std::string CommandLine() const
+    {
+        std::string commandLine;
+        for(size_t i = 0; i < argv.size(); i++)
+        {
+            if(i > 0) commandLine += " ";
+            commandLine += argv[i];
+        }
+        return commandLine;
+    }
+};
+
+#endif // PROCESS_INFO_H
@@ -0,0 +1,216 @@
+/*
+    Procmon-for-Linux
+
+    Copyright (c) Microsoft Corporation
+
+    All rights reserved.
+
+    MIT License
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+
+/// A bounded, lock-free, single-producer single-consumer ring of
+/// variable length records, preallocated up front. Records are written
+/// in place with reserve/commit and handed to the consumer in place by
+/// popBatch, so nothing is allocated or copied by the ring itself.
+/// The producer only signals the eventfd when the consumer is idle in
+/// wait, so a busy consumer costs the producer two atomic operations.
+class SpscRing
+{
+  private:
+    // Records start with this header, data follows 8 byte aligned
+    struct RecordHeader
+    {
+        uint32_t size;
+        uint32_t unused;
+    };
+
+    // Header size marking that the rest of the buffer is unused and the
+    // next record starts at the beginning
+    static constexpr uint32_t WRAP = UINT32_MAX;
+
+    std::unique_ptr<uint64_t[]> buffer;
+    uint64_t capacity;
+    uint64_t mask;
+
+    // Positions only ever grow, the offset in the buffer is position & mask
+    alignas(64) std::atomic<uint64_t> head = 0;
+    uint64_t pendingHead = 0;
+    alignas(64) std::atomic<uint64_t> tail = 0;
+
+    std::atomic<bool> consumerIdle = false;
+    std::atomic<bool> cancelled = false;
+    int wakeFd;
+
+    static uint64_t recordBytes(uint32_t size)
+    {
+        return sizeof(RecordHeader) + ((size + 7) & ~7ULL);
+    }
+
+    uint8_t* at(uint64_t position)
+    {
+        return reinterpret_cast<uint8_t*>(buffer.get()) + (position & mask);
+    }
+
+    void wake()
+    {
+        uint64_t one = 1;
+        ssize_t written = write(wakeFd, &one, sizeof(one));
+        (void)written;
+    }
+
+  public:
+    // capacity is rounded up to a power of 2 bytes
+    explicit SpscRing(uint64_t capacityBytes)
+    {
+        capacity = 64;
+        while (capacity < capacityBytes)
+        {
+            capacity <<= 1;
+        }
+        mask = capacity - 1;
+        buffer.reset(new uint64_t[capacity / sizeof(uint64_t)]);
+        wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    };
+
+    ~SpscRing()
+    {
+        close(wakeFd);
+    };
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    /// Producer: returns space for a record of size bytes, or nullptr if
+    /// the ring is full. The record is only visible once committed.
+    void* reserve(uint32_t size)
+    {
+        uint64_t total = recordBytes(size);
+        uint64_t position = head.load(std::memory_order_relaxed);
+        uint64_t free = capacity - (position - tail.load(std::memory_order_acquire));
+
+        // records never straddle the end of the buffer
+        uint64_t untilEnd = capacity - (position & mask);
+        uint64_t skip = untilEnd < total ? untilEnd : 0;
+        if (skip + total > free)
+        {
+            return nullptr;
+        }
+
+        if (skip > 0)
+        {
+            reinterpret_cast<RecordHeader*>(at(position))->size = WRAP;
+            position += skip;
+        }
+
+        reinterpret_cast<RecordHeader*>(at(position))->size = size;
+        pendingHead = position + total;
+
+        return at(position) + sizeof(RecordHeader);
+    };
+
+    /// Producer: publishes the record returned by the last reserve
+    void commit()
+    {
+        head.store(pendingHead, std::memory_order_release);
+
+        // pairs with the fence in wait so that either the consumer sees
+        // the record or the producer sees the consumer idle
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (consumerIdle.load(std::memory_order_relaxed))
+        {
+            wake();
+        }
+    };
+
+    /// Consumer: calls consume(data, size) on up to maxRecords records
+    /// in place, then hands their space back to the producer. Returns
+    /// the number of records consumed.
+    template<typename F>
+    size_t popBatch(F&& consume, size_t maxRecords)
+    {
+        uint64_t position = tail.load(std::memory_order_relaxed);
+        uint64_t end = head.load(std::memory_order_acquire);
+        size_t count = 0;
+
+        while (position != end && count < maxRecords)
+        {
+            uint32_t size = reinterpret_cast<RecordHeader*>(at(position))->size;
+            if (size == WRAP)
+            {
+                position += capacity - (position & mask);
+                continue;
+            }
+
+            consume(at(position) + sizeof(RecordHeader), size);
+            position += recordBytes(size);
+            count++;
+        }
+
+        tail.store(position, std::memory_order_release);
+        return count;
+    };
+
+    bool empty() const
+    {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_relaxed);
+    };
+
+    /// Consumer: blocks until there are records, the ring is cancelled
+    /// or timeoutMs passed. Returns true if there are records.
+    bool wait(int timeoutMs)
+    {
+        if (!empty())
+        {
+            return true;
+        }
+
+        consumerIdle.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        // the eventfd can still hold a wake up for records popped since,
+        // so keep waiting until there really is a record or time is up
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (empty() && !cancelled)
+        {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            struct pollfd pfd = {wakeFd, POLLIN, 0};
+            if (remaining <= 0 || poll(&pfd, 1, remaining) <= 0)
+            {
+                break;
+            }
+
+            uint64_t count;
+            ssize_t bytes = read(wakeFd, &count, sizeof(count));
+            (void)bytes;
+        }
+
+        consumerIdle.store(false, std::memory_order_relaxed);
+        return !empty();
+    };
+
+    bool isCancelled() const { return cancelled; };
+
+    void cancel()
+    {
+        cancelled = true;
+        wake();
+    };
+};
@@ -30,32 +30,57 @@ struct StackTrace
 
     StackTrace() {}
 
-    std::string Serialize()
+    // User frames, followed by '|' and the kernel frames when there are any
+    std::string Serialize() const
     {
         std::string ret;
 
-        if(userIPs.size() == 0)
+        if(userIPs.size() == 0 && kernelIPs.size() == 0)
         {
             return "";
         }
 
-        ret += std::to_string(userIPs[0]);
+        ret += SerializeIPs(userIPs);
 
-        for(int i = 1; i < userIPs.size(); i++)
+        if(kernelIPs.size() > 0)
         {
-            ret += ";" + std::to_string(userIPs[i]);
+            ret += "|" + SerializeIPs(kernelIPs);
         }
         return ret;
     }
 
     void Inflate(std::string blob)
+    {
+        std::string::size_type split = blob.find('|');
+
+        InflateIPs(blob.substr(0, split), userIPs);
+        if(split != std::string::npos)
+        {
+            InflateIPs(blob.substr(split + 1), kernelIPs);
+        }
+    }
+
+private:
+    static std::string SerializeIPs(const std::vector<uint64_t>& ips)
+    {
+        std::string ret;
+
+        for(int i = 0; i < ips.size(); i++)
+        {
+            if(i > 0) ret += ";";
+            ret += std::to_string(ips[i]);
+        }
+        return ret;
+    }
+
+    static void InflateIPs(const std::string& blob, std::vector<uint64_t>& ips)
     {
         std::string token;
         std::stringstream stream(blob);
 
         while(std::getline(stream, token, ';'))
         {
-            userIPs.push_back(std::stoull(token));
+            ips.push_back(std::stoull(token));
         }
     }
 
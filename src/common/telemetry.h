@@ -18,8 +18,13 @@
 #define TELEMETRY_BASE_H
 
 #include "stack_trace.h"
+#include "process_info.h"
 #include "string.h"
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #define MAX_BUFFER      128
 
 struct ITelemetry
@@ -28,12 +33,31 @@ struct ITelemetry
     StackTrace stackTrace;
     std::string comm;
     std::string processName;
-    std::string syscall;
+    // x86_64 syscall number, the name is looked up when displayed
+    int syscall;
     int64_t result;
     uint64_t duration;
-    unsigned char *arguments;
+    const unsigned char *arguments;
     uint64_t timestamp;
 
+    // number of calls this event stands for when the syscall was sampled
+    uint32_t sampleRate = 1;
+
+    // full length copies of the string arguments, in argument order
+    std::vector<std::string> strings;
+
+    // captured data buffer of read and write like syscalls
+    std::vector<uint8_t> payload;
+
+    // decoded socket address of network syscalls, e.g. 10.0.0.1:443
+    std::string address;
+
+    // process the event belongs to, stored once per process
+    std::shared_ptr<const ProcessInfo> process;
+
+    // owns arguments when they were allocated for this event, e.g. when read back from storage
+    std::shared_ptr<const unsigned char[]> argumentsBuffer;
+
     friend bool operator != (ITelemetry a, ITelemetry b)
     {
         if(a.pid != b.pid) return true;
@@ -43,6 +67,9 @@ struct ITelemetry
         if(a.result != b.result) return true;
         if(a.duration != b.duration) return true;
         if(strcmp((const char *)a.arguments, (const char *)b.arguments) != 0) return true;
+        if(a.strings != b.strings) return true;
+        if(a.payload != b.payload) return true;
+        if(a.address != b.address) return true;
         if(a.timestamp != b.timestamp) return true;
 
         return false;
@@ -0,0 +1,215 @@
+/*
+    Procmon-for-Linux
+
+    Copyright (c) Microsoft Corporation
+
+    All rights reserved.
+
+    MIT License
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef TELEMETRY_RECORD_H
+#define TELEMETRY_RECORD_H
+
+#include "telemetry.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Bytes of the arena of a TelemetryBatch
+struct ArenaSpan
+{
+    uint32_t offset;
+    uint32_t length;
+};
+
+#define NO_PROCESS      UINT32_MAX
+
+// A traced event as a fixed layout record. Its variable length parts are
+// kept in the arena of the batch holding it, so records can be copied
+// around as plain bytes and a batch only allocates while it grows.
+struct TelemetryRecord
+{
+    pid_t pid;
+    uint32_t sampleRate;
+    int64_t result;
+    uint64_t duration;
+    uint64_t timestamp;
+
+    // x86_64 syscall number
+    int32_t syscall;
+
+    // index of the process in the batch, NO_PROCESS if there is none
+    uint32_t process;
+
+    char comm[16];
+    unsigned char arguments[MAX_BUFFER];
+
+    // frames as uint64_t IPs
+    ArenaSpan userIPs;
+    ArenaSpan kernelIPs;
+
+    // NUL terminated string arguments, one after the other
+    ArenaSpan strings;
+
+    ArenaSpan payload;
+    ArenaSpan address;
+};
+
+static_assert(std::is_trivially_copyable<TelemetryRecord>::value, "TelemetryRecord must stay trivially copyable");
+
+// Records and the arena holding their variable length parts. Clearing a
+// batch keeps its memory, so a batch that is reused allocates nothing once
+// it grew to the size of the largest batch.
+class TelemetryBatch
+{
+  private:
+    std::vector<TelemetryRecord> records;
+    std::vector<uint8_t> arena;
+    std::vector<std::shared_ptr<const ProcessInfo>> processes;
+
+  public:
+    size_t Size() const { return records.size(); }
+    bool Empty() const { return records.empty(); }
+
+    void Reserve(size_t count, size_t arenaBytes)
+    {
+        records.reserve(count);
+        arena.reserve(arenaBytes);
+        processes.reserve(count);
+    }
+
+    void Clear()
+    {
+        records.clear();
+        arena.clear();
+        processes.clear();
+    }
+
+    TelemetryRecord& Add()
+    {
+        records.emplace_back();
+        return records.back();
+    }
+
+    const TelemetryRecord& operator[](size_t i) const { return records[i]; }
+
+    // Copies length bytes into the arena, 8 byte aligned so that frames can be read in place
+    ArenaSpan Append(const void* data, size_t length)
+    {
+        size_t offset = (arena.size() + 7) & ~(size_t)7;
+        arena.resize(offset + length);
+        if (length > 0)
+        {
+            memcpy(arena.data() + offset, data, length);
+        }
+
+        return {(uint32_t)offset, (uint32_t)length};
+    }
+
+    // Processes repeat from one event to the next, so they're only added when they change
+    uint32_t AddProcess(const std::shared_ptr<const ProcessInfo>& process)
+    {
+        if (process == nullptr)
+        {
+            return NO_PROCESS;
+        }
+
+        if (processes.empty() || processes.back() != process)
+        {
+            processes.push_back(process);
+        }
+
+        return processes.size() - 1;
+    }
+
+    // Copies record i of another batch, along with its variable length parts
+    void AddFrom(const TelemetryBatch& batch, size_t i)
+    {
+        const TelemetryRecord& from = batch.records[i];
+        TelemetryRecord& record = Add();
+        record = from;
+
+        record.userIPs = Append(batch.Data<uint8_t>(from.userIPs), from.userIPs.length);
+        record.kernelIPs = Append(batch.Data<uint8_t>(from.kernelIPs), from.kernelIPs.length);
+        record.strings = Append(batch.Data<uint8_t>(from.strings), from.strings.length);
+        record.payload = Append(batch.Data<uint8_t>(from.payload), from.payload.length);
+        record.address = Append(batch.Data<uint8_t>(from.address), from.address.length);
+        record.process = from.process != NO_PROCESS ? AddProcess(batch.processes[from.process]) : NO_PROCESS;
+    }
+
+    template<typename T>
+    const T* Data(ArenaSpan span) const
+    {
+        return reinterpret_cast<const T*>(arena.data() + span.offset);
+    }
+
+    // Fills in telemetry from record i, writing over the strings and
+    // vectors of telemetry so their storage is reused. The arguments
+    // point into the batch and are only valid until it is cleared.
+    void Read(size_t i, ITelemetry& telemetry) const
+    {
+        const TelemetryRecord& record = records[i];
+
+        telemetry.pid = record.pid;
+
+        const uint64_t* userIPs = Data<uint64_t>(record.userIPs);
+        telemetry.stackTrace.userIPs.assign(userIPs, userIPs + record.userIPs.length / sizeof(uint64_t));
+        const uint64_t* kernelIPs = Data<uint64_t>(record.kernelIPs);
+        telemetry.stackTrace.kernelIPs.assign(kernelIPs, kernelIPs + record.kernelIPs.length / sizeof(uint64_t));
+
+        telemetry.comm.assign(record.comm, strnlen(record.comm, sizeof(record.comm)));
+        if (record.process != NO_PROCESS)
+        {
+            telemetry.process = processes[record.process];
+            telemetry.processName = telemetry.process->name;
+        }
+        else
+        {
+            telemetry.process = nullptr;
+            telemetry.processName = telemetry.comm;
+        }
+
+        telemetry.syscall = record.syscall;
+        telemetry.result = record.result;
+        telemetry.duration = record.duration;
+        telemetry.arguments = record.arguments;
+        telemetry.timestamp = record.timestamp;
+        telemetry.sampleRate = record.sampleRate;
+
+        const char* strings = Data<char>(record.strings);
+        size_t stringOffset = 0;
+        size_t stringCount = 0;
+        while (stringOffset < record.strings.length)
+        {
+            size_t length = strnlen(strings + stringOffset, record.strings.length - stringOffset);
+            if (stringCount < telemetry.strings.size())
+            {
+                telemetry.strings[stringCount].assign(strings + stringOffset, length);
+            }
+            else
+            {
+                telemetry.strings.emplace_back(strings + stringOffset, length);
+            }
+            stringCount++;
+            stringOffset += length + 1;
+        }
+        telemetry.strings.resize(stringCount);
+
+        const uint8_t* payload = Data<uint8_t>(record.payload);
+        telemetry.payload.assign(payload, payload + record.payload.length);
+
+        telemetry.address.assign(Data<char>(record.address), record.address.length);
+    }
+};
+
+#endif // TELEMETRY_RECORD_H
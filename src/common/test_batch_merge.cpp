@@ -0,0 +1,247 @@
+/*
+    Procmon-for-Linux
+
+    Copyright (c) Microsoft Corporation
+
+    All rights reserved.
+
+    MIT License
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "batch_merge.h"
+
+// A batch with a record for each timestamp, the pid telling the inputs apart
+static TelemetryBatch MakeBatch(pid_t input, const std::vector<uint64_t>& timestamps)
+{
+    TelemetryBatch batch;
+    for (auto timestamp : timestamps)
+    {
+        TelemetryRecord& record = batch.Add();
+        record = {};
+        record.pid = input;
+        record.timestamp = timestamp;
+        record.process = NO_PROCESS;
+    }
+
+    return batch;
+}
+
+// Merges the records below limit and returns their timestamps
+static std::vector<uint64_t> MergeBelow(BatchMerge& merge, uint64_t limit)
+{
+    std::vector<uint64_t> timestamps;
+    merge.Merge(limit, [&](const TelemetryBatch& batch, size_t record) { timestamps.push_back(batch[record].timestamp); });
+    return timestamps;
+}
+
+TEST_CASE("batch merge holds back records until every input is past them", "[BatchMerge]") {
+
+    BatchMerge merge(2);
+    CHECK(merge.Empty());
+    CHECK(merge.Watermark() == 0);
+
+    merge.Add(MakeBatch(0, {1, 5, 9}));
+    merge.Advance(0, 9);
+    CHECK(MergeBelow(merge, merge.Watermark()).empty());
+
+    merge.Add(MakeBatch(1, {2, 3}));
+    merge.Advance(1, 3);
+    CHECK(merge.Watermark() == 3);
+    CHECK(MergeBelow(merge, merge.Watermark()) == std::vector<uint64_t>({1, 2}));
+
+    // watermarks don't move back
+    merge.Advance(0, 4);
+    CHECK(merge.Watermark() == 3);
+
+    // an idle input moves its watermark on without handing over records
+    merge.Advance(1, 100);
+    CHECK(merge.Watermark() == 9);
+    CHECK(MergeBelow(merge, merge.Watermark()) == std::vector<uint64_t>({3, 5}));
+    CHECK_FALSE(merge.Empty());
+
+    merge.Advance(0, 10);
+    CHECK(MergeBelow(merge, merge.Watermark()) == std::vector<uint64_t>({9}));
+    CHECK(merge.Empty());
+}
+
+TEST_CASE("batch merge hands back batches once all their records are merged", "[BatchMerge]") {
+
+    BatchMerge merge(1);
+    merge.Add(MakeBatch(0, {1, 2}));
+    merge.Add(MakeBatch(0, {3, 4}));
+    merge.Add(TelemetryBatch());
+
+    std::vector<TelemetryBatch> free;
+    CHECK(MergeBelow(merge, 4) == std::vector<uint64_t>({1, 2, 3}));
+    merge.TakeMerged(free);
+    REQUIRE(free.size() == 1);
+    CHECK(free[0].Empty());
+
+    CHECK(MergeBelow(merge, UINT64_MAX) == std::vector<uint64_t>({4}));
+    merge.TakeMerged(free);
+    CHECK(free.size() == 2);
+    CHECK(merge.Empty());
+}
+
+TEST_CASE("batch merge sorts records that were decoded out of order", "[BatchMerge]") {
+
+    BatchMerge merge(2);
+
+    // the records of a batch and the batches of an input can overlap
+    merge.Add(MakeBatch(0, {5, 1, 8}));
+    merge.Add(MakeBatch(0, {3, 2}));
+    merge.Add(MakeBatch(1, {7, 4, 6}));
+    merge.Advance(0, 6);
+    merge.Advance(1, 100);
+
+    CHECK(MergeBelow(merge, merge.Watermark()) == std::vector<uint64_t>({1, 2, 3, 4, 5}));
+
+    // a later batch can still hold records older than the ones left
+    merge.Add(MakeBatch(0, {9, 6}));
+    merge.Advance(0, 100);
+    CHECK(MergeBelow(merge, merge.Watermark()) == std::vector<uint64_t>({6, 6, 7, 8, 9}));
+    CHECK(merge.Empty());
+
+    std::vector<TelemetryBatch> free;
+    merge.TakeMerged(free);
+    CHECK(free.size() == 4);
+}
+
+TEST_CASE("batch merge keeps unevenly delayed inputs in order", "[BatchMerge]") {
+
+    // Events happen 10 per round and go to a random input. Each input
+    // decodes them in order, some a few rounds late, in batches of any size.
+    const size_t inputs = 4;
+    const uint64_t rounds = 500;
+    const uint64_t delays[inputs] = {0, 1, 5, 20};
+
+    std::mt19937 random(24);
+    std::vector<std::vector<std::pair<uint64_t, uint64_t>>> events(inputs);
+    std::vector<uint64_t> delivered(inputs, 0);
+    for (uint64_t event = 0; event < rounds * 10; event++)
+    {
+        size_t input = random() % inputs;
+        uint64_t round = std::max(event / 10 + delays[input] + random() % 4, delivered[input]);
+        delivered[input] = round;
+        events[input].push_back({1000 + event * 10, round});
+    }
+
+    auto run = [&](bool useWatermarks)
+    {
+        BatchMerge merge(inputs);
+        std::vector<size_t> next(inputs, 0);
+        std::vector<uint64_t> merged;
+        auto collect = [&](const TelemetryBatch& batch, size_t record) { merged.push_back(batch[record].timestamp); };
+
+        for (uint64_t round = 0; round < rounds + 30; round++)
+        {
+            for (size_t input = 0; input < inputs; input++)
+            {
+                std::vector<uint64_t> batch;
+                while (next[input] < events[input].size() && events[input][next[input]].second <= round)
+                {
+                    batch.push_back(events[input][next[input]++].first);
+                }
+
+                if (!batch.empty())
+                {
+                    merge.Add(MakeBatch(input, batch));
+                    merge.Advance(input, batch.back());
+                }
+
+                // nothing left that happened by now, the input is idle
+                if (next[input] == events[input].size() || events[input][next[input]].first >= 1000 + round * 100)
+                {
+                    merge.Advance(input, 1000 + round * 100);
+                }
+            }
+
+            merge.Merge(useWatermarks ? merge.Watermark() : UINT64_MAX, collect);
+        }
+        merge.Merge(UINT64_MAX, collect);
+
+        CHECK(merge.Empty());
+        return merged;
+    };
+
+    std::vector<uint64_t> merged = run(true);
+    CHECK(merged.size() == rounds * 10);
+    CHECK(std::is_sorted(merged.begin(), merged.end()));
+
+    // merging whatever arrived, as if there were no watermarks, gets them out of order
+    std::vector<uint64_t> unordered = run(false);
+    CHECK(unordered.size() == rounds * 10);
+    CHECK_FALSE(std::is_sorted(unordered.begin(), unordered.end()));
+}
+
+TEST_CASE("batch merge orders syscalls that returned out of order", "[BatchMerge]") {
+
+    // Syscalls are entered every 10ns and take up to window ns, each is
+    // decoded by a random input once it returned. An input that took all
+    // that returned by now has nothing older than now less window left.
+    const size_t inputs = 3;
+    const uint64_t count = 5000;
+    const uint64_t window = 2000;
+
+    struct Syscall
+    {
+        uint64_t enter;
+        uint64_t exit;
+        size_t input;
+    };
+
+    std::mt19937 random(22);
+    std::vector<Syscall> syscalls;
+    for (uint64_t i = 0; i < count; i++)
+    {
+        uint64_t enter = 1000 + i * 10;
+        syscalls.push_back({enter, enter + random() % window, random() % inputs});
+    }
+    std::sort(syscalls.begin(), syscalls.end(), [](const Syscall& a, const Syscall& b) { return a.exit < b.exit; });
+
+    BatchMerge merge(inputs);
+    std::vector<uint64_t> decoded;
+    std::vector<uint64_t> merged;
+    auto collect = [&](const TelemetryBatch& batch, size_t record) { merged.push_back(batch[record].timestamp); };
+
+    size_t next = 0;
+    for (uint64_t now = 0; next < syscalls.size(); now += 250)
+    {
+        std::vector<std::vector<uint64_t>> batches(inputs);
+        for (; next < syscalls.size() && syscalls[next].exit < now; next++)
+        {
+            batches[syscalls[next].input].push_back(syscalls[next].enter);
+            decoded.push_back(syscalls[next].enter);
+        }
+
+        for (size_t input = 0; input < inputs; input++)
+        {
+            merge.Add(MakeBatch(input, batches[input]));
+            if (now > window)
+            {
+                merge.Advance(input, now - window);
+            }
+        }
+
+        merge.MergeReady(collect);
+    }
+    merge.Merge(UINT64_MAX, collect);
+
+    CHECK_FALSE(std::is_sorted(decoded.begin(), decoded.end()));
+    CHECK(merged.size() == count);
+    CHECK(std::is_sorted(merged.begin(), merged.end()));
+    CHECK(merge.Empty());
+}
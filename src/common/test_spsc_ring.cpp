@@ -0,0 +1,219 @@
+/*
+    Procmon-for-Linux
+
+    Copyright (c) Microsoft Corporation
+
+    All rights reserved.
+
+    MIT License
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spsc_ring.h"
+
+// Writes a record holding text, returns false if the ring is full
+static bool push(SpscRing& ring, const std::string& text)
+{
+    void* record = ring.reserve(text.size());
+    if (record == nullptr)
+        return false;
+
+    memcpy(record, text.data(), text.size());
+    ring.commit();
+    return true;
+}
+
+// Pops up to maxRecords records as strings
+static std::vector<std::string> pop(SpscRing& ring, size_t maxRecords = SIZE_MAX)
+{
+    std::vector<std::string> records;
+    ring.popBatch([&](const uint8_t* data, uint32_t size) { records.emplace_back(reinterpret_cast<const char*>(data), size); }, maxRecords);
+    return records;
+}
+
+TEST_CASE("spsc ring hands records back in order", "[SpscRing]") {
+
+    SpscRing ring(1024);
+    CHECK(ring.empty());
+
+    CHECK(push(ring, "first"));
+    CHECK(push(ring, ""));
+    CHECK(push(ring, "a longer third record"));
+    CHECK_FALSE(ring.empty());
+
+    SECTION("All at once") {
+        CHECK(pop(ring) == std::vector<std::string>({"first", "", "a longer third record"}));
+        CHECK(ring.empty());
+    }
+
+    SECTION("A few at a time") {
+        CHECK(pop(ring, 2) == std::vector<std::string>({"first", ""}));
+        CHECK_FALSE(ring.empty());
+        CHECK(pop(ring, 2) == std::vector<std::string>({"a longer third record"}));
+        CHECK(ring.empty());
+        CHECK(pop(ring).empty());
+    }
+}
+
+TEST_CASE("spsc ring refuses records once full", "[SpscRing]") {
+
+    // 64 bytes hold four records of 8 bytes and their headers
+    SpscRing ring(64);
+    for (int i = 0; i < 4; i++)
+    {
+        CHECK(push(ring, "record " + std::to_string(i)));
+    }
+
+    CHECK_FALSE(push(ring, "record 4"));
+
+    // popping one frees up room for one more
+    CHECK(pop(ring, 1) == std::vector<std::string>({"record 0"}));
+    CHECK(push(ring, "record 4"));
+    CHECK_FALSE(push(ring, "record 5"));
+
+    CHECK(pop(ring) == std::vector<std::string>({"record 1", "record 2", "record 3", "record 4"}));
+    CHECK(ring.empty());
+}
+
+TEST_CASE("spsc ring wraps records around the end of the buffer", "[SpscRing]") {
+
+    SpscRing ring(64);
+
+    SECTION("A record that doesn't fit before the end starts over at the beginning") {
+        // 24 bytes each, the third one would straddle the end
+        CHECK(push(ring, "sixteen bytes!!!"));
+        CHECK(push(ring, "sixteen bytes..."));
+        CHECK(pop(ring).size() == 2);
+
+        CHECK(push(ring, "after the wrap!!"));
+        CHECK(push(ring, "and one more...."));
+        CHECK(pop(ring) == std::vector<std::string>({"after the wrap!!", "and one more...."}));
+        CHECK(ring.empty());
+    }
+
+    SECTION("Records of any size keep their order across many wraps") {
+        int pushed = 0;
+        int popped = 0;
+        for (int round = 0; round < 1000; round++)
+        {
+            while (push(ring, std::to_string(pushed) + std::string(pushed % 17, '.')))
+            {
+                pushed++;
+            }
+
+            for (auto& record : pop(ring, 1 + round % 3))
+            {
+                REQUIRE(record == std::to_string(popped) + std::string(popped % 17, '.'));
+                popped++;
+            }
+        }
+
+        CHECK(pushed > 1000);
+    }
+}
+
+TEST_CASE("spsc ring keeps the order between threads", "[SpscRing]") {
+
+    SpscRing ring(4096);
+    const int count = 100000;
+
+    std::thread producer([&]
+    {
+        for (int i = 0; i < count; i++)
+        {
+            while (!push(ring, std::to_string(i)))
+            {
+                if (ring.isCancelled())
+                    return;
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    int next = 0;
+    bool ordered = true;
+    while (next < count)
+    {
+        if (!ring.wait(1000))
+            break;
+
+        for (auto& record : pop(ring))
+        {
+            ordered = ordered && record == std::to_string(next);
+            next++;
+        }
+    }
+
+    // lets the producer give up if the consumer did
+    ring.cancel();
+    producer.join();
+    CHECK(next == count);
+    CHECK(ordered);
+}
+
+TEST_CASE("spsc ring wakes up a waiting consumer", "[SpscRing]") {
+
+    SpscRing ring(1024);
+
+    SECTION("Wait returns at once when there are records") {
+        CHECK(push(ring, "ready"));
+        auto start = std::chrono::steady_clock::now();
+        CHECK(ring.wait(5000));
+        CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(1));
+    }
+
+    SECTION("Wait times out when there are none") {
+        CHECK_FALSE(ring.wait(10));
+    }
+
+    SECTION("A commit wakes up the consumer") {
+        bool woken = false;
+        auto start = std::chrono::steady_clock::now();
+        std::thread consumer([&] { woken = ring.wait(5000); });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        CHECK(push(ring, "wake up"));
+        consumer.join();
+
+        CHECK(woken);
+        CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(4));
+        CHECK(pop(ring) == std::vector<std::string>({"wake up"}));
+    }
+}
+
+TEST_CASE("spsc ring cancel releases a waiting consumer", "[SpscRing]") {
+
+    SpscRing ring(1024);
+    CHECK_FALSE(ring.isCancelled());
+
+    bool woken = true;
+    auto start = std::chrono::steady_clock::now();
+    std::thread consumer([&] { woken = ring.wait(5000); });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ring.cancel();
+    consumer.join();
+
+    CHECK_FALSE(woken);
+    CHECK(ring.isCancelled());
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(4));
+
+    // once cancelled wait doesn't block anymore
+    start = std::chrono::steady_clock::now();
+    CHECK_FALSE(ring.wait(5000));
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(1));
+}
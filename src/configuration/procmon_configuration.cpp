@@ -30,11 +30,6 @@ void ProcmonConfiguration::HandlePidArgs(char *pidArgs)
         {
             pid = std::stoi(pidString, nullptr, 10);
             pids.push_back(pid);
-            if(pids.size()>MAX_PIDS)
-            {
-                std::cerr << "Max number of pids (" << MAX_PIDS << ")" << " exceeded" << '\n';
-                CLIUtils::FastExit();
-            }
         }
         catch(const std::exception& e)
         {
@@ -68,6 +63,175 @@ void ProcmonConfiguration::HandleEventArgs(char *eventArgs)
     }
 }
 
+void ProcmonConfiguration::HandleMinDurationArg(char *durationArg)
+{
+    try
+    {
+        // specified in microseconds, the tracer works in nanoseconds
+        unsigned long long durationUs = CLIUtils::ParseUnsigned(durationArg);
+        if (durationUs > UINT64_MAX / 1000)
+        {
+            throw std::out_of_range("minimum duration is too large");
+        }
+        tracerOptions.minDurationNs = durationUs * 1000;
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << "ProcmonConfiguration::Invalid minimum duration specified - " << e.what() << '\n';
+        CLIUtils::FastExit();
+    }
+}
+
+void ProcmonConfiguration::HandleErrnoArgs(char *errnoArgs)
+{
+    std::stringstream errnoStream(errnoArgs);
+    std::string errnoString;
+    while (getline(errnoStream, errnoString, ','))
+    {
+        int error = CLIUtils::GetErrnoForName(errnoString);
+        if (error <= 0 || error >= ERRNO_MAX)
+        {
+            std::cerr << "ProcmonConfiguration::Invalid errno specified - " << errnoString << std::endl;
+            CLIUtils::FastExit();
+        }
+
+        tracerOptions.errnos.push_back(error);
+    }
+}
+
+void ProcmonConfiguration::HandleSampleArgs(char *sampleArgs)
+{
+    std::stringstream sampleStream(sampleArgs);
+    std::string sampleString;
+    while (getline(sampleStream, sampleString, ','))
+    {
+        // syscall=N keeps 1 in N calls of syscall
+        size_t separator = sampleString.find('=');
+        std::string syscall = sampleString.substr(0, separator);
+        unsigned long rate = 0;
+        try
+        {
+            if (separator != std::string::npos)
+                rate = CLIUtils::ParseUnsigned(sampleString.substr(separator + 1));
+        }
+        catch(const std::exception& e)
+        {
+            rate = 0;
+        }
+
+        if (Utils::GetSyscallNumberForName(syscall) < 0 || rate < 1 || rate > UINT16_MAX)
+        {
+            std::cerr << "ProcmonConfiguration::Invalid sample rate specified - " << sampleString << std::endl;
+            CLIUtils::FastExit();
+        }
+
+        tracerOptions.sampleRates[syscall] = rate;
+    }
+}
+
+void ProcmonConfiguration::HandleRateLimitArg(char *rateArg)
+{
+    try
+    {
+        tracerOptions.rateLimit = CLIUtils::ParseUnsigned(rateArg);
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << "ProcmonConfiguration::Invalid rate limit specified - " << e.what() << '\n';
+        CLIUtils::FastExit();
+    }
+}
+
+void ProcmonConfiguration::HandleMaxStringArg(char *lengthArg)
+{
+    unsigned long length = 0;
+    try
+    {
+        length = CLIUtils::ParseUnsigned(lengthArg);
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << "ProcmonConfiguration::Invalid maximum string length specified - " << e.what() << '\n';
+        CLIUtils::FastExit();
+    }
+
+    if (length > MAX_STRING_BYTES)
+    {
+        std::cerr << "ProcmonConfiguration::Maximum string length can't be above " << MAX_STRING_BYTES << " bytes" << std::endl;
+        CLIUtils::FastExit();
+    }
+
+    tracerOptions.maxStringLength = length;
+}
+
+void ProcmonConfiguration::HandleSnaplenArgs(char *snaplenArgs)
+{
+    std::stringstream snaplenStream(snaplenArgs);
+    std::string snaplenString;
+    while (getline(snaplenStream, snaplenString, ','))
+    {
+        // read=N or write=N captures up to N bytes of the data buffers of that class
+        size_t separator = snaplenString.find('=');
+        std::string syscallClass = snaplenString.substr(0, separator);
+        unsigned long snaplen = MAX_PAYLOAD_BYTES + 1;
+        try
+        {
+            if (separator != std::string::npos)
+                snaplen = CLIUtils::ParseUnsigned(snaplenString.substr(separator + 1));
+        }
+        catch(const std::exception& e)
+        {
+            snaplen = MAX_PAYLOAD_BYTES + 1;
+        }
+
+        if (snaplen > MAX_PAYLOAD_BYTES || (syscallClass != "read" && syscallClass != "write"))
+        {
+            std::cerr << "ProcmonConfiguration::Invalid snaplen specified - " << snaplenString << std::endl;
+            CLIUtils::FastExit();
+        }
+
+        if (syscallClass == "read")
+            tracerOptions.snaplenRead = snaplen;
+        else
+            tracerOptions.snaplenWrite = snaplen;
+    }
+}
+
+void ProcmonConfiguration::HandlePayloadBudgetArg(char *budgetArg)
+{
+    try
+    {
+        tracerOptions.payloadBudget = CLIUtils::ParseUnsigned(budgetArg);
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << "ProcmonConfiguration::Invalid payload budget specified - " << e.what() << '\n';
+        CLIUtils::FastExit();
+    }
+}
+
+void ProcmonConfiguration::HandleDecodersArg(char *decodersArg)
+{
+    unsigned long decoders = 0;
+    try
+    {
+        decoders = CLIUtils::ParseUnsigned(decodersArg);
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << "ProcmonConfiguration::Invalid number of decoders specified - " << e.what() << '\n';
+        CLIUtils::FastExit();
+    }
+
+    if (decoders < 1 || decoders > MAX_DECODERS)
+    {
+        std::cerr << "ProcmonConfiguration::Number of decoders must be between 1 and " << MAX_DECODERS << std::endl;
+        CLIUtils::FastExit();
+    }
+
+    tracerOptions.decoders = decoders;
+}
+
 void ProcmonConfiguration::HandleLogArg(char * filepath)
 {
     if(filepath)
@@ -114,6 +278,20 @@ ProcmonConfiguration::ProcmonConfiguration(int argc, char *argv[])
         { "collect",       optional_argument, NULL, 'c' },
         { "file",          required_argument, NULL, 'f' },
         { "log",           required_argument, NULL, 'l' },
+        { "follow",        no_argument,       NULL, 'F' },
+        { "stack-ids",     no_argument,       NULL, OPT_STACK_IDS },
+        { "kernel-stacks", no_argument,       NULL, OPT_KERNEL_STACKS },
+        { "summary",       no_argument,       NULL, OPT_SUMMARY },
+        { "min-duration",  required_argument, NULL, OPT_MIN_DURATION },
+        { "errors-only",   no_argument,       NULL, OPT_ERRORS_ONLY },
+        { "errno",         required_argument, NULL, OPT_ERRNO },
+        { "sample",        required_argument, NULL, OPT_SAMPLE },
+        { "rate-limit",    required_argument, NULL, OPT_RATE_LIMIT },
+        { "max-string",    required_argument, NULL, OPT_MAX_STRING },
+        { "snaplen",       required_argument, NULL, OPT_SNAPLEN },
+        { "payload-budget", required_argument, NULL, OPT_PAYLOAD_BUDGET },
+        { "control",       required_argument, NULL, OPT_CONTROL },
+        { "decoders",      required_argument, NULL, OPT_DECODERS },
         { "help",          no_argument,       NULL, 'h' },
         { NULL,            0,                 NULL,  0  }
     };
@@ -122,7 +300,7 @@ ProcmonConfiguration::ProcmonConfiguration(int argc, char *argv[])
     int option_index = 0;
     while (true)
     {
-        if ((c = getopt_long(argc, argv, "hc:p:s:e:f:l:", long_options, &option_index)) == -1)
+        if ((c = getopt_long(argc, argv, "hc:p:s:e:f:l:F", long_options, &option_index)) == -1)
             break;
 
         switch (c)
@@ -162,6 +340,62 @@ ProcmonConfiguration::ProcmonConfiguration(int argc, char *argv[])
                 HandleLogArg(optarg);
                 break;
 
+            case 'F':
+                tracerOptions.followChildren = true;
+                break;
+
+            case OPT_STACK_IDS:
+                tracerOptions.stackIds = true;
+                break;
+
+            case OPT_KERNEL_STACKS:
+                tracerOptions.kernelStacks = true;
+                break;
+
+            case OPT_SUMMARY:
+                tracerOptions.summary = true;
+                break;
+
+            case OPT_MIN_DURATION:
+                HandleMinDurationArg(optarg);
+                break;
+
+            case OPT_ERRORS_ONLY:
+                tracerOptions.errorsOnly = true;
+                break;
+
+            case OPT_ERRNO:
+                HandleErrnoArgs(optarg);
+                break;
+
+            case OPT_SAMPLE:
+                HandleSampleArgs(optarg);
+                break;
+
+            case OPT_RATE_LIMIT:
+                HandleRateLimitArg(optarg);
+                break;
+
+            case OPT_MAX_STRING:
+                HandleMaxStringArg(optarg);
+                break;
+
+            case OPT_SNAPLEN:
+                HandleSnaplenArgs(optarg);
+                break;
+
+            case OPT_PAYLOAD_BUDGET:
+                HandlePayloadBudgetArg(optarg);
+                break;
+
+            case OPT_CONTROL:
+                controlPath = std::string(optarg);
+                break;
+
+            case OPT_DECODERS:
+                HandleDecodersArg(optarg);
+                break;
+
             default:
                 // Invalid argument
                 CLIUtils::DisplayUsage(true);
@@ -172,6 +406,7 @@ ProcmonConfiguration::ProcmonConfiguration(int argc, char *argv[])
 
     // Get schema of all syscalls on system
     syscallSchema = Utils::CollectSyscallSchema();
+    syscallSchemaIndex = Utils::IndexSyscallSchema(syscallSchema);
 
     // if user has not specified any syscalls trace all events
     if(events.size() == 0)
@@ -185,9 +420,7 @@ ProcmonConfiguration::ProcmonConfiguration(int argc, char *argv[])
     {
         for (auto event : events)
         {
-            auto search = std::find_if(syscallSchema.begin(), syscallSchema.end(), [event](auto s) -> bool {return event.Name().compare(s.syscallName) == 0; });
-
-            if (search == syscallSchema.end())
+            if (GetSchemaIndex(event.Name()) < 0)
             {
                 // Invalid syscall passed to procmon
                 std::cerr << "ERROR: Invalid syscall " << event.Name() << std::endl << std::endl;
@@ -207,7 +440,7 @@ ProcmonConfiguration::ProcmonConfiguration(int argc, char *argv[])
     _storageEngine->Initialize(events);
 
     // Initialize Tracer
-    _tracerEngine = std::unique_ptr<ITracerEngine>(new EbpfTracerEngine(_storageEngine, events, pids));
+    _tracerEngine = std::unique_ptr<ITracerEngine>(new EbpfTracerEngine(_storageEngine, events, pids, tracerOptions));
     _tracerEngine->Initialize();
     _tracerEngine->AddEvent(events);
 
@@ -218,6 +451,113 @@ ProcmonConfiguration::ProcmonConfiguration(int argc, char *argv[])
     _tracerEngine->SetRunState(TRACER_RUNNING);
 }
 
+bool ProcmonConfiguration::ApplyTraceCommand(const std::string& command, std::string& error)
+{
+    std::stringstream commandStream(command);
+    std::string action, target, list;
+    commandStream >> action >> target >> list;
+
+    bool add = action == "add";
+    if ((!add && action != "remove") || (target != "syscall" && target != "pid") || list.empty())
+    {
+        error = "Expected add|remove syscall|pid LIST";
+        return false;
+    }
+
+    std::stringstream listStream(list);
+    std::string item;
+
+    if (target == "syscall")
+    {
+        std::vector<Event> changed;
+        std::vector<Event> remaining = events;
+        while (getline(listStream, item, ','))
+        {
+            if (GetSchemaIndex(item) < 0)
+            {
+                error = "Invalid syscall " + item;
+                return false;
+            }
+
+            auto traced = std::find_if(remaining.begin(), remaining.end(), [&item](const Event& e) -> bool {return e.Name() == item; });
+            if (add && traced == remaining.end())
+            {
+                remaining.emplace_back(item);
+                changed.emplace_back(item);
+            }
+            else if (!add && traced != remaining.end())
+            {
+                remaining.erase(traced);
+                changed.emplace_back(item);
+            }
+        }
+
+        if (remaining.empty())
+        {
+            error = "Can't stop tracing every syscall";
+            return false;
+        }
+
+        events = remaining;
+        if (add) _tracerEngine->AddEvent(changed);
+        else _tracerEngine->RemoveEvent(changed);
+    }
+    else
+    {
+        std::vector<int> changed;
+        std::vector<pid_t> remaining = pids;
+        while (getline(listStream, item, ','))
+        {
+            pid_t pid;
+            try
+            {
+                pid = std::stoi(item, nullptr, 10);
+            }
+            catch(const std::exception& e)
+            {
+                error = "Invalid pid " + item;
+                return false;
+            }
+
+            auto traced = std::find(remaining.begin(), remaining.end(), pid);
+            if (add && traced == remaining.end())
+            {
+                remaining.push_back(pid);
+                changed.push_back(pid);
+            }
+            else if (!add && traced != remaining.end())
+            {
+                remaining.erase(traced);
+                changed.push_back(pid);
+            }
+        }
+
+        // an empty pid list means every process, so narrowing to nothing isn't possible
+        if (remaining.empty())
+        {
+            error = "Can't stop tracing every pid";
+            return false;
+        }
+
+        pids = remaining;
+        if (add) _tracerEngine->AddPids(changed);
+        else _tracerEngine->RemovePids(changed);
+    }
+
+    LOG(DEBUG) << "Applied trace command: " << command;
+    return true;
+}
+
+int ProcmonConfiguration::GetSchemaIndex(const std::string& syscallName)
+{
+    return GetSchemaIndex(Utils::GetSyscallNumberForName(syscallName));
+}
+
+int ProcmonConfiguration::GetSchemaIndex(int syscallNumber)
+{
+    return syscallNumber < 0 || syscallNumber >= (int)syscallSchemaIndex.size() ? -1 : syscallSchemaIndex[syscallNumber];
+}
+
 uint64_t ProcmonConfiguration::GetStartTime()
 {
     return startTime.tv_sec * 1000000000 + startTime.tv_nsec;
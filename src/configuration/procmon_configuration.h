@@ -38,12 +38,32 @@
 
 #define DEFAULT_TIMESTAMP_LENGTH 25
 #define DEFAULT_DATESTAMP_LENGTH 11
+#define MAX_DECODERS 256
+
+// Options that only have a long form start after the range of short options
+enum LongOptions
+{
+    OPT_STACK_IDS = 256,
+    OPT_SUMMARY,
+    OPT_MIN_DURATION,
+    OPT_ERRORS_ONLY,
+    OPT_ERRNO,
+    OPT_SAMPLE,
+    OPT_RATE_LIMIT,
+    OPT_MAX_STRING,
+    OPT_SNAPLEN,
+    OPT_PAYLOAD_BUDGET,
+    OPT_KERNEL_STACKS,
+    OPT_CONTROL,
+    OPT_DECODERS,
+};
 
 struct ProcmonArgs
 {
     std::vector<pid_t> pids;
     std::vector<Event> events;
     StorageProxy::StorageEngineType storageEngineType;
+    TracerOptions tracerOptions;
 };
 
 // Should only be created once.  Pass around using
@@ -54,6 +74,7 @@ private:
     std::shared_ptr<IStorageEngine> _storageEngine;
     std::unique_ptr<ITracerEngine>  _tracerEngine;
     std::vector<struct SyscallSchema> syscallSchema;
+    std::vector<int> syscallSchemaIndex;
     std::vector<std::string> pointerSyscalls;
     struct timespec startTime;
     std::string epocStartTime;
@@ -62,6 +83,7 @@ private:
     std::string traceFilePath = "";
     std::string debugTraceFilePath = "";
     std::string outputTraceFilePath = "";
+    std::string controlPath = "";
 
     void HandlePidArgs(char *pidArgs);
 
@@ -69,6 +91,15 @@ private:
 
     void HandleEventArgs(char *eventArgs);
 
+    void HandleMinDurationArg(char *durationArg);
+    void HandleErrnoArgs(char *errnoArgs);
+    void HandleSampleArgs(char *sampleArgs);
+    void HandleRateLimitArg(char *rateArg);
+    void HandleMaxStringArg(char *lengthArg);
+    void HandleSnaplenArgs(char *snaplenArgs);
+    void HandlePayloadBudgetArg(char *budgetArg);
+    void HandleDecodersArg(char *decodersArg);
+
     void HandleFileArg(char * filepath);
     void HandleLogArg(char * filepath);
 
@@ -78,10 +109,19 @@ public:
     // Initializes the configuration handling args and creating necessary resources.
     ProcmonConfiguration(int argc, char *argv[]);
 
+    // Applies a runtime change to the traced syscalls or pids, one of
+    //   add syscall NAME[,NAME...]    remove syscall NAME[,NAME...]
+    //   add pid PID[,PID...]          remove pid PID[,PID...]
+    // On failure error holds a message for the user and nothing is changed.
+    bool ApplyTraceCommand(const std::string& command, std::string& error);
+
     // Getters & Setters
     const std::unique_ptr<ITracerEngine>& GetTracer() { return _tracerEngine; };
     std::shared_ptr<IStorageEngine> GetStorage() { return _storageEngine; };
     std::vector<struct SyscallSchema>& GetSchema() { return syscallSchema; }
+    // Index in the schema of a syscall, -1 if there is none
+    int GetSchemaIndex(const std::string& syscallName);
+    int GetSchemaIndex(int syscallNumber);
     std::vector<std::string> getPointerSyscalls() { return pointerSyscalls; }
     uint64_t GetStartTime();
     void SetStartTime(uint64_t start);
@@ -92,4 +132,5 @@ public:
     std::string GetTraceFilePath() { return traceFilePath; }
     std::string GetDebugTraceFilePath() { return debugTraceFilePath; }
     std::string GetOutputTraceFilePath() { return outputTraceFilePath; }
+    std::string GetControlPath() { return controlPath; }
 };
\ No newline at end of file
@@ -37,7 +37,7 @@ std::string EventFormatter::GetProcess(ITelemetry &event)
 
 std::string EventFormatter::GetOperation(ITelemetry &event)
 {
-    return event.syscall;
+    return Utils::GetSyscallName(event.syscall);
 }
 
 std::string EventFormatter::GetDuration(ITelemetry &event)
@@ -54,7 +54,7 @@ std::string EventFormatter::GetResult(ITelemetry &event)
     {
         for(int i = 0; i < pointerSycalls.size(); i++)
         {
-            if(event.syscall == pointerSycalls[i])
+            if(event.syscall == Utils::GetSyscallNumberForName(pointerSycalls[i]))
             {
                 std::stringstream stream;
                 stream << std::setfill('0') << std::setw(sizeof(uint64_t)*2) << std::hex << event.result;
@@ -99,6 +99,27 @@ std::string EventFormatter::CalculateDeltaTimestamp(uint64_t ebpfEventTimestamp)
     return deltaTimestamp;
 }
 
+// Hex of the first bytes of a captured data buffer and its full length
+static std::string FormatPayload(const std::vector<uint8_t>& payload)
+{
+    const size_t previewBytes = 32;
+    std::stringstream ss;
+
+    for(size_t i = 0; i < payload.size() && i < previewBytes; i++)
+    {
+        ss << std::setfill('0') << std::setw(2) << std::hex << (uint32_t)payload[i] << " ";
+    }
+
+    if(payload.size() > previewBytes)
+    {
+        ss << "... ";
+    }
+
+    ss << std::dec << "(" << payload.size() << " bytes)";
+
+    return ss.str();
+}
+
 std::string EventFormatter::DecodeArguments(ITelemetry &event)
 {
     std::string args = "";
@@ -110,12 +131,38 @@ std::string EventFormatter::DecodeArguments(ITelemetry &event)
     SyscallSchema item = schema[index];
 
     int readOffset = 0;
+    size_t stringIndex = 0;
+    bool payloadWrite = false;
+    int payloadArg = event.payload.empty() ? -1 : Utils::GetPayloadArg(item, payloadWrite);
+    bool addressFilled = false;
+    int addressArg = event.address.empty() ? -1 : Utils::GetSocketAddressArg(item, addressFilled);
     for(int i=0; i<item.usedArgCount; i++)
     {
         args+=item.argNames[i];
         args+="=";
 
-        if(item.types[i]==ProcmonArgTag::INT || item.types[i]==ProcmonArgTag::LONG)
+        // string arguments captured in full replace the short preview
+        if(Utils::IsStringArg(item, i) && stringIndex < event.strings.size())
+        {
+            args+=event.strings[stringIndex++];
+            readOffset+=MAX_BUFFER / 6;
+        }
+        // as does a captured data buffer
+        else if(i == payloadArg)
+        {
+            args+=FormatPayload(event.payload);
+            if(item.types[i] == ProcmonArgTag::CHAR_PTR || item.types[i] == ProcmonArgTag::CONST_CHAR_PTR)
+                readOffset+=MAX_BUFFER / 6;
+            else
+                readOffset+=sizeof(unsigned long);
+        }
+        // and a decoded socket address
+        else if(i == addressArg)
+        {
+            args+=event.address;
+            readOffset+=sizeof(unsigned long);
+        }
+        else if(item.types[i]==ProcmonArgTag::INT || item.types[i]==ProcmonArgTag::LONG)
         {
             long val = 0;
             int size = sizeof(long);
@@ -141,11 +188,11 @@ std::string EventFormatter::DecodeArguments(ITelemetry &event)
         }
         else if (item.types[i] == ProcmonArgTag::CHAR_PTR || item.types[i] == ProcmonArgTag::CONST_CHAR_PTR)
         {
-            if(event.syscall.compare("read") == 0)
+            if(event.syscall == SyscallNumberForName("read"))
             {
                 args += "{in}";
             }
-            else if (event.syscall.compare("write") == 0)
+            else if (event.syscall == SyscallNumberForName("write"))
             {
                 int size = MAX_BUFFER / 6;
                 std::stringstream ss;
@@ -186,11 +233,21 @@ std::string EventFormatter::DecodeArguments(ITelemetry &event)
         }
         else if (item.types[i] == ProcmonArgTag::FD)
         {
+            // fd number followed by the name the kernel resolved it to, if any
             int size=MAX_BUFFER/6;
-            char buff[size];
-            memcpy(buff, event.arguments+readOffset, size);
+            int32_t fd = 0;
+            char name[MAX_BUFFER/6 - sizeof(fd) + 1] = {};
+            memcpy(&fd, event.arguments+readOffset, sizeof(fd));
+            memcpy(name, event.arguments+readOffset+sizeof(fd), size - sizeof(fd));
             readOffset+=size;
-            args+=buff;
+
+            args+=std::to_string(fd);
+            if(name[0] != 0)
+            {
+                args+="(";
+                args+=name;
+                args+=")";
+            }
         }
         else if (item.types[i] == ProcmonArgTag::PTR)
         {
@@ -222,19 +279,7 @@ std::string EventFormatter::DecodeArguments(ITelemetry &event)
     return args;
 }
 
-int EventFormatter::FindSyscall(std::string& syscallName)
+int EventFormatter::FindSyscall(int syscallNumber)
 {
-    std::vector<struct SyscallSchema>& schema = config->GetSchema();
-
-    int i = 0;
-    for(auto& syscall : schema)
-    {
-        if(syscallName.compare(syscall.syscallName)==0)
-        {
-            return i;
-        }
-        i++;
-    }
-
-    return -1;
+    return config->GetSchemaIndex(syscallNumber);
 }
@@ -32,7 +32,7 @@ protected:
     ProcmonConfiguration* config;
 
     std::string CalculateDeltaTimestamp(uint64_t ebpfEventTimestamp);
-    int FindSyscall(std::string& syscallName);
+    int FindSyscall(int syscallNumber);
     std::string DecodeArguments(ITelemetry &event);
 
 public:
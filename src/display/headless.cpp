@@ -18,7 +18,13 @@
 #include "../logging/easylogging++.h"
 
 #include <version.h>
+#include <cerrno>
 #include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <iomanip>
 #include <iostream>
 #include <thread>
 
@@ -73,9 +79,66 @@ bool Headless::initialize(std::shared_ptr<ProcmonConfiguration> configPtr)
         std::cout << std::endl;
     }
 
+    if(config->GetControlPath().size() > 0 && !openControl())
+    {
+        return false;
+    }
+
     return true;
 }
 
+bool Headless::openControl()
+{
+    if(mkfifo(config->GetControlPath().c_str(), 0600) != 0 && errno != EEXIST)
+    {
+        std::cerr << "Failed to create control FIFO " << config->GetControlPath() << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    // opened for writing too so that reads don't see end of file once a writer closes
+    controlFd = open(config->GetControlPath().c_str(), O_RDWR | O_NONBLOCK);
+    if(controlFd < 0)
+    {
+        std::cerr << "Failed to open control FIFO " << config->GetControlPath() << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    std::cout << "Control FIFO: " << config->GetControlPath() << std::endl;
+    return true;
+}
+
+void Headless::readControlCommands()
+{
+    char buffer[256];
+    ssize_t bytes;
+    while((bytes = read(controlFd, buffer, sizeof(buffer))) > 0)
+    {
+        controlBuffer.append(buffer, bytes);
+    }
+
+    size_t newline;
+    while((newline = controlBuffer.find('\n')) != std::string::npos)
+    {
+        std::string command = controlBuffer.substr(0, newline);
+        controlBuffer.erase(0, newline + 1);
+
+        if(command.empty())
+        {
+            continue;
+        }
+
+        std::string error;
+        if(config->ApplyTraceCommand(command, error))
+        {
+            std::cout << std::endl << "Applied: " << command << std::endl;
+        }
+        else
+        {
+            std::cout << std::endl << "Ignored \"" << command << "\": " << error << std::endl;
+        }
+    }
+}
+
 void Headless::run()
 {
     bool running = true;
@@ -84,7 +147,13 @@ void Headless::run()
     // setup signal handler
     signal(SIGINT, sigintHandler);
 
-    std::cout << "Events captured: ";
+    bool summary = config->tracerOptions.summary;
+    std::string prompt = summary ? "Syscalls summarized: " : "Events captured: ";
+    std::cout << prompt;
+
+    uint64_t lostChecked = 0;
+    int capturedChecked = 0;
+    bool lossWarning = false;
 
     while(running)
     {
@@ -95,8 +164,26 @@ void Headless::run()
             break;
         }
 
+        // warn once the loss rate over the last second crosses the threshold
+        uint64_t lost = config->GetTracer()->GetStats().lost;
+        int captured = config->GetStorage()->Size();
+        bool warning = LossRateExceeded(lost - lostChecked, captured - capturedChecked);
+        if(warning && !lossWarning)
+        {
+            std::cout << std::endl << "WARNING: More than " << LOST_EVENTS_WARNING_PERCENT << "% of events are being lost, consider tightening the pid or syscall filters" << std::endl;
+            std::cout << prompt;
+        }
+        lossWarning = warning;
+        lostChecked = lost;
+        capturedChecked = captured;
+
+        if(controlFd >= 0)
+        {
+            readControlCommands();
+        }
+
         // update terminal with events captured
-        size = std::to_string(config->GetStorage()->Size());
+        size = std::to_string(summary ? summarizedCount() : captured) + " (lost: " + std::to_string(lost) + ")";
         std::cout << size << std::flush;
         std::this_thread::sleep_for(std::chrono::milliseconds(1000));
 
@@ -106,12 +193,53 @@ void Headless::run()
     std::cout << std::endl << std::endl;
 }
 
+uint64_t Headless::summarizedCount()
+{
+    uint64_t total = 0;
+    for(auto& summary : config->GetTracer()->GetSummary())
+    {
+        total += summary.count;
+    }
+
+    return total;
+}
+
+void Headless::printSummary()
+{
+    std::vector<SyscallSummary> summaries = config->GetTracer()->GetSummary();
+
+    std::cout << std::left << std::setw(10) << "Pid" << std::setw(22) << "Syscall" << std::setw(14) << "Count"
+              << std::setw(12) << "Errors" << std::setw(20) << "Total Duration" << "p99" << std::endl;
+
+    for(auto& summary : summaries)
+    {
+        std::cout << std::left << std::setw(10) << summary.pid << std::setw(22) << summary.syscall << std::setw(14) << summary.count
+                  << std::setw(12) << summary.errors << std::setw(20) << (std::to_string(summary.totalDuration / 1000) + " us")
+                  << "<" << summary.PercentileUs(99) << " us" << std::endl;
+    }
+    std::cout << std::endl;
+}
+
 void Headless::shutdown()
 {
+    if(controlFd >= 0)
+    {
+        close(controlFd);
+        unlink(config->GetControlPath().c_str());
+    }
+
+    if(config->tracerOptions.summary)
+    {
+        printSummary();
+    }
+
     std::cout << "Writing events to " << config->GetOutputTraceFilePath() << std::endl;
 
+    TracerStats stats = config->GetTracer()->GetStats();
+
     try
     {
+        config->GetStorage()->SetLostEvents(stats.lost);
         config->GetStorage()->Export(std::make_tuple(config->GetStartTime(), config->GetEpocStartTime()), config->GetOutputTraceFilePath());
     }
     catch(const std::runtime_error& e)
@@ -123,5 +251,23 @@ void Headless::shutdown()
 
 
     std::cout << "Total events captured: " << config->GetStorage()->Size() << std::endl;
+    std::cout << "Total events lost: " << stats.lost << std::endl;
+
+    if(stats.sampledOut > 0 || stats.throttled > 0 || stats.inFlightFailed > 0)
+    {
+        std::cout << "Events sampled away: " << stats.sampledOut << ", throttled: " << stats.throttled
+                  << ", dropped with a full in flight table: " << stats.inFlightFailed << std::endl;
+    }
+
+    if(stats.payloadDropped > 0)
+    {
+        std::cout << "Data buffers left out over the payload budget: " << stats.payloadDropped << std::endl;
+    }
+
+    if(stats.decodeNs > 0)
+    {
+        std::cout << "Time decoding: " << stats.decodeNs / 1000000 << " ms, merging: " << stats.mergeNs / 1000000
+                  << " ms, storing: " << stats.storeNs / 1000000 << " ms, waiting on storage: " << stats.writeWaitNs / 1000000 << " ms" << std::endl;
+    }
 
 }
\ No newline at end of file
@@ -31,6 +31,15 @@ class Headless
     private:
         // procmon configuration
         std::shared_ptr<ProcmonConfiguration> config;
+
+        // FIFO trace commands are read from, -1 without --control
+        int controlFd = -1;
+        std::string controlBuffer;
+
+        uint64_t summarizedCount();
+        void printSummary();
+        bool openControl();
+        void readControlCommands();
 };
 
 #endif // HEADLESS_H
\ No newline at end of file
@@ -87,6 +87,8 @@ void Screen::initScreen(std::shared_ptr<ProcmonConfiguration> config)
     searchPromptActive = false;
     searchCount = 0;
     filter = "";
+    tracePromptActive = false;
+    traceCommand = "";
 
     LOG(DEBUG) << "ScreenH:" << screenH << "ScreenW:" << screenW << "Column Height:" << columnHeight;
 
@@ -97,6 +99,7 @@ void Screen::initScreen(std::shared_ptr<ProcmonConfiguration> config)
     initColumnView();
     initStatView();
     initHelpView();
+    initBlockedView();
     initTimestampColumn();
     initPidColumn();
     initProcessColumn();
@@ -350,6 +353,59 @@ void Screen::run()
                 }
             }
         }
+        else if(tracePromptActive)
+        {
+            if(input >= ' ' && input <= '~')                        // all printable ASCII characters
+            {
+                traceCommand += (char)input;
+                drawTracePrompt(traceCommand, "");
+            }
+            else
+            {
+                switch(input)
+                {
+                    case KEY_DC:
+                    case KEY_BACKSPACE:
+                        if(traceCommand.size() > 0)
+                        {
+                            traceCommand.pop_back();
+                            drawTracePrompt(traceCommand, "");
+                        }
+                        break;
+
+                    case 27:    // Esc Key
+                        tracePromptActive = false;
+                        traceCommand = "";
+                        drawFooterFkeys();
+                        break;
+
+                    case KEY_F(9):
+                        running = false;
+                        break;
+
+                    case KEY_ENTER:
+                    case 10:    // Enter Key
+                    {
+                        std::string error;
+                        if(config->ApplyTraceCommand(traceCommand, error))
+                        {
+                            tracePromptActive = false;
+                            traceCommand = "";
+                            drawFooterFkeys();
+
+                            // the event list follows the traced syscalls and pids
+                            eventList = storageEngine->QueryByEventsinPage(config->pids, getCurrentPage(), getTotalLines(), screenConfig.getColumnSort(), screenConfig.getColumnAscending(), config->events);
+                            displayEvents(eventList);
+                        }
+                        else
+                        {
+                            drawTracePrompt(traceCommand, error);
+                        }
+                        break;
+                    }
+                }
+            }
+        }
         else {
             switch(input)
             {
@@ -437,10 +493,16 @@ void Screen::run()
                     // only export if we have generated a new tracefile and not opened one
                     if(config->GetTraceFilePath().compare("") == 0)
                     {
+                        storageEngine->SetLostEvents(config->GetTracer()->GetStats().lost);
                         storageEngine->Export(std::make_tuple(config->GetStartTime(), config->GetEpocStartTime()), config->GetOutputTraceFilePath());
                     }
                     break;
 
+                case KEY_F(7):
+                    if(blockedViewActive) closeBlockedView();
+                    else showBlockedView();
+                    break;
+
                 case KEY_F(8):
                     if(statViewActive) closeStatView();
                     else showStatView();
@@ -452,6 +514,15 @@ void Screen::run()
                     running = false;
                     break;
 
+                case KEY_F(10):
+                    // only a live trace can be changed
+                    if(config->GetTraceFilePath().compare("") == 0)
+                    {
+                        tracePromptActive = true;
+                        drawTracePrompt(traceCommand, "");
+                    }
+                    break;
+
                 // Esc Key
                 case 27:
                     // close any view open
@@ -461,6 +532,7 @@ void Screen::run()
                     else if (searchPromptActive) searchPromptActive = false;
                     else if (statViewActive) closeStatView();
                     else if (helpViewActive) closeHelpView();
+                    else if (blockedViewActive) closeBlockedView();
 
                     drawFooterFkeys();
                     break;
@@ -564,11 +636,20 @@ void Screen::run()
                     }
                 }
             }
+
+            // kernel aggregates keep changing while the stat view is open
+            if(statViewActive && config->tracerOptions.summary) showSummaryStatView();
+
+            // so does the in flight table
+            if(blockedViewActive) showBlockedView();
+
             previousTime = currentTime;
         }
 
-        // draw events in datastore to screen
-        windowPrintFillRight(headerWin, HEADER_COLOR, 0, HEADER_HEIGHT-1, "%-22s%10d%-5s", config->GetEpocStartTime().c_str(), storageEngine->Size(), "");
+        // draw events in datastore to screen, lost events turn red once too many are lost
+        updateLostEvents();
+        windowPrintFillRight(headerWin, lostEventsWarning ? HEADER_WARNING_COLOR : HEADER_COLOR, 0, HEADER_HEIGHT-1, "%-22s%10d%-5s%10lu%-5s",
+            config->GetEpocStartTime().c_str(), storageEngine->Size(), "", lostEvents, "");
 
         // refresh entire window
         refreshScreen();
@@ -586,6 +667,7 @@ void Screen::shutdownScreen()
     delwin(detailWin);
     delwin(statWin);
     delwin(helpWin);
+    delwin(blockedWin);
 
     // delete all columns created
     timeStampColumn->~Column();
@@ -620,6 +702,7 @@ void Screen::initColors()
     init_pair(HIGHLIGHT_COLOR, COLOR_BLACK, COLOR_CYAN);
     init_pair(SEARCH_HIGHLIGHT_COLOR, COLOR_BLACK, COLOR_YELLOW);
     init_pair(MENU_COLOR_ERROR, COLOR_RED, LIGHT_BLUE);
+    init_pair(HEADER_WARNING_COLOR, COLOR_RED, COLOR_WHITE);
 }
 
 void Screen::initHeader()
@@ -643,7 +726,7 @@ void Screen::drawHeader()
     // set background of window
     wbkgdset(headerWin, COLOR_PAIR(HEADER_COLOR));
 
-    windowPrintFillRight(headerWin, HEADER_COLOR, 0, 0, "%-15s%10s%-5s", "Start Time:", "", "Total Events:");
+    windowPrintFillRight(headerWin, HEADER_COLOR, 0, 0, "%-15s%10s%-5s%15s", "Start Time:", "", "Total Events:", "Lost Events:");
 
     // move cursor to beginning of window
     wmove(headerWin, 0, 0);
@@ -658,6 +741,36 @@ void Screen::drawHeader()
     wrefresh(headerWin);
 }
 
+void Screen::updateLostEvents()
+{
+    ProcmonConfiguration * config = configPtr.get();
+
+    // a loaded trace file carries its own count
+    if(config->GetTraceFilePath().compare("") != 0)
+    {
+        lostEvents = config->GetStorage()->GetLostEvents();
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if(std::chrono::duration_cast<std::chrono::milliseconds>(now - lostEventsCheckTime).count() < 1000) return;
+    lostEventsCheckTime = now;
+
+    // look at the loss rate over the last second
+    lostEvents = config->GetTracer()->GetStats().lost;
+    int capturedEvents = config->GetStorage()->Size();
+    bool warning = LossRateExceeded(lostEvents - lostEventsChecked, capturedEvents - capturedEventsChecked);
+
+    if(warning && !lostEventsWarning)
+    {
+        LOG(WARNING) << "More than " << LOST_EVENTS_WARNING_PERCENT << "% of events are being lost, consider tightening the pid or syscall filters";
+    }
+
+    lostEventsWarning = warning;
+    lostEventsChecked = lostEvents;
+    capturedEventsChecked = capturedEvents;
+}
+
 void Screen::initFooter()
 {
     footerWin = newwin(FOOTER_HEIGHT, screenW, screenH - 1, FOOTER_X);
@@ -713,13 +826,20 @@ void Screen::drawFooterFkeys()
     wattron(footerWin, COLOR_PAIR(MENU_COLOR));
     wprintw(footerWin, " Export");
     wattron(footerWin, COLOR_PAIR(LINE_COLOR));
+    wprintw(footerWin, " F7");
+    wattron(footerWin, COLOR_PAIR(MENU_COLOR));
+    wprintw(footerWin, " Blocked");
     wattron(footerWin, COLOR_PAIR(LINE_COLOR));
     wprintw(footerWin, " F8");
     wattron(footerWin, COLOR_PAIR(MENU_COLOR));
     wprintw(footerWin, " Stats");
     wattron(footerWin, COLOR_PAIR(LINE_COLOR));
     wprintw(footerWin, " F9");
-    windowPrintFill(footerWin, MENU_COLOR, getcurx(footerWin), 0, " Quit");
+    wattron(footerWin, COLOR_PAIR(MENU_COLOR));
+    wprintw(footerWin, " Quit");
+    wattron(footerWin, COLOR_PAIR(LINE_COLOR));
+    wprintw(footerWin, " F10");
+    windowPrintFill(footerWin, MENU_COLOR, getcurx(footerWin), 0, " Trace");
 
     // refresh footer window
     wrefresh(footerWin);
@@ -751,6 +871,33 @@ void Screen::drawFilterPrompt(std::string filter)
     wrefresh(footerWin);
 }
 
+void Screen::drawTracePrompt(std::string command, std::string error)
+{
+    // move cursor to beginning of window
+    wmove(footerWin, 0, 0);
+
+    // add trace labels
+    wattron(footerWin, COLOR_PAIR(LINE_COLOR));
+    wprintw(footerWin, " Enter");
+    wattron(footerWin, COLOR_PAIR(MENU_COLOR));
+    wprintw(footerWin, " Apply");
+    wattron(footerWin, COLOR_PAIR(LINE_COLOR));
+    wprintw(footerWin, " Esc");
+    wattron(footerWin, COLOR_PAIR(MENU_COLOR));
+    wprintw(footerWin, " Cancel  ");
+    wattron(footerWin, COLOR_PAIR(LINE_COLOR));
+    wprintw(footerWin, "  ");
+    wattron(footerWin, COLOR_PAIR(MENU_COLOR));
+    wprintw(footerWin, " add|remove syscall|pid LIST: ");
+
+    // add trace prompt, followed by why the last command was refused
+    if(error.size() > 0) windowPrintFill(footerWin, MENU_COLOR_ERROR, getcurx(footerWin), 0, "%s  (%s)", command.c_str(), error.c_str());
+    else windowPrintFill(footerWin, MENU_COLOR, getcurx(footerWin), 0, "%s", command.c_str());
+
+    // refresh footer window
+    wrefresh(footerWin);
+}
+
 void Screen::drawSearchPrompt(std::string search, bool error)
 {
     // move cursor to beginning of window
@@ -867,6 +1014,21 @@ void Screen::initHelpView()
     hide_panel(helpPanel);
 }
 
+void Screen::initBlockedView()
+{
+    int blockedWindowHeight = DEFAULT_BLOCKED_VIEW_HEIGHT;
+    int blockedWindowWidth = screenW * 2 / 3;
+    int blockedWindow_Y = screenH / 4;
+    int blockedWindow_X = screenW / 6;
+
+    blockedWin = newwin(blockedWindowHeight, blockedWindowWidth, blockedWindow_Y, blockedWindow_X);
+    blockedPanel = new_panel(blockedWin);
+
+    blockedViewActive = false;
+
+    hide_panel(blockedPanel);
+}
+
 
 void Screen::initDetailView()
 {
@@ -1055,11 +1217,16 @@ void Screen::pageDown()
 EventFormatter* Screen::GetFormatter(ITelemetry lineData)
 {
     EventFormatter* ret = NULL;
+    const char* syscallName = SyscallNameForNumber(lineData.syscall);
+    if(syscallName == nullptr)
+    {
+        return ret;
+    }
 
     // Check to see if a formatter exists for this event
     for (std::vector<EventFormatter*>::iterator it = formatters.begin() ; it != formatters.end(); ++it)
     {
-        if((*it)->GetSyscall().compare(lineData.syscall)==0)
+        if((*it)->GetSyscall().compare(syscallName)==0)
         {
             ret=(*it);
             break;
@@ -1073,19 +1240,7 @@ EventFormatter* Screen::GetFormatter(ITelemetry lineData)
 int Screen::FindSyscall(std::string& syscallName)
 {
     ProcmonConfiguration* config = configPtr.get();
-    std::vector<struct SyscallSchema>& schema = config->GetSchema();
-
-    int i=0;
-    for(auto& syscall : schema)
-    {
-        if(syscallName.compare(syscall.syscallName)==0)
-        {
-            return i;
-        }
-        i++;
-    }
-
-    return -1;
+    return config->GetSchemaIndex(syscallName);
 }
 
 void Screen::addLine(ITelemetry lineData)
@@ -1140,6 +1295,7 @@ void Screen::refreshScreen()
     wnoutrefresh(columnWin);
     wnoutrefresh(statWin);
     wnoutrefresh(helpWin);
+    wnoutrefresh(blockedWin);
 
     // refresh columns
     timeStampColumn->refreshColumn();
@@ -1379,6 +1535,13 @@ void Screen::toggleColumnSort(ScreenConfiguration::sort selectedColumn)
 
 void Screen::showStatView()
 {
+    // in summary mode the stats come straight from the kernel aggregates
+    if(configPtr->tracerOptions.summary)
+    {
+        showSummaryStatView();
+        return;
+    }
+
     int y = 1;
     statViewActive = true;
 
@@ -1396,44 +1559,129 @@ void Screen::showStatView()
     // reset color
     wattron(statWin, COLOR_PAIR(LINE_COLOR));
 
-    std::map<std::string, std::tuple<int, uint64_t>> syscallHitMap = configPtr->GetStorage()->GetHitmap();
+    std::map<int, std::tuple<int, uint64_t>> syscallHitMap = configPtr->GetStorage()->GetHitmap();
 
-	typedef std::function<bool(std::pair<std::string, std::tuple<int, uint64_t>>, std::pair<std::string, std::tuple<int, uint64_t>>)> Comparator;
+	typedef std::function<bool(std::pair<int, std::tuple<int, uint64_t>>, std::pair<int, std::tuple<int, uint64_t>>)> Comparator;
 
 	Comparator compFunctor =
-			[](std::pair<std::string, std::tuple<int, uint64_t>> elem1 ,std::pair<std::string, std::tuple<int, uint64_t>> elem2)
+			[](std::pair<int, std::tuple<int, uint64_t>> elem1 ,std::pair<int, std::tuple<int, uint64_t>> elem2)
 			{
 				return std::get<1>(elem1.second) > std::get<1>(elem2.second);
 			};
 
-    std::set<std::pair<std::string, std::tuple<int, uint64_t>>, Comparator> sortedSyscalls(syscallHitMap.begin(), syscallHitMap.end(), compFunctor);
+    std::set<std::pair<int, std::tuple<int, uint64_t>>, Comparator> sortedSyscalls(syscallHitMap.begin(), syscallHitMap.end(), compFunctor);
 
-    std::set<std::pair<std::string, std::tuple<int, uint64_t>>>::iterator it;
+    std::set<std::pair<int, std::tuple<int, uint64_t>>>::iterator it;
     for (it = sortedSyscalls.begin(); it != sortedSyscalls.end() && (y-2) <= 10; ++it)
     {
         // convert to milliseconds
         double duration = ((double)std::get<1>(it->second)) / 1000000;
         if(duration < 1.0)
         {
-            windowPrintFill(statWin, LINE_COLOR, 1, y, " %-20s %-15d %.06f ms", it->first.c_str(), std::get<0>(it->second), duration);
+            windowPrintFill(statWin, LINE_COLOR, 1, y, " %-20s %-15d %.06f ms", Utils::GetSyscallName(it->first).c_str(), std::get<0>(it->second), duration);
         }
         else if (duration < 10.0)
         {
-            windowPrintFill(statWin, LINE_COLOR, 1, y, " %-20s %-15d %.02f ms", it->first.c_str(), std::get<0>(it->second), duration);
+            windowPrintFill(statWin, LINE_COLOR, 1, y, " %-20s %-15d %.02f ms", Utils::GetSyscallName(it->first).c_str(), std::get<0>(it->second), duration);
         }
         else
         {
-            windowPrintFill(statWin, LINE_COLOR, 1, y, " %-20s %-15d %.00f ms", it->first.c_str(), std::get<0>(it->second), duration);
+            windowPrintFill(statWin, LINE_COLOR, 1, y, " %-20s %-15d %.00f ms", Utils::GetSyscallName(it->first).c_str(), std::get<0>(it->second), duration);
         }
         y++;
     }
 
+    // counts above are scaled by the sample rate, show how much was left out
+    TracerStats stats = configPtr->GetTracer()->GetStats();
+    if(stats.sampledOut > 0 || stats.throttled > 0 || stats.inFlightFailed > 0 || stats.payloadDropped > 0)
+    {
+        windowPrintFill(statWin, LINE_COLOR, 1, DEFAULT_STAT_VIEW_HEIGHT - 2, " Sampled away: %lu  Throttled: %lu  In flight table full: %lu  Payloads over budget: %lu",
+            stats.sampledOut, stats.throttled, stats.inFlightFailed, stats.payloadDropped);
+    }
+
+    // draw border
+    box(statWin, '|', '_');
+
+    refreshScreen();
+}
+
+void Screen::showSummaryStatView()
+{
+    int y = 1;
+    statViewActive = true;
+
+    // move stat panel to front
+    panel_above(statPanel);
+
+    // print header
+    windowPrintFill(statWin, COLUMN_HEADER_COLOR, 1, y, " Top 10 Process Syscall Summary:");
+    y++;
+
+    // print column labels
+    windowPrintFill(statWin, LINE_COLOR, 1, y, " %-8s %-20s %-12s %-10s %-16s %s", "Pid:", "Syscall:", "Count:", "Errors:", "Total Duration:", "p99:");
+    y++;
+
+    // reset color
+    wattron(statWin, COLOR_PAIR(LINE_COLOR));
+
+    std::vector<SyscallSummary> summaries = configPtr->GetTracer()->GetSummary();
+    for (auto it = summaries.begin(); it != summaries.end() && (y-2) <= 10; ++it)
+    {
+        // convert to milliseconds
+        double duration = ((double)it->totalDuration) / 1000000;
+        std::string p99 = "<" + std::to_string(it->PercentileUs(99)) + " us";
+
+        windowPrintFill(statWin, LINE_COLOR, 1, y, " %-8d %-20s %-12lu %-10lu %-13.02f ms %s", it->pid, it->syscall.c_str(), it->count, it->errors, duration, p99.c_str());
+        y++;
+    }
+
     // draw border
     box(statWin, '|', '_');
 
     refreshScreen();
 }
 
+void Screen::showBlockedView()
+{
+    int y = 1;
+    blockedViewActive = true;
+
+    // move blocked panel to front
+    panel_above(blockedPanel);
+
+    // print header
+    windowPrintFill(blockedWin, COLUMN_HEADER_COLOR, 1, y, " Currently Blocked Syscalls:");
+    y++;
+
+    // print column labels
+    windowPrintFill(blockedWin, LINE_COLOR, 1, y, " %-8s %-8s %-16s %-16s %-14s %s", "Pid:", "Tid:", "Process:", "Syscall:", "Blocked For:", "Arguments:");
+    y++;
+
+    // reset color
+    wattron(blockedWin, COLOR_PAIR(LINE_COLOR));
+
+    std::vector<BlockedSyscall> blocked = configPtr->GetTracer()->GetBlockedSyscalls();
+    for (auto it = blocked.begin(); it != blocked.end() && y < DEFAULT_BLOCKED_VIEW_HEIGHT - 1; ++it)
+    {
+        // convert to milliseconds
+        double duration = ((double)it->blockedNs) / 1000000;
+
+        windowPrintFill(blockedWin, LINE_COLOR, 1, y, " %-8d %-8d %-16s %-16s %-11.02f ms %s", it->pid, it->tid, it->comm.c_str(), it->syscall.c_str(), duration, it->arguments.c_str());
+        y++;
+    }
+
+    // clear out rows left over from a longer list
+    for (; y < DEFAULT_BLOCKED_VIEW_HEIGHT - 1; y++)
+    {
+        windowPrintFill(blockedWin, LINE_COLOR, 1, y, " ");
+    }
+
+    // draw border
+    box(blockedWin, '|', '_');
+
+    refreshScreen();
+}
+
 void Screen::showHelpView()
 {
     int y = 1;
@@ -1456,10 +1704,13 @@ void Screen::showHelpView()
     windowPrintFill(helpWin, LINE_COLOR, 1, y, " %-35s %-15s", "F4: Filter event list", "F5: Suspend/resume event collection");
     y++;
 
-    windowPrintFill(helpWin, LINE_COLOR, 1, y, " %-35s %-15s", "F6: Export event list to file", "F8: Show stat of top syscalls");
+    windowPrintFill(helpWin, LINE_COLOR, 1, y, " %-35s %-15s", "F6: Export event list to file", "F7: Show currently blocked syscalls");
+    y++;
+
+    windowPrintFill(helpWin, LINE_COLOR, 1, y, " %-35s %-15s", "F8: Show stat of top syscalls", "F9: Quit");
     y++;
 
-    windowPrintFill(helpWin, LINE_COLOR, 1, y, " %-35s", "F9: Quit");
+    windowPrintFill(helpWin, LINE_COLOR, 1, y, " %-35s %-15s", "F10: Add/remove traced syscalls and pids", "");
     y++;
 
     box(helpWin, '|', '_');
@@ -1484,6 +1735,22 @@ void Screen::closeStatView()
     refreshScreen();
 }
 
+void Screen::closeBlockedView()
+{
+    // toggle blocked view control
+    blockedViewActive = false;
+
+    // hide panel to remove from screen
+    hide_panel(blockedPanel);
+
+    // reprint footer
+    drawFooterFkeys();
+
+    // redraw & refresh screen
+    redrawScreen();
+    refreshScreen();
+}
+
 void Screen::closeHelpView()
 {
     // toggle help view control
@@ -1538,8 +1805,17 @@ void Screen::showDetailView()
     mvwprintw(detailWin, y++, 2, "%-19s%s", "Timestamp:", format->GetTimestamp(*event).c_str());
     mvwprintw(detailWin, y++, 2, "%-20s%s", "PID:", format->GetPID(*event).c_str());
     mvwprintw(detailWin, y++, 2, "%-20s%s", "Process:", format->GetProcess(*event).c_str());
+    if(event->process)
+    {
+        if(event->process->ppid != 0) mvwprintw(detailWin, y++, 2, "%-20s%d", "Parent PID:", event->process->ppid);
+        mvwprintw(detailWin, y++, 2, "%-20s%u", "User:", event->process->uid);
+        if(!event->process->exe.empty()) mvwprintw(detailWin, y++, 2, "%-20s%s", "Image:", event->process->exe.c_str());
+        if(!event->process->argv.empty()) mvwprintw(detailWin, y++, 2, "%-20s%s", "Command Line:", event->process->CommandLine().c_str());
+        if(!event->process->cgroup.empty()) mvwprintw(detailWin, y++, 2, "%-20s%s", "Cgroup:", event->process->cgroup.c_str());
+    }
     mvwprintw(detailWin, y++, 2, "%-20s%s", "Syscall:", format->GetOperation(*event).c_str());
     mvwprintw(detailWin, y++, 2, "%-20s%s", "Arguments:", format->GetDetails(*event).c_str());
+    if(!event->address.empty()) mvwprintw(detailWin, y++, 2, "%-20s%s", "Address:", event->address.c_str());
     mvwprintw(detailWin, y++, 2, "%-20s%s", "Result:", format->GetResult(*event).c_str());
 
     mvwprintw(detailWin, y++, 2, "%-20s%llu ns", "Duration:", format->GetDuration(*event).c_str());
@@ -1551,6 +1827,15 @@ void Screen::showDetailView()
     // Resolve symbols
     if(ResolveSymbols(eventTrace, event->pid))
     {
+        if(eventTrace->kernelIPs.size() > 0)
+        {
+            mvwprintw(detailWin, y++, 2, "Kernel Stack:");
+            for(int i = 0; i < eventTrace->kernelIPs.size() && y < detailViewHeight - 1; i++)
+            {
+                mvwprintw(detailWin, y++, 4, "0x%-16lx %s", eventTrace->kernelIPs[i], eventTrace->kernelSymbols[i].c_str());
+            }
+        }
+
         mvwprintw(detailWin, y++, 2, "Stack Trace:");
         // add stack trace to window
         for(int i = 0; i < eventTrace->userIPs.size() && y < detailViewHeight - 1; i++)
@@ -1610,6 +1895,32 @@ bool Screen::ResolveSymbols(StackTrace* stack, pid_t pid)
         }
     }
 
+    if (stack->kernelIPs.size() > 0)
+    {
+        // kallsyms is loaded once and shared by all processes. The bcc kernel
+        // symbol cache keeps it sorted by address and resolves each frame
+        // with a binary search, so there is no need for a table of our own
+        if (kernelSymResolver == NULL)
+        {
+            kernelSymResolver = bcc_symcache_new(-1, NULL);
+        }
+
+        stack->kernelSymbols.clear();
+        for (int i = 0; i < stack->kernelIPs.size(); i++)
+        {
+            if (bcc_symcache_resolve_no_demangle(kernelSymResolver, stack->kernelIPs[i], &symbol) != 0)
+            {
+                stack->kernelSymbols.push_back("[UNKNOWN]");
+            }
+            else
+            {
+                std::stringstream ss;
+                ss << symbol.name << "+0x" << std::hex << symbol.offset;
+                stack->kernelSymbols.push_back(ss.str());
+            }
+        }
+    }
+
     return true;
 }
 
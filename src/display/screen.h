@@ -28,6 +28,7 @@
 #define NCURSES_OK 0
 
 #include <panel.h>
+#include <chrono>
 #include <vector>
 #include <unordered_map>
 
@@ -51,6 +52,7 @@
 #define DEFAULT_COLUMN_VIEW_HEIGHT  10
 #define DEFAULT_STAT_VIEW_HEIGHT    15
 #define DEFAULT_HELP_VIEW_HEIGHT    15
+#define DEFAULT_BLOCKED_VIEW_HEIGHT 15
 
 // default column sizes
 #define DEFAULT_TIME_COL_WIDTH      15
@@ -81,6 +83,7 @@
 #define DETAIL_VIEW_BACKGROUND_COLOR    6
 #define SEARCH_HIGHLIGHT_COLOR          7
 #define MENU_COLOR_ERROR                8
+#define HEADER_WARNING_COLOR            9
 
 // default colors
 #define LIGHT_BLUE  33
@@ -124,6 +127,13 @@ class Screen {
         // event variables
         int totalEvents;
 
+        // lost event variables, refreshed once a second
+        uint64_t lostEvents = 0;
+        uint64_t lostEventsChecked = 0;
+        int capturedEventsChecked = 0;
+        bool lostEventsWarning = false;
+        std::chrono::steady_clock::time_point lostEventsCheckTime;
+
         // detail view dimensions
         int detailViewHeight;
         int detailViewWidth;
@@ -142,10 +152,13 @@ class Screen {
         bool searchPromptActive;
         int searchCount;
         std::string filter;
+        bool tracePromptActive;
+        std::string traceCommand;
         bool columnSortViewActive;
         int columnSortLineSelection;
         bool statViewActive;
         bool helpViewActive;
+        bool blockedViewActive;
 
         // ncurses windows
         WINDOW* root;
@@ -155,6 +168,7 @@ class Screen {
         WINDOW* columnWin;
         WINDOW* statWin;
         WINDOW* helpWin;
+        WINDOW* blockedWin;
 
         // columns
         Column* timeStampColumn;
@@ -175,6 +189,7 @@ class Screen {
         PANEL* columnPanel;
         PANEL* statPanel;
         PANEL* helpPanel;
+        PANEL* blockedPanel;
 
         // screen data
         std::vector<ITelemetry> eventList;
@@ -182,6 +197,7 @@ class Screen {
 
         // Symbol resolution
         std::unordered_map<int, void*> symEnginePidMap;
+        void* kernelSymResolver = NULL;
         bcc_symbol_option SymbolOption = {.use_debug_file = 1,
                                         .check_debug_file_crc = 1,
                                         .lazy_symbolize = 1,
@@ -202,6 +218,7 @@ class Screen {
         // Header Functions
         void initHeader();
         void drawHeader();
+        void updateLostEvents();
         void resizeHeader();
 
         // Footer Functions
@@ -212,12 +229,14 @@ class Screen {
         // Footer View Functions
         void drawFilterPrompt(std::string filter);
         void drawSearchPrompt(std::string search, bool error);
+        void drawTracePrompt(std::string command, std::string error);
 
         // View Initializers
         void initDetailView();
         void initColumnView();
         void initStatView();
         void initHelpView();
+        void initBlockedView();
 
         // Column Initializers
         void initTimestampColumn();
@@ -261,7 +280,10 @@ class Screen {
         void showColumnView();
         void closeColumnView();
         void showStatView();
+        void showSummaryStatView();
         void closeStatView();
+        void showBlockedView();
+        void closeBlockedView();
 
         // Mouse Helper Functions
         void handleMouseEvent(MEVENT* event);
@@ -18,16 +18,20 @@ extern char _binary_procmonEBPFkern5_2_o_start[];
 extern char _binary_procmonEBPFkern5_2_o_end[];
 extern char _binary_procmonEBPFkern5_3_5_5_o_start[];
 extern char _binary_procmonEBPFkern5_3_5_5_o_end[];
-extern char _binary_procmonEBPFkern5_6__o_start[];
-extern char _binary_procmonEBPFkern5_6__o_end[];
+extern char _binary_procmonEBPFkern5_6_5_7_o_start[];
+extern char _binary_procmonEBPFkern5_6_5_7_o_end[];
+extern char _binary_procmonEBPFkern5_8__o_start[];
+extern char _binary_procmonEBPFkern5_8__o_end[];
 extern char _binary_procmonEBPFkern4_17_5_1_core_o_start[];
 extern char _binary_procmonEBPFkern4_17_5_1_core_o_end[];
 extern char _binary_procmonEBPFkern5_2_core_o_start[];
 extern char _binary_procmonEBPFkern5_2_core_o_end[];
 extern char _binary_procmonEBPFkern5_3_5_5_core_o_start[];
 extern char _binary_procmonEBPFkern5_3_5_5_core_o_end[];
-extern char _binary_procmonEBPFkern5_6__core_o_start[];
-extern char _binary_procmonEBPFkern5_6__core_o_end[];
+extern char _binary_procmonEBPFkern5_6_5_7_core_o_start[];
+extern char _binary_procmonEBPFkern5_6_5_7_core_o_end[];
+extern char _binary_procmonEBPFkern5_8__core_o_start[];
+extern char _binary_procmonEBPFkern5_8__core_o_end[];
 
 //--------------------------------------------------------------------
 //
@@ -66,9 +70,18 @@ bool ExtractEBPFPrograms()
             return false;
         }
 
-    if (!dropFile(PROCMON_EBPF_INSTALL_DIR "/" KERN_5_6__OBJ,
-        _binary_procmonEBPFkern5_6__o_start,
-        _binary_procmonEBPFkern5_6__o_end,
+    if (!dropFile(PROCMON_EBPF_INSTALL_DIR "/" KERN_5_6_5_7_OBJ,
+        _binary_procmonEBPFkern5_6_5_7_o_start,
+        _binary_procmonEBPFkern5_6_5_7_o_end,
+        true,
+        fileMode))
+        {
+            return false;
+        }
+
+    if (!dropFile(PROCMON_EBPF_INSTALL_DIR "/" KERN_5_8__OBJ,
+        _binary_procmonEBPFkern5_8__o_start,
+        _binary_procmonEBPFkern5_8__o_end,
         true,
         fileMode))
         {
@@ -102,9 +115,18 @@ bool ExtractEBPFPrograms()
             return false;
         }
 
-    if (!dropFile(PROCMON_EBPF_INSTALL_DIR "/" KERN_5_6__CORE_OBJ,
-        _binary_procmonEBPFkern5_6__core_o_start,
-        _binary_procmonEBPFkern5_6__core_o_end,
+    if (!dropFile(PROCMON_EBPF_INSTALL_DIR "/" KERN_5_6_5_7_CORE_OBJ,
+        _binary_procmonEBPFkern5_6_5_7_core_o_start,
+        _binary_procmonEBPFkern5_6_5_7_core_o_end,
+        true,
+        fileMode))
+        {
+            return false;
+        }
+
+    if (!dropFile(PROCMON_EBPF_INSTALL_DIR "/" KERN_5_8__CORE_OBJ,
+        _binary_procmonEBPFkern5_8__core_o_start,
+        _binary_procmonEBPFkern5_8__core_o_end,
         true,
         fileMode))
         {
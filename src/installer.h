@@ -25,13 +25,15 @@
 #define KERN_4_17_5_1_OBJ       "procmonEBPFkern4.17-5.1.o"
 #define KERN_5_2_OBJ            "procmonEBPFkern5.2.o"
 #define KERN_5_3_5_5_OBJ        "procmonEBPFkern5.3-5.5.o"
-#define KERN_5_6__OBJ           "procmonEBPFkern5.6-.o"
+#define KERN_5_6_5_7_OBJ        "procmonEBPFkern5.6-5.7.o"
+#define KERN_5_8__OBJ           "procmonEBPFkern5.8-.o"
 #define KERN_4_15_CORE_OBJ      "procmonEBPFkern4.15_core.o"
 #define KERN_4_16_CORE_OBJ      "procmonEBPFkern4.16_core.o"
 #define KERN_4_17_5_1_CORE_OBJ  "procmonEBPFkern4.17-5.1_core.o"
 #define KERN_5_2_CORE_OBJ       "procmonEBPFkern5.2_core.o"
 #define KERN_5_3_5_5_CORE_OBJ   "procmonEBPFkern5.3-5.5_core.o"
-#define KERN_5_6__CORE_OBJ      "procmonEBPFkern5.6-_core.o"
+#define KERN_5_6_5_7_CORE_OBJ   "procmonEBPFkern5.6-5.7_core.o"
+#define KERN_5_8__CORE_OBJ      "procmonEBPFkern5.8-_core.o"
 
 bool ExtractEBPFPrograms();
 bool DeleteEBPFPrograms();
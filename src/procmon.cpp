@@ -84,7 +84,11 @@ int main(int argc, char *argv[])
         Headless headlessDisplay;
 
         // init headless interface
-        headlessDisplay.initialize(config);
+        if(!headlessDisplay.initialize(config))
+        {
+            DeleteEBPFPrograms();
+            CLIUtils::FastExit();
+        }
 
         // run in headless mode
         headlessDisplay.run();
@@ -24,18 +24,18 @@ std::vector<MockTelemetry> MockStorageEngine::QueryByPid(pid_t pid, const std::v
     return (search != _dataStore.end()) ? search->second : std::vector<MockTelemetry> {};
 }
 
-bool MockStorageEngine::Store(MockTelemetry data)
+bool MockStorageEngine::Store(const MockTelemetry& data)
 {
     std::lock_guard<std::mutex> guard(_mapLock);
     _dataStore[data.pid].push_back(data);
     return true;
 }
 
-bool MockStorageEngine::StoreMany(std::vector<MockTelemetry> data)
+bool MockStorageEngine::StoreMany(const MockTelemetry* data, size_t count)
 {
-    for (auto& datum : data)
+    for (size_t i = 0; i < count; i++)
     {
-        Store(datum);
+        Store(data[i]);
     }
     return true;
 }
@@ -60,8 +60,9 @@ public:
         std::string search, std::vector<pid_t> pids, ScreenConfiguration::sort orderBy, bool asc, const std::vector<Event>& syscalls = {}) override;
 
     // Store API
-    bool Store(MockTelemetry data) override;
-    bool StoreMany(std::vector<MockTelemetry> data) override;
+    using IStorageEngine::StoreMany;
+    bool Store(const MockTelemetry& data) override;
+    bool StoreMany(const MockTelemetry* data, size_t count) override;
     int Size() override { return 0; };
 
     // Load API
@@ -17,40 +17,67 @@
 #include <algorithm>
 #include <functional>
 #include <bits/stdc++.h>
+#include <malloc.h>
 
 #include "sqlite3_storage_engine.h"
+#include "../tracer/ebpf/syscalls.h"
 
 #define SQL_CREATE_EBPF             "CREATE TABLE IF NOT EXISTS ebpf (    \
                                         pid INT,                          \
-                                        stacktrace TEXT,                  \
+                                        stackid INTEGER,                  \
+                                        processid INTEGER,                \
                                         comm TEXT,                        \
-                                        processname TEXT,                 \
                                         resultcode INTEGER,               \
                                         timestamp INTEGER,                \
-                                        syscall TEXT,                     \
+                                        syscall INTEGER,                  \
                                         duration INTEGER,                 \
-                                        arguments BLOB                    \
+                                        arguments BLOB,                   \
+                                        samplerate INTEGER,               \
+                                        strings BLOB,                     \
+                                        payload BLOB,                     \
+                                        address TEXT                      \
+                                    );"
+#define SQL_CREATE_STACKS           "CREATE TABLE IF NOT EXISTS stacks (  \
+                                        id INTEGER PRIMARY KEY,           \
+                                        stacktrace TEXT                   \
+                                    );"
+#define SQL_CREATE_PROCESSES        "CREATE TABLE IF NOT EXISTS processes ( \
+                                        id INTEGER PRIMARY KEY,             \
+                                        tgid INT,                           \
+                                        ppid INT,                           \
+                                        starttime INTEGER,                  \
+                                        uid INT,                            \
+                                        processname TEXT,                   \
+                                        exe TEXT,                           \
+                                        argv BLOB,                          \
+                                        cgroup TEXT                         \
                                     );"
 #define SQL_CREATE_METADATA         "CREATE TABLE IF NOT EXISTS metadata (  \
                                         startTime INT,                      \
-                                        startEpocTime TEXT                  \
+                                        startEpocTime TEXT,                 \
+                                        lostEvents INTEGER                  \
                                     );"
 #define SQL_CREATE_STATS            "CREATE TABLE IF NOT EXISTS stats ( \
-                                        syscall TEXT,                   \
+                                        syscall INTEGER,                \
                                         count INTEGER,                  \
                                         duration INTEGER                \
                                     );"
-#define SQL_SELECT_STARTTIME        "SELECT startTime, startEpocTime from metadata"
+#define SQL_SELECT_STARTTIME        "SELECT startTime, startEpocTime, lostEvents from metadata"
 #define SQL_SELECT_STATS            "SELECT * FROM stats ORDER BY count LIMIT 10"
-#define SQL_INSERT_METADATA         "INSERT into metadata (startTime, startEpocTime) VALUES (?, ?)"
+#define SQL_INSERT_METADATA         "INSERT into metadata (startTime, startEpocTime, lostEvents) VALUES (?, ?, ?)"
 #define SQL_INSERT_STATS            "INSERT into stats (syscall, count, duration) VALUES (?, ?, ?)"
+#define SQL_INSERT_STACK            "INSERT into stacks (id, stacktrace) VALUES (?, ?)"
+#define SQL_INSERT_PROCESS          "INSERT into processes (id, tgid, ppid, starttime, uid, processname, exe, argv, cgroup) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)"
+#define SQL_HAS_TABLE(name)         "SELECT name FROM sqlite_master WHERE type='table' AND name='" name "'"
 #define SQL_CLEAR_EBPF              "DELETE FROM ebpf"
 #define SQL_INITDB                  ":memory:"
 #define SQL_DELIMITER               ", "
-#define SQL_SELECT                  "SELECT pid, stacktrace, comm, processname, resultcode, timestamp, syscall, duration, arguments FROM ebpf"
+#define SQL_SELECT                  "SELECT pid, stacks.stacktrace AS stacktrace, COALESCE(comm, processname) AS comm, processname, ppid, uid, starttime, exe, argv, cgroup, \
+                                        resultcode, timestamp, syscall, duration, arguments, samplerate, strings, payload, address \
+                                        FROM ebpf LEFT JOIN stacks ON ebpf.stackid = stacks.id LEFT JOIN processes ON ebpf.processid = processes.id"
 #define SQL_SELECT_ID               "SELECT * FROM "
 #define SQL_SELECT_ROWNUM(orderBy, asc) "SELECT ROW_NUMBER() OVER (ORDER BY " + orderBy + " " + asc
-#define SQL_SELECT_ROWNUM_END       ") rownum, pid, processname, syscall, duration, resultcode FROM ebpf"
+#define SQL_SELECT_ROWNUM_END       ") rownum, pid, processname, syscall, duration, resultcode, strings, address FROM ebpf LEFT JOIN processes ON ebpf.processid = processes.id"
 #define SQL_WHERE                   " WHERE "
 #define SQL_CONTAIN_PID             "pid IN ("
 #define SQL_CONTAIN_RESULTCODE      "resultcode IN ("
@@ -60,13 +87,17 @@
 #define SQL_CONTAIN_END             ")"
 #define SQL_FILTER_TEXT(target)     " pid LIKE '%" + target + \
                                     "%' OR processname LIKE '%" + target + \
-                                    "%' OR syscall LIKE '%" + target + \
+                                    "%' OR " SQL_SYSCALL_NAME " LIKE '%" + target + \
                                     "%' OR duration LIKE '%" + target + \
-                                    "%' OR resultcode LIKE '%" + target + "%'"
+                                    "%' OR resultcode LIKE '%" + target + \
+                                    "%' OR instr(lower(strings), lower('" + target + \
+                                    "')) > 0 OR address LIKE '%" + target + "%'"
+// Syscalls are stored as their number, this is their name for filtering and sorting
+#define SQL_SYSCALL_NAME            "syscall_name(syscall)"
 #define SQL_BETWEEN_TIME            "timestamp BETWEEN "
 #define SQL_PAGINATE(offset, limit) " LIMIT " + std::to_string(limit) + " OFFSET " + std::to_string(offset)
-#define SQL_INSERT                  "INSERT INTO ebpf (pid, stacktrace, comm, processname, resultcode, timestamp, syscall, duration, arguments) \
-                                        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)"
+#define SQL_INSERT                  "INSERT INTO ebpf (pid, stackid, processid, comm, resultcode, timestamp, syscall, duration, arguments, samplerate, strings, payload, address) \
+                                        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)"
 #define SQL_TX_START                "BEGIN TRANSACTION"
 #define SQL_TX_END                  "END TRANSACTION"
 #define SQL_TX_ROLLBACK             "ROLLBACK TRANSACTION"
@@ -76,6 +107,62 @@
 #define SQL_DESCENDING              " DESC "
 #define SQL_END                     ";"
 
+// Lists of strings, string arguments and argv, are stored as a BLOB of the
+// strings each NUL terminated, so they can hold any other character. LIKE
+// stops at the first NUL, hence the instr filter on them above.
+#define SQL_STRINGS_TERMINATOR      '\0'
+
+// Trace files recorded before stacks and processes were stored once keep the
+// stack and process name inline in each ebpf row, the syscall name rather than
+// its number and have no lost event count
+#define SQL_ATTACH_LEGACY           "ATTACH DATABASE ? AS legacy"
+#define SQL_MIGRATE_LEGACY          "BEGIN TRANSACTION;                                                                   \
+                                    INSERT INTO stacks (stacktrace) SELECT DISTINCT stacktrace FROM legacy.ebpf         \
+                                        WHERE stacktrace IS NOT NULL AND stacktrace != '';                               \
+                                    CREATE INDEX legacy_stacks ON stacks (stacktrace);                                   \
+                                    INSERT INTO processes (tgid, processname) SELECT DISTINCT pid, processname FROM legacy.ebpf; \
+                                    CREATE INDEX legacy_processes ON processes (tgid, processname);                      \
+                                    INSERT INTO ebpf (pid, stackid, processid, comm, resultcode, timestamp, syscall, duration, arguments, samplerate) \
+                                        SELECT e.pid, s.id, p.id, e.comm, e.resultcode, e.timestamp, syscall_number(e.syscall), e.duration, e.arguments, 1 \
+                                        FROM legacy.ebpf e LEFT JOIN stacks s ON s.stacktrace = e.stacktrace              \
+                                        LEFT JOIN processes p ON p.tgid = e.pid AND p.processname IS e.processname;      \
+                                    DROP INDEX legacy_stacks;                                                            \
+                                    DROP INDEX legacy_processes;                                                         \
+                                    INSERT INTO metadata (startTime, startEpocTime, lostEvents)                          \
+                                        SELECT startTime, startEpocTime, 0 FROM legacy.metadata;                         \
+                                    INSERT INTO stats (syscall, count, duration) SELECT syscall_number(syscall), count, duration FROM legacy.stats; \
+                                    END TRANSACTION;                                                                     \
+                                    DETACH DATABASE legacy;"
+
+/**
+ * SQL function syscall_name(number), the name of a syscall number or NULL.
+ */
+static void syscallNameFunction(sqlite3_context* context, int argc, sqlite3_value** argv)
+{
+    const char* name = nullptr;
+    if (sqlite3_value_type(argv[0]) == SQLITE_INTEGER)
+        name = SyscallNameForNumber(sqlite3_value_int(argv[0]));
+
+    if (name == nullptr)
+        sqlite3_result_null(context);
+    else
+        sqlite3_result_text(context, name, -1, SQLITE_STATIC);
+}
+
+/**
+ * SQL function syscall_number(name), the number of a syscall name or NULL.
+ */
+static void syscallNumberFunction(sqlite3_context* context, int argc, sqlite3_value** argv)
+{
+    const char* name = reinterpret_cast<const char*>(sqlite3_value_text(argv[0]));
+    int number = name != nullptr ? SyscallNumberForName(name) : -1;
+
+    if (number < 0)
+        sqlite3_result_null(context);
+    else
+        sqlite3_result_int(context, number);
+}
+
 Sqlite3StorageEngine::~Sqlite3StorageEngine()
 {
     telemetryCount = 0;
@@ -83,6 +170,26 @@ Sqlite3StorageEngine::~Sqlite3StorageEngine()
     sqlite3_close(dbConnection);
 }
 
+/**
+ * Internal helper method that registers the syscall_name and syscall_number SQL
+ * functions on a database connection.
+ *
+ * Pre:
+ *  The database connection is open.
+ *
+ * Post:
+ *  Statements on the connection can convert between syscall numbers and names.
+ */
+bool Sqlite3StorageEngine::registerSyscallFunctions(sqlite3* db)
+{
+    auto rc = sqlite3_create_function(db, "syscall_name", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr, syscallNameFunction, nullptr, nullptr);
+    if (rc != SQLITE_OK)
+        return false;
+
+    rc = sqlite3_create_function(db, "syscall_number", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr, syscallNumberFunction, nullptr, nullptr);
+    return rc == SQLITE_OK;
+}
+
 /**
  * Initializes the Sqlite3 backend connection in serialized threading mode.
  *
@@ -104,12 +211,25 @@ bool Sqlite3StorageEngine::Initialize(const std::vector<Event>& syscalls)
     if (rc != SQLITE_OK)
         return false;
 
+    if (!registerSyscallFunctions(dbConnection))
+        return false;
+
     // We only create a single table for all events since there is no expected
     // perf gains by using a separate table for each syscall.
     rc = sqlite3_exec(dbConnection, SQL_CREATE_EBPF, 0, 0, nullptr);
     if (rc != SQLITE_OK)
         return false;
 
+    // Stacks are stored once and referenced from the ebpf table by id
+    rc = sqlite3_exec(dbConnection, SQL_CREATE_STACKS, 0, 0, nullptr);
+    if (rc != SQLITE_OK)
+        return false;
+
+    // Processes are stored once and referenced from the ebpf table by id
+    rc = sqlite3_exec(dbConnection, SQL_CREATE_PROCESSES, 0, 0, nullptr);
+    if (rc != SQLITE_OK)
+        return false;
+
     // Create metadata table for traces
     rc = sqlite3_exec(dbConnection, SQL_CREATE_METADATA, 0, 0, nullptr);
     if (rc != SQLITE_OK)
@@ -128,6 +248,56 @@ bool Sqlite3StorageEngine::Initialize(const std::vector<Event>& syscalls)
     return ready;
 }
 
+/**
+ * Internal helper method that packs a list of strings into the layout of the strings and
+ * argv columns, each string followed by SQL_STRINGS_TERMINATOR.
+ *
+ * Pre:
+ *  None of the strings contain SQL_STRINGS_TERMINATOR.
+ *
+ * Post:
+ *  unpackStrings on the returned value gives back the same strings.
+ *
+ */
+std::string Sqlite3StorageEngine::packStrings(const std::vector<std::string>& strings)
+{
+    std::string packed;
+    for (const auto& string : strings)
+    {
+        packed += string;
+        packed += SQL_STRINGS_TERMINATOR;
+    }
+
+    return packed;
+}
+
+/**
+ * Internal helper method that unpacks the strings stored by packStrings in the given
+ * column of the current row, appending them to strings. A NULL column holds none.
+ *
+ * Pre:
+ *  The given SQL statement has just been stepped to a row.
+ *
+ * Post:
+ *  Being only a retrieval, database should not be changed.
+ *
+ */
+void Sqlite3StorageEngine::unpackStrings(sqlite3_stmt* preppedSqlStmt, int column, std::vector<std::string>& strings)
+{
+    const char* packed = reinterpret_cast<const char*>(sqlite3_column_blob(preppedSqlStmt, column));
+    int size = sqlite3_column_bytes(preppedSqlStmt, column);
+    if (packed == NULL)
+        return;
+
+    const char* end = packed + size;
+    while (packed < end)
+    {
+        const char* terminator = std::find(packed, end, SQL_STRINGS_TERMINATOR);
+        strings.emplace_back(packed, terminator);
+        packed = terminator + 1;
+    }
+}
+
 /**
  * Internal helper method that parses a prepared SQL statement immediately after a sql
  * statement step call. This is done column by column and the extracted values are used
@@ -149,13 +319,21 @@ ITelemetry Sqlite3StorageEngine::parseSqlite3Row(sqlite3_stmt *preppedSqlStmt)
         .stackTrace = {},
         .comm = "",
         .processName = "",
-        .syscall = "",
+        .syscall = -1,
         .result = 0,
         .duration = 0,
         .arguments = NULL,
-        .timestamp = 0
+        .timestamp = 0,
+        .sampleRate = 1,
+        .strings = {},
+        .payload = {},
+        .address = "",
+        .process = {},
+        .argumentsBuffer = {}
     };
 
+    auto process = std::make_shared<ProcessInfo>();
+
     int columnCount = sqlite3_column_count(preppedSqlStmt);
     for (int i = 0; i < columnCount; i++)
     {
@@ -163,6 +341,7 @@ ITelemetry Sqlite3StorageEngine::parseSqlite3Row(sqlite3_stmt *preppedSqlStmt)
         if (columnName == "pid")
         {
             datam.pid = sqlite3_column_int(preppedSqlStmt, i);
+            process->pid = datam.pid;
         }
         else if (columnName == "stacktrace")
         {
@@ -185,13 +364,43 @@ ITelemetry Sqlite3StorageEngine::parseSqlite3Row(sqlite3_stmt *preppedSqlStmt)
             if (processName == NULL)
                 continue;
             datam.processName = std::string(processName);
+            process->name = datam.processName;
+        }
+        else if (columnName == "ppid")
+        {
+            process->ppid = sqlite3_column_int(preppedSqlStmt, i);
+        }
+        else if (columnName == "uid")
+        {
+            process->uid = sqlite3_column_int(preppedSqlStmt, i);
+        }
+        else if (columnName == "starttime")
+        {
+            process->startTime = sqlite3_column_int64(preppedSqlStmt, i);
+        }
+        else if (columnName == "exe")
+        {
+            const char* exe = reinterpret_cast<const char*>(sqlite3_column_text(preppedSqlStmt, i));
+            if (exe == NULL)
+                continue;
+            process->exe = std::string(exe);
+        }
+        else if (columnName == "argv")
+        {
+            unpackStrings(preppedSqlStmt, i, process->argv);
+        }
+        else if (columnName == "cgroup")
+        {
+            const char* cgroup = reinterpret_cast<const char*>(sqlite3_column_text(preppedSqlStmt, i));
+            if (cgroup == NULL)
+                continue;
+            process->cgroup = std::string(cgroup);
         }
         else if (columnName == "syscall")
         {
-            const char* syscall = reinterpret_cast<const char*>(sqlite3_column_text(preppedSqlStmt, i));
-            if (syscall == NULL)
+            if (sqlite3_column_type(preppedSqlStmt, i) == SQLITE_NULL)
                 continue;
-            datam.syscall = std::string(syscall);
+            datam.syscall = sqlite3_column_int(preppedSqlStmt, i);
         }
         else if (columnName == "resultcode")
         {
@@ -209,15 +418,43 @@ ITelemetry Sqlite3StorageEngine::parseSqlite3Row(sqlite3_stmt *preppedSqlStmt)
 
             // Interestingly enough, if we don't copy the blob we get back from sqlite it can eventually
             // reuse that memory buffer and change the contents of the record.
-            datam.arguments = (unsigned char*) malloc(MAX_BUFFER);
-            memcpy(datam.arguments, arguments, MAX_BUFFER);
+            std::shared_ptr<unsigned char[]> buffer(new unsigned char[MAX_BUFFER]);
+            memcpy(buffer.get(), arguments, MAX_BUFFER);
+            datam.arguments = buffer.get();
+            datam.argumentsBuffer = buffer;
         }
         else if (columnName == "timestamp")
         {
             datam.timestamp = sqlite3_column_int64(preppedSqlStmt, i);
         }
+        else if (columnName == "samplerate")
+        {
+            int sampleRate = sqlite3_column_int(preppedSqlStmt, i);
+            datam.sampleRate = sampleRate > 0 ? sampleRate : 1;
+        }
+        else if (columnName == "strings")
+        {
+            unpackStrings(preppedSqlStmt, i, datam.strings);
+        }
+        else if (columnName == "payload")
+        {
+            const uint8_t* payload = reinterpret_cast<const uint8_t*>(sqlite3_column_blob(preppedSqlStmt, i));
+            if (payload == NULL)
+                continue;
+
+            datam.payload.assign(payload, payload + sqlite3_column_bytes(preppedSqlStmt, i));
+        }
+        else if (columnName == "address")
+        {
+            const char* address = reinterpret_cast<const char*>(sqlite3_column_text(preppedSqlStmt, i));
+            if (address == NULL)
+                continue;
+            datam.address = std::string(address);
+        }
     }
 
+    datam.process = process;
+
     return datam;
 }
 
@@ -425,7 +662,7 @@ std::string Sqlite3StorageEngine::addSyscallFilterToSQLQuery(const std::string i
             {
                 if (i != 0)
                     delimitedSyscalls += SQL_DELIMITER;
-                delimitedSyscalls += "'" + difference[i].Name() + "'";
+                delimitedSyscalls += std::to_string(SyscallNumberForName(difference[i].Name()));
             }
         }
         else
@@ -435,7 +672,7 @@ std::string Sqlite3StorageEngine::addSyscallFilterToSQLQuery(const std::string i
             {
                 if (i != 0)
                     delimitedSyscalls += SQL_DELIMITER;
-                delimitedSyscalls += "'" + events[i].Name() + "'";
+                delimitedSyscalls += std::to_string(SyscallNumberForName(events[i].Name()));
             }
         }
         resultingQuery += delimitedSyscalls;
@@ -626,7 +863,7 @@ std::vector<ITelemetry> Sqlite3StorageEngine::QueryByEventsinPage(
             raw_sql_statement += ", timestamp ASC";
             break;
         case ScreenConfiguration::operation:
-            raw_sql_statement += "syscall";
+            raw_sql_statement += SQL_SYSCALL_NAME;
             raw_sql_statement += (asc) ? SQL_ASCENDING : SQL_DESCENDING;
             raw_sql_statement += ", timestamp ASC";
             break;
@@ -695,7 +932,7 @@ std::vector<ITelemetry> Sqlite3StorageEngine::QueryByFilteredEventsinPage(
             raw_sql_statement += ", timestamp ASC";
             break;
         case ScreenConfiguration::operation:
-            raw_sql_statement += "syscall";
+            raw_sql_statement += SQL_SYSCALL_NAME;
             raw_sql_statement += (asc) ? SQL_ASCENDING : SQL_DESCENDING;
             raw_sql_statement += ", timestamp ASC";
             break;
@@ -749,7 +986,7 @@ std::vector<int> Sqlite3StorageEngine::QueryIdsBySearch(
             raw_select_sql_statement += ", timestamp ASC";
             break;
         case ScreenConfiguration::operation:
-            raw_select_sql_statement += (asc) ? SQL_SELECT_ROWNUM(std::string("syscall"), SQL_ASCENDING) : SQL_SELECT_ROWNUM(std::string("syscall"), SQL_DESCENDING);
+            raw_select_sql_statement += (asc) ? SQL_SELECT_ROWNUM(std::string(SQL_SYSCALL_NAME), SQL_ASCENDING) : SQL_SELECT_ROWNUM(std::string(SQL_SYSCALL_NAME), SQL_DESCENDING);
             raw_select_sql_statement += ", timestamp ASC";
             break;
         case ScreenConfiguration::result:
@@ -788,6 +1025,124 @@ std::vector<int> Sqlite3StorageEngine::QueryIdsBySearch(
     return results;
 }
 
+/**
+ * Internal helper method that returns the id of the given stack in the stacks table,
+ * inserting the stack the first time it is seen. Returns 0 for an empty stack and
+ * -1 on error.
+ *
+ * Pre:
+ *  The database connection is open and the storage engine is ready.
+ *
+ * Post:
+ *  The stacks table contains the given stack exactly once.
+ *
+ */
+int64_t Sqlite3StorageEngine::storeStack(const StackTrace& stack)
+{
+    auto serializedData = stack.Serialize();
+    if (serializedData.empty())
+        return 0;
+
+    auto existing = stackIds.find(serializedData);
+    if (existing != stackIds.end())
+        return existing->second;
+
+    int64_t stackId = stackIds.size() + 1;
+
+    sqlite3_stmt* stmt;
+    auto rc = sqlite3_prepare_v2(dbConnection, SQL_INSERT_STACK SQL_END, -1, &stmt, nullptr);
+
+    rc = rc & sqlite3_bind_int64(stmt, 1, stackId);
+    rc = rc & sqlite3_bind_text(stmt, 2, serializedData.c_str(), serializedData.size()+1, nullptr);
+
+    if (rc != SQLITE_OK)
+    {
+        sqlite3_finalize(stmt);
+        return -1;
+    }
+
+    rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+
+    if (rc != SQLITE_DONE)
+        return -1;
+
+    if (inTransaction)
+        transactionStacks.push_back(serializedData);
+
+    stackIds.emplace(std::move(serializedData), stackId);
+
+    return stackId;
+}
+
+/**
+ * Internal helper method that returns the id of the process of the given event in the
+ * processes table, inserting the process the first time it is seen. Events without
+ * process details get a process made up of their pid and process name. Returns -1 on
+ * error.
+ *
+ * Pre:
+ *  The database connection is open and the storage engine is ready.
+ *
+ * Post:
+ *  The processes table contains the process of the event exactly once.
+ *
+ */
+int64_t Sqlite3StorageEngine::storeProcess(const ITelemetry& data)
+{
+    ProcessInfo madeUp;
+    const ProcessInfo* process = data.process.get();
+    if (process == nullptr)
+    {
+        madeUp.pid = data.pid;
+        madeUp.name = data.processName;
+        process = &madeUp;
+    }
+
+    // the name is part of the key for made up processes, which have no start time
+    std::string key = std::to_string(process->pid) + ":" + std::to_string(process->startTime) + ":" + process->name;
+
+    auto existing = processIds.find(key);
+    if (existing != processIds.end())
+        return existing->second;
+
+    int64_t processId = processIds.size() + 1;
+
+    std::string argv = packStrings(process->argv);
+
+    sqlite3_stmt* stmt;
+    auto rc = sqlite3_prepare_v2(dbConnection, SQL_INSERT_PROCESS SQL_END, -1, &stmt, nullptr);
+
+    rc = rc & sqlite3_bind_int64(stmt, 1, processId);
+    rc = rc & sqlite3_bind_int(stmt, 2, process->pid);
+    rc = rc & sqlite3_bind_int(stmt, 3, process->ppid);
+    rc = rc & sqlite3_bind_int64(stmt, 4, process->startTime);
+    rc = rc & sqlite3_bind_int(stmt, 5, process->uid);
+    rc = rc & sqlite3_bind_text(stmt, 6, process->name.c_str(), process->name.size(), nullptr);
+    rc = rc & sqlite3_bind_text(stmt, 7, process->exe.c_str(), process->exe.size(), nullptr);
+    rc = rc & sqlite3_bind_blob(stmt, 8, argv.data(), argv.size(), SQLITE_STATIC);
+    rc = rc & sqlite3_bind_text(stmt, 9, process->cgroup.c_str(), process->cgroup.size(), nullptr);
+
+    if (rc != SQLITE_OK)
+    {
+        sqlite3_finalize(stmt);
+        return -1;
+    }
+
+    rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+
+    if (rc != SQLITE_DONE)
+        return -1;
+
+    if (inTransaction)
+        transactionProcesses.push_back(key);
+
+    processIds.emplace(std::move(key), processId);
+
+    return processId;
+}
+
 /**
  * Implements interface method to store a single ITelemetry data entry. This method
  * should not be written to by more than one thread. If there is more than one writer
@@ -800,22 +1155,23 @@ std::vector<int> Sqlite3StorageEngine::QueryIdsBySearch(
  *  The database should contain one new entry if all constraints are met.
  *
  */
-bool Sqlite3StorageEngine::Store(ITelemetry data)
+bool Sqlite3StorageEngine::Store(const ITelemetry& data)
 {
     if (!ready) return false;
 
     // Update the syscallHitMap map to keep total running syscalls and durations. We store it here
     // in a shared map to avoid the cost of keeping an additional table. The map is sorted by duration
-    // only when user requests it through the 'Stats' capability.
+    // only when user requests it through the 'Stats' capability. Sampled events are scaled back up
+    // by their sample rate.
     if(_syscallHitMap.find(data.syscall) != _syscallHitMap.end())
     {
         std::tuple<int, uint64_t>* _syscallTuple = &_syscallHitMap[data.syscall];
-        std::get<0>(*_syscallTuple)++;
-        std::get<1>(*_syscallTuple) += data.duration;
+        std::get<0>(*_syscallTuple) += data.sampleRate;
+        std::get<1>(*_syscallTuple) += data.duration * data.sampleRate;
     }
     else
     {
-        _syscallHitMap.insert(std::make_pair(data.syscall, std::make_tuple(1, data.duration)));
+        _syscallHitMap.insert(std::make_pair(data.syscall, std::make_tuple((int)data.sampleRate, data.duration * data.sampleRate)));
     }
 
     // store syscall event in database
@@ -824,24 +1180,64 @@ bool Sqlite3StorageEngine::Store(ITelemetry data)
 
     rc = rc & sqlite3_bind_int(stmt, 1, data.pid);
 
-    auto serializedData = data.stackTrace.Serialize();
+    int64_t stackId = storeStack(data.stackTrace);
+    if (stackId < 0)
+    {
+        sqlite3_finalize(stmt);
+        return false;
+    }
 
-    rc = rc & sqlite3_bind_text(stmt, 2, serializedData.c_str(), serializedData.size()+1, nullptr);
+    if (stackId == 0)
+        rc = rc & sqlite3_bind_null(stmt, 2);
+    else
+        rc = rc & sqlite3_bind_int64(stmt, 2, stackId);
 
-    rc = rc & sqlite3_bind_text(stmt, 3, data.comm.c_str(), data.comm.size()+1, nullptr);
+    int64_t processId = storeProcess(data);
+    if (processId < 0)
+    {
+        sqlite3_finalize(stmt);
+        return false;
+    }
+
+    rc = rc & sqlite3_bind_int64(stmt, 3, processId);
 
-    rc = rc & sqlite3_bind_text(stmt, 4, data.processName.c_str(), data.processName.size()+1, nullptr);
+    // the thread name is only kept when it isn't the process name
+    if (data.comm.empty() || data.comm == data.processName)
+        rc = rc & sqlite3_bind_null(stmt, 4);
+    else
+        rc = rc & sqlite3_bind_text(stmt, 4, data.comm.c_str(), data.comm.size(), nullptr);
 
     rc = rc & sqlite3_bind_int64(stmt, 5, data.result);
 
     rc = rc & sqlite3_bind_int64(stmt, 6, data.timestamp);
 
-    rc = rc & sqlite3_bind_text(stmt, 7, data.syscall.c_str(), data.syscall.size()+1, nullptr);
+    rc = rc & sqlite3_bind_int(stmt, 7, data.syscall);
 
     rc = rc & sqlite3_bind_int64(stmt, 8, data.duration);
 
     rc = rc & sqlite3_bind_blob(stmt, 9, data.arguments, MAX_BUFFER, SQLITE_STATIC);
 
+    rc = rc & sqlite3_bind_int(stmt, 10, data.sampleRate);
+
+    // string arguments are kept in their own column so they can be filtered on
+    std::string strings = packStrings(data.strings);
+
+    if (data.strings.empty())
+        rc = rc & sqlite3_bind_null(stmt, 11);
+    else
+        rc = rc & sqlite3_bind_blob(stmt, 11, strings.data(), strings.size(), SQLITE_STATIC);
+
+    // data buffers are only captured when asked for
+    if (data.payload.empty())
+        rc = rc & sqlite3_bind_null(stmt, 12);
+    else
+        rc = rc & sqlite3_bind_blob(stmt, 12, data.payload.data(), data.payload.size(), SQLITE_STATIC);
+
+    if (data.address.empty())
+        rc = rc & sqlite3_bind_null(stmt, 13);
+    else
+        rc = rc & sqlite3_bind_text(stmt, 13, data.address.c_str(), data.address.size(), nullptr);
+
     if (rc != SQLITE_OK)
     {
         sqlite3_finalize(stmt);
@@ -872,29 +1268,106 @@ bool Sqlite3StorageEngine::Store(ITelemetry data)
  *  The database connection is open and the storage engine is ready.
  *
  * Post:
- *  The database should contain data.size() new entry if all constraints are met.
+ *  The database should contain count new entries if all constraints are met.
  *
  */
-bool Sqlite3StorageEngine::StoreMany(std::vector<ITelemetry> data)
+bool Sqlite3StorageEngine::StoreMany(const ITelemetry* data, size_t count)
 {
-    if(!ready || data.size() < 1)
+    if(!ready || count < 1)
         return false;
 
-    sqlite3_exec(dbConnection, SQL_TX_START, NULL, NULL, nullptr);
+    beginTransaction();
 
-    for (ITelemetry& datam: data)
+    for (size_t i = 0; i < count; i++)
     {
-        if (!Store(datam))
+        if (!Store(data[i]))
         {
-            sqlite3_exec(dbConnection, SQL_TX_ROLLBACK, NULL, NULL, nullptr);
+            rollbackTransaction();
             return false;
         }
     }
-    sqlite3_exec(dbConnection, SQL_TX_END, NULL, NULL, nullptr);
+    endTransaction();
 
     return true;
 }
 
+/**
+ * Implements interface method to store a batch of fixed layout records in a single
+ * transaction, like StoreMany above. Each record is read into the same ITelemetry so
+ * storing a batch doesn't allocate once that ITelemetry has grown.
+ *
+ * Pre:
+ *  The database connection is open and the storage engine is ready.
+ *
+ * Post:
+ *  The database should contain batch.Size() new entries if all constraints are met.
+ *
+ */
+bool Sqlite3StorageEngine::StoreMany(const TelemetryBatch& batch)
+{
+    if(!ready || batch.Empty())
+        return false;
+
+    beginTransaction();
+
+    for (size_t i = 0; i < batch.Size(); i++)
+    {
+        batch.Read(i, batchTelemetry);
+        if (!Store(batchTelemetry))
+        {
+            rollbackTransaction();
+            return false;
+        }
+    }
+    endTransaction();
+
+    return true;
+}
+
+/**
+ * Internal helper methods that begin, end and roll back the transaction of a StoreMany.
+ * Rolling back also forgets the ids of the stacks and processes first stored in the
+ * transaction, since their rows are gone with it.
+ *
+ * Pre:
+ *  The database connection is open and the storage engine is ready.
+ *
+ * Post:
+ *  stackIds and processIds only hold ids of rows in the stacks and processes tables.
+ *
+ */
+void Sqlite3StorageEngine::beginTransaction()
+{
+    sqlite3_exec(dbConnection, SQL_TX_START, NULL, NULL, nullptr);
+    inTransaction = true;
+}
+
+void Sqlite3StorageEngine::endTransaction()
+{
+    sqlite3_exec(dbConnection, SQL_TX_END, NULL, NULL, nullptr);
+    inTransaction = false;
+    transactionStacks.clear();
+    transactionProcesses.clear();
+}
+
+void Sqlite3StorageEngine::rollbackTransaction()
+{
+    sqlite3_exec(dbConnection, SQL_TX_ROLLBACK, NULL, NULL, nullptr);
+    inTransaction = false;
+
+    for (auto& stack : transactionStacks)
+    {
+        stackIds.erase(stack);
+    }
+    transactionStacks.clear();
+
+    for (auto& process : transactionProcesses)
+    {
+        processIds.erase(process);
+    }
+    transactionProcesses.clear();
+}
+
 bool Sqlite3StorageEngine::Clear()
 {
     bool ret = false;
@@ -912,6 +1385,10 @@ bool Sqlite3StorageEngine::Clear()
     sqlite3_exec(dbConnection, SQL_TX_END, NULL, NULL, nullptr);
     telemetryCount = 0;
 
+    // hand the freed pages and heap back to the system
+    sqlite3_db_release_memory(dbConnection);
+    malloc_trim(0);
+
     ret = (rc != SQLITE_OK) ? false : true;
 
     return ret;
@@ -944,6 +1421,7 @@ bool Sqlite3StorageEngine::Export(std::tuple<uint64_t, std::string> startTime, s
 
     rc = rc & sqlite3_bind_int64(stmt, 1, clockStart);
     rc = rc & sqlite3_bind_text(stmt, 2, epocTime.c_str(), epocTime.size()+1, nullptr);
+    rc = rc & sqlite3_bind_int64(stmt, 3, _lostEvents);
 
     if (rc != SQLITE_OK)
     {
@@ -958,24 +1436,24 @@ bool Sqlite3StorageEngine::Export(std::tuple<uint64_t, std::string> startTime, s
         return false;
 
     // store stats of trace in stats table
-    typedef std::function<bool(std::pair<std::string, std::tuple<int, uint64_t>>, std::pair<std::string, std::tuple<int, uint64_t>>)> Comparator;
+    typedef std::function<bool(std::pair<int, std::tuple<int, uint64_t>>, std::pair<int, std::tuple<int, uint64_t>>)> Comparator;
 
 	Comparator compFunctor =
-			[](std::pair<std::string, std::tuple<int, uint64_t>> elem1 ,std::pair<std::string, std::tuple<int, uint64_t>> elem2)
+			[](std::pair<int, std::tuple<int, uint64_t>> elem1 ,std::pair<int, std::tuple<int, uint64_t>> elem2)
 			{
 				return std::get<1>(elem1.second) > std::get<1>(elem2.second);
 			};
 
-    std::set<std::pair<std::string, std::tuple<int, uint64_t>>, Comparator> sortedSyscalls(_syscallHitMap.begin(), _syscallHitMap.end(), compFunctor);
+    std::set<std::pair<int, std::tuple<int, uint64_t>>, Comparator> sortedSyscalls(_syscallHitMap.begin(), _syscallHitMap.end(), compFunctor);
 
-    std::set<std::pair<std::string, std::tuple<int, uint64_t>>>::iterator it;
+    std::set<std::pair<int, std::tuple<int, uint64_t>>>::iterator it;
     int i;
 
     for (it = sortedSyscalls.begin(), i = 0; it != sortedSyscalls.end() && i < 10; ++it, i++)
     {
         sqlite3_stmt* stats;
         rc = sqlite3_prepare_v2(dbConnection, SQL_INSERT_STATS SQL_END, -1, &stats, nullptr);
-        rc = rc & sqlite3_bind_text(stats, 1, it->first.c_str(), it->first.length() + 1, nullptr);
+        rc = rc & sqlite3_bind_int(stats, 1, it->first);
         rc = rc & sqlite3_bind_int(stats, 2, std::get<0>(it->second));
         rc = rc & sqlite3_bind_int64(stats, 3, std::get<1>(it->second));
 
@@ -1014,17 +1492,64 @@ bool Sqlite3StorageEngine::Export(std::tuple<uint64_t, std::string> startTime, s
     return ret;
 }
 
+/**
+ * Internal helper method that loads a trace file recorded before stacks and processes
+ * were stored once, converting it to the current layout in an in memory database.
+ *
+ * Pre:
+ *  The database connection is open on the legacy trace file.
+ *
+ * Post:
+ *  The database connection is open on an in memory database holding the events of
+ *  the trace file, the trace file itself is left as it is.
+ */
+void Sqlite3StorageEngine::loadLegacyTrace(const std::string& filePath)
+{
+    sqlite3_stmt* stmt;
+
+    sqlite3_close(dbConnection);
+    auto rc = sqlite3_open(SQL_INITDB, &dbConnection);
+    if (rc != SQLITE_OK) throw std::runtime_error{"Failed to open in-memory database"};
+    if (!registerSyscallFunctions(dbConnection)) throw std::runtime_error{"Failed to register syscall functions"};
+
+    for (const char* create : {SQL_CREATE_EBPF, SQL_CREATE_STACKS, SQL_CREATE_PROCESSES, SQL_CREATE_METADATA, SQL_CREATE_STATS})
+    {
+        rc = sqlite3_exec(dbConnection, create, 0, 0, nullptr);
+        if (rc != SQLITE_OK) throw std::runtime_error{"Failed to create tables for older trace file"};
+    }
+
+    rc = sqlite3_prepare_v2(dbConnection, SQL_ATTACH_LEGACY SQL_END, -1, &stmt, nullptr);
+    if (rc == SQLITE_OK)
+    {
+        sqlite3_bind_text(stmt, 1, filePath.c_str(), -1, SQLITE_TRANSIENT);
+        rc = sqlite3_step(stmt) == SQLITE_DONE ? SQLITE_OK : SQLITE_ERROR;
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_OK) throw std::runtime_error{"Failed to attach older trace file"};
+
+    rc = sqlite3_exec(dbConnection, SQL_MIGRATE_LEGACY, 0, 0, nullptr);
+    if (rc != SQLITE_OK)
+    {
+        sqlite3_exec(dbConnection, SQL_TX_ROLLBACK, 0, 0, nullptr);
+        throw std::runtime_error{"Failed to convert older trace file"};
+    }
+}
+
 std::tuple<uint64_t, std::string> Sqlite3StorageEngine::Load(std::string filepath)
 {
     sqlite3_stmt* stmt;
     uint64_t startTimeTicks;
     std::string startTimeEpoc;
-    std::string columnName, syscall;
+    std::string columnName;
+    int syscall;
     int count;
     uint64_t duration;
 
     // clear syscall hitmap
     _syscallHitMap.clear();
+    stackIds.clear();
+    processIds.clear();
+    _lostEvents = 0;
 
     // close connection to in memory database
     auto rc = sqlite3_close(dbConnection);
@@ -1034,6 +1559,28 @@ std::tuple<uint64_t, std::string> Sqlite3StorageEngine::Load(std::string filepat
     // connect to exported DB to load events
     rc = sqlite3_open(filepath.c_str(), &dbConnection);
     if (rc != SQLITE_OK) throw std::runtime_error{"Failed to attach to DB file"};
+    if (!registerSyscallFunctions(dbConnection)) throw std::runtime_error{"Failed to register syscall functions"};
+
+    // trace files written before stacks and processes were deduplicated lack their tables
+    int tables = 0;
+    for (const char* hasTable : {SQL_HAS_TABLE("stacks") SQL_END, SQL_HAS_TABLE("processes") SQL_END})
+    {
+        rc = sqlite3_prepare_v2(dbConnection, hasTable, -1, &stmt, nullptr);
+        if (rc == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            tables++;
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    if (tables == 0)
+    {
+        loadLegacyTrace(filepath);
+    }
+    else if (tables != 2)
+    {
+        throw std::runtime_error{"Trace file layout isn't recognized"};
+    }
 
     // update size value of storage engine to size of tracefile
     rc = sqlite3_prepare_v2(dbConnection, "SELECT COUNT(*) FROM ebpf;", -1, &stmt, nullptr);
@@ -1062,16 +1609,16 @@ std::tuple<uint64_t, std::string> Sqlite3StorageEngine::Load(std::string filepat
         {
             case SQLITE_ROW:
             {
+                syscall = -1;
                 for(int i = 0; i < sqlite3_column_count(stmt); i++)
                 {
                     columnName = sqlite3_column_name(stmt, i);
                     if (columnName == "syscall")
                     {
-                        const char* _syscall = reinterpret_cast<const char*>(sqlite3_column_text(stmt, i));
-                        if (_syscall == NULL)
+                        if (sqlite3_column_type(stmt, i) == SQLITE_NULL)
                             continue;
 
-                        syscall = std::string(_syscall);
+                        syscall = sqlite3_column_int(stmt, i);
                     }
                     else if(columnName == "count")
                     {
@@ -1113,6 +1660,7 @@ std::tuple<uint64_t, std::string> Sqlite3StorageEngine::Load(std::string filepat
         startTimeTicks = sqlite3_column_int64(stmt, 0);
         const char* rawEpocTime = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
         startTimeEpoc = std::string(rawEpocTime);
+        _lostEvents = sqlite3_column_int64(stmt, 2);
 
         return std::make_tuple(startTimeTicks, startTimeEpoc);
     }
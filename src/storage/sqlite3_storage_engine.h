@@ -19,6 +19,7 @@
 #include <map>
 #include <sqlite3.h>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "storage_engine.h"
@@ -39,6 +40,29 @@ private:
 
     sqlite3* dbConnection;
 
+    // Serialized stack to id in the stacks table, so each unique stack is stored once
+    std::unordered_map<std::string, int64_t> stackIds;
+
+    int64_t storeStack(const StackTrace& stack);
+
+    // Process key (pid, start time and name) to id in the processes table, so each process is stored once
+    std::unordered_map<std::string, int64_t> processIds;
+
+    int64_t storeProcess(const ITelemetry& data);
+
+    // Stacks and processes first stored since the transaction of a StoreMany began,
+    // dropped from stackIds and processIds again when it is rolled back
+    bool inTransaction = false;
+    std::vector<std::string> transactionStacks;
+    std::vector<std::string> transactionProcesses;
+
+    void beginTransaction();
+    void endTransaction();
+    void rollbackTransaction();
+
+    // Events of a TelemetryBatch are read into this one by one, reusing its storage
+    ITelemetry batchTelemetry;
+
     std::string addPidFilterToSQLQuery(const std::string initialQuery, std::vector<pid_t> pids, const bool first);
 
     std::string addSyscallFilterToSQLQuery(const std::string initialQuery, std::vector<Event> events, const bool first);
@@ -48,6 +72,13 @@ private:
 
     ITelemetry parseSqlite3Row(sqlite3_stmt *preppedSqlStmt);
 
+    static std::string packStrings(const std::vector<std::string>& strings);
+    static void unpackStrings(sqlite3_stmt* preppedSqlStmt, int column, std::vector<std::string>& strings);
+
+    void loadLegacyTrace(const std::string& filePath);
+
+    static bool registerSyscallFunctions(sqlite3* db);
+
     std::vector<ITelemetry> getFromSqlite3(sqlite3_stmt* preppedSqlStmt);
     std::vector<int> getIdsFromSqlite3(sqlite3_stmt* preppedSqlStmt);
 
@@ -82,8 +113,10 @@ public:
         std::string search, std::vector<pid_t> pids, ScreenConfiguration::sort orderBy, bool asc, const std::vector<Event>& syscalls = {}) override;
 
     // Store API
-    bool Store(ITelemetry data) override;
-    bool StoreMany(std::vector<ITelemetry> data) override;
+    using IStorageEngine::StoreMany;
+    bool Store(const ITelemetry& data) override;
+    bool StoreMany(const ITelemetry* data, size_t count) override;
+    bool StoreMany(const TelemetryBatch& batch) override;
     bool Clear() override;
 
     // Load API
@@ -22,13 +22,16 @@
 #include <map>
 
 #include "../common/telemetry.h"
+#include "../common/telemetry_record.h"
 #include "../common/event.h"
 #include "../display/screen_configuration.h"
 
 class IStorageEngine
 {
 protected:
-    std::map<std::string, std::tuple<int, uint64_t>> _syscallHitMap;
+    // count and total duration of each syscall number
+    std::map<int, std::tuple<int, uint64_t>> _syscallHitMap;
+    uint64_t _lostEvents = 0;
 
 public:
     IStorageEngine() {}
@@ -76,8 +79,21 @@ public:
         std::string search, std::vector<pid_t> pids, ScreenConfiguration::sort orderBy, bool asc, const std::vector<Event>& syscalls = {}) = 0;
 
     // Store API
-    virtual bool Store(ITelemetry data) = 0;
-    virtual bool StoreMany(std::vector<ITelemetry> data) = 0;
+    virtual bool Store(const ITelemetry& data) = 0;
+    // Batches are only read, so callers can reuse them for the next batch
+    virtual bool StoreMany(const ITelemetry* data, size_t count) = 0;
+    bool StoreMany(const std::vector<ITelemetry>& data) { return StoreMany(data.data(), data.size()); }
+    virtual bool StoreMany(const TelemetryBatch& batch)
+    {
+        ITelemetry telemetry;
+        for (size_t i = 0; i < batch.Size(); i++)
+        {
+            batch.Read(i, telemetry);
+            if (!Store(telemetry))
+                return false;
+        }
+        return !batch.Empty();
+    }
     virtual int Size() { return 0; };
     virtual bool Export(std::tuple<uint64_t, std::string> startTime, std::string filePath) { return false; };
     virtual bool Clear() { return false; };
@@ -86,7 +102,11 @@ public:
     virtual std::tuple<uint64_t, std::string> Load(std::string filePath) = 0;
 
     // Hitmap API
-    virtual std::map<std::string, std::tuple<int, uint64_t>> GetHitmap () { return _syscallHitMap; }
+    virtual std::map<int, std::tuple<int, uint64_t>> GetHitmap () { return _syscallHitMap; }
+
+    // Lost events API, kept in the trace metadata
+    virtual void SetLostEvents(uint64_t lost) { _lostEvents = lost; }
+    virtual uint64_t GetLostEvents() { return _lostEvents; }
 };
 
 #endif
\ No newline at end of file
@@ -26,6 +26,7 @@
 #include <bits/stdc++.h>
 
 #include "sqlite3_storage_engine.h"
+#include "../tracer/ebpf/syscalls.h"
 #include "../display/screen_configuration.h"
 
 typedef ITelemetry MockTelemetry;
@@ -38,6 +39,25 @@ static std::vector<pid_t> pidRange(pid_t start, pid_t end)
     return result;
 }
 
+// An item with defaults for everything but its pid, process name and
+// syscall, tests set the fields they check on the copy they get back
+static MockTelemetry makeTelemetry(pid_t pid, const std::string& processName, const std::string& syscall)
+{
+    MockTelemetry telemetry {
+        .pid = pid,
+        .stackTrace = {},
+        .comm = "",
+        .processName = processName,
+        .syscall = SyscallNumberForName(syscall),
+        .result = 0,
+        .duration = 0,
+        .arguments = (unsigned char *)"test arguments",
+        .timestamp = 0
+    };
+
+    return telemetry;
+}
+
 static bool telemetryMatches(ITelemetry first, ITelemetry second)
 {
     return first.comm == second.comm && first.syscall == second.syscall &&
@@ -75,7 +95,7 @@ static void storeOneItem(Sqlite3StorageEngine& engine, pid_t rangeStart, pid_t r
         .stackTrace = trace,
         .comm = "",
         .processName = "Process",
-        .syscall = syscalls[syscallDice()].Name(),
+        .syscall = SyscallNumberForName(syscalls[syscallDice()].Name()),
         .result = resultDice(),
         .duration = 0,
         .arguments = (unsigned char *)"storeOneItem arguments",
@@ -117,7 +137,7 @@ static std::map<std::string, pid_t> storeNItems(Sqlite3StorageEngine& engine, ui
             .stackTrace = trace,
             .comm = "",
             .processName = name,
-            .syscall = syscalls[syscallDice()].Name(),
+            .syscall = SyscallNumberForName(syscalls[syscallDice()].Name()),
             .result = res,
             .duration = 0,
             .arguments = (unsigned char *)"storeNitems arguments",
@@ -162,10 +182,10 @@ TEST_CASE("storage engine can add items", "[Sqlite3StorageEngine]") {
 
     // This doesn't really matter.
     std::vector<Event> mockSyscalls;
-    mockSyscalls.emplace_back("sys_write");
-    mockSyscalls.emplace_back("sys_read");
-    mockSyscalls.emplace_back("sys_open");
-    mockSyscalls.emplace_back("sys_mmap");
+    mockSyscalls.emplace_back("write");
+    mockSyscalls.emplace_back("read");
+    mockSyscalls.emplace_back("open");
+    mockSyscalls.emplace_back("mmap");
 
     Sqlite3StorageEngine engine;
     CHECK(engine.Initialize(mockSyscalls));
@@ -207,10 +227,10 @@ TEST_CASE("storage engine can add items", "[Sqlite3StorageEngine]") {
 TEST_CASE("storage engine can retrieve added items", "[Sqlite3StorageEngine]") {
 
     std::vector<Event> mockSyscalls;
-    mockSyscalls.emplace_back("sys_write");
-    mockSyscalls.emplace_back("sys_read");
-    mockSyscalls.emplace_back("sys_open");
-    mockSyscalls.emplace_back("sys_mmap");
+    mockSyscalls.emplace_back("write");
+    mockSyscalls.emplace_back("read");
+    mockSyscalls.emplace_back("open");
+    mockSyscalls.emplace_back("mmap");
 
     Sqlite3StorageEngine engine;
     CHECK(engine.Initialize(mockSyscalls));
@@ -341,10 +361,10 @@ TEST_CASE("storage engine can retrieve added items", "[Sqlite3StorageEngine]") {
 TEST_CASE("storage engine can store and retrieve items at the same time", "[Sqlite3StorageEngine]") {
 
     std::vector<Event> mockSyscalls;
-    mockSyscalls.emplace_back("sys_write");
-    mockSyscalls.emplace_back("sys_read");
-    mockSyscalls.emplace_back("sys_open");
-    mockSyscalls.emplace_back("sys_mmap");
+    mockSyscalls.emplace_back("write");
+    mockSyscalls.emplace_back("read");
+    mockSyscalls.emplace_back("open");
+    mockSyscalls.emplace_back("mmap");
 
     Sqlite3StorageEngine engine;
     CHECK(engine.Initialize(mockSyscalls));
@@ -410,4 +430,580 @@ TEST_CASE("storage engine can store and retrieve items at the same time", "[Sqli
 
         for(auto& t: threads) t.join();
     }
-}
\ No newline at end of file
+}
+TEST_CASE("storage engine stores each unique stack once", "[Sqlite3StorageEngine]") {
+
+    std::vector<Event> mockSyscalls;
+    mockSyscalls.emplace_back("write");
+    mockSyscalls.emplace_back("read");
+
+    Sqlite3StorageEngine engine;
+    CHECK(engine.Initialize(mockSyscalls));
+
+    std::map<int, uint> resFreq;
+    std::map<pid_t, uint> pidFreq;
+
+    uint elementCount = 100;
+    storeNItems(engine, elementCount, 1000, 1010, -20, 20, mockSyscalls, resFreq, pidFreq);
+
+    MockTelemetry noStack = makeTelemetry(2000, "NoStack", mockSyscalls[0].Name());
+    CHECK(engine.Store(noStack));
+
+    SECTION("Queried items carry their stack") {
+        auto results = engine.QueryByPids(pidRange(1000, 1010));
+        REQUIRE(results.size() == elementCount);
+        for (auto& telemetry: results)
+        {
+            CHECK(telemetry.stackTrace.userIPs == std::vector<uint64_t>({10, 20, 40}));
+        }
+
+        results = engine.QueryByPid(2000);
+        REQUIRE(results.size() == 1);
+        CHECK(results[0].stackTrace.userIPs.empty());
+    }
+
+    SECTION("Kernel frames are kept apart from the user frames") {
+        StackTrace blocked;
+        blocked.userIPs = {10, 20, 40};
+        blocked.kernelIPs = {0xffffffff81000010, 0xffffffff81000020};
+
+        MockTelemetry kernelStack = makeTelemetry(3000, "KernelStack", mockSyscalls[1].Name());
+        kernelStack.stackTrace = blocked;
+        CHECK(engine.Store(kernelStack));
+
+        auto results = engine.QueryByPid(3000);
+        REQUIRE(results.size() == 1);
+        CHECK(results[0].stackTrace.userIPs == blocked.userIPs);
+        CHECK(results[0].stackTrace.kernelIPs == blocked.kernelIPs);
+    }
+
+    SECTION("The exported trace holds a single copy of the stack") {
+        std::string path = "/tmp/procmon_test_stacks_" + std::to_string(getpid()) + ".db";
+        REQUIRE(engine.Export(std::make_tuple(0, ""), path));
+
+        sqlite3* db;
+        sqlite3_stmt* stmt;
+        REQUIRE(sqlite3_open(path.c_str(), &db) == SQLITE_OK);
+        REQUIRE(sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM stacks;", -1, &stmt, nullptr) == SQLITE_OK);
+        REQUIRE(sqlite3_step(stmt) == SQLITE_ROW);
+        CHECK(sqlite3_column_int(stmt, 0) == 1);
+        sqlite3_finalize(stmt);
+        sqlite3_close(db);
+
+        std::remove(path.c_str());
+    }
+}
+
+TEST_CASE("storage engine scales sampled events back up", "[Sqlite3StorageEngine]") {
+
+    std::vector<Event> mockSyscalls;
+    mockSyscalls.emplace_back("read");
+
+    Sqlite3StorageEngine engine;
+    CHECK(engine.Initialize(mockSyscalls));
+
+    MockTelemetry sampled = makeTelemetry(3000, "Sampled", mockSyscalls[0].Name());
+    sampled.duration = 10;
+    sampled.sampleRate = 100;
+    CHECK(engine.Store(sampled));
+
+    MockTelemetry unsampled = sampled;
+    unsampled.sampleRate = 1;
+    CHECK(engine.Store(unsampled));
+
+    SECTION("Each event is stored once with its sample rate") {
+        auto results = engine.QueryByPid(3000);
+        REQUIRE(results.size() == 2);
+        CHECK(results[0].sampleRate * results[1].sampleRate == 100);
+        CHECK(engine.Size() == 2);
+    }
+
+    SECTION("Stats count every call the events stand for") {
+        auto hitmap = engine.GetHitmap();
+        int read = SyscallNumberForName("read");
+        REQUIRE(hitmap.count(read) == 1);
+        CHECK(std::get<0>(hitmap[read]) == 101);
+        CHECK(std::get<1>(hitmap[read]) == 1010);
+    }
+}
+
+TEST_CASE("storage engine stores syscall numbers and finds them by name", "[Sqlite3StorageEngine]") {
+
+    std::vector<Event> mockSyscalls;
+    mockSyscalls.emplace_back("write");
+    mockSyscalls.emplace_back("close");
+
+    Sqlite3StorageEngine engine;
+    CHECK(engine.Initialize(mockSyscalls));
+
+    // write is 1 and close is 3, so sorting by name and by number differ
+    CHECK(engine.Store(makeTelemetry(3100, "Writer", "write")));
+    CHECK(engine.Store(makeTelemetry(3101, "Closer", "close")));
+
+    SECTION("Items come back with their syscall number") {
+        auto results = engine.QueryByPid(3100);
+        REQUIRE(results.size() == 1);
+        CHECK(results[0].syscall == 1);
+    }
+
+    SECTION("Items can be filtered on their syscall name") {
+        auto results = engine.QueryByFilteredEventsinPage("clos", {}, 0, 10, ScreenConfiguration::time, true);
+        REQUIRE(results.size() == 1);
+        CHECK(results[0].pid == 3101);
+    }
+
+    SECTION("Items are sorted by their syscall name") {
+        auto results = engine.QueryByEventsinPage({}, 0, 10, ScreenConfiguration::operation, true);
+        REQUIRE(results.size() == 2);
+        CHECK(results[0].syscall == SyscallNumberForName("close"));
+        CHECK(results[1].syscall == SyscallNumberForName("write"));
+    }
+}
+
+TEST_CASE("storage engine keeps the lost event count in the trace metadata", "[Sqlite3StorageEngine]") {
+
+    std::vector<Event> mockSyscalls;
+    mockSyscalls.emplace_back("read");
+
+    Sqlite3StorageEngine engine;
+    CHECK(engine.Initialize(mockSyscalls));
+
+    std::map<int, uint> resFreq;
+    std::map<pid_t, uint> pidFreq;
+    storeNItems(engine, 10, 1000, 1010, -20, 20, mockSyscalls, resFreq, pidFreq);
+
+    engine.SetLostEvents(42);
+
+    std::string path = "/tmp/procmon_test_lost_" + std::to_string(getpid()) + ".db";
+    REQUIRE(engine.Export(std::make_tuple(1, "start"), path));
+
+    Sqlite3StorageEngine loaded;
+    CHECK(loaded.Initialize(mockSyscalls));
+    auto startTime = loaded.Load(path);
+
+    CHECK(std::get<0>(startTime) == 1);
+    CHECK(loaded.GetLostEvents() == 42);
+    CHECK(loaded.Size() == 10);
+
+    std::remove(path.c_str());
+}
+
+TEST_CASE("storage engine loads traces recorded by older versions", "[Sqlite3StorageEngine]") {
+
+    std::vector<Event> mockSyscalls;
+    mockSyscalls.emplace_back("read");
+
+    // layout of trace files from before stacks and processes were stored once
+    std::string path = "/tmp/procmon_test_legacy_" + std::to_string(getpid()) + ".db";
+    sqlite3* db;
+    REQUIRE(sqlite3_open(path.c_str(), &db) == SQLITE_OK);
+    REQUIRE(sqlite3_exec(db,
+        "CREATE TABLE ebpf (pid INT, stacktrace TEXT, comm TEXT, processname TEXT, resultcode INTEGER, "
+        "    timestamp INTEGER, syscall TEXT, duration INTEGER, arguments BLOB);"
+        "CREATE TABLE metadata (startTime INT, startEpocTime TEXT);"
+        "CREATE TABLE stats (syscall TEXT, count INTEGER, duration INTEGER);"
+        "INSERT INTO ebpf VALUES (1000, '10;20;40', 'old', 'Old', 0, 1, 'read', 5, zeroblob(128));"
+        "INSERT INTO ebpf VALUES (1000, '10;20;40', 'old', 'Old', -2, 2, 'read', 5, zeroblob(128));"
+        "INSERT INTO ebpf VALUES (2000, '', 'other', 'Other', 0, 3, 'read', 5, zeroblob(128));"
+        "INSERT INTO metadata VALUES (7, 'start');"
+        "INSERT INTO stats VALUES ('read', 3, 15);", 0, 0, nullptr) == SQLITE_OK);
+    sqlite3_close(db);
+
+    Sqlite3StorageEngine loaded;
+    CHECK(loaded.Initialize(mockSyscalls));
+    auto startTime = loaded.Load(path);
+
+    CHECK(std::get<0>(startTime) == 7);
+    CHECK(std::get<1>(startTime) == "start");
+    CHECK(loaded.GetLostEvents() == 0);
+    CHECK(loaded.Size() == 3);
+
+    // syscall names are turned into their numbers
+    auto hitmap = loaded.GetHitmap();
+    REQUIRE(hitmap.count(SyscallNumberForName("read")) == 1);
+    CHECK(std::get<0>(hitmap[SyscallNumberForName("read")]) == 3);
+
+    auto results = loaded.QueryByPid(1000);
+    REQUIRE(results.size() == 2);
+    for (auto& telemetry: results)
+    {
+        CHECK(telemetry.syscall == SyscallNumberForName("read"));
+        CHECK(telemetry.processName == "Old");
+        CHECK(telemetry.comm == "old");
+        CHECK(telemetry.stackTrace.userIPs == std::vector<uint64_t>({10, 20, 40}));
+    }
+
+    results = loaded.QueryByPid(2000);
+    REQUIRE(results.size() == 1);
+    CHECK(results[0].processName == "Other");
+    CHECK(results[0].stackTrace.userIPs.empty());
+
+    // the trace file itself is left as it was
+    REQUIRE(sqlite3_open(path.c_str(), &db) == SQLITE_OK);
+    sqlite3_stmt* stmt;
+    CHECK(sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM sqlite_master WHERE name='stacks';", -1, &stmt, nullptr) == SQLITE_OK);
+    REQUIRE(sqlite3_step(stmt) == SQLITE_ROW);
+    CHECK(sqlite3_column_int(stmt, 0) == 0);
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+
+    std::remove(path.c_str());
+}
+
+TEST_CASE("storage engine keeps full length string arguments", "[Sqlite3StorageEngine]") {
+
+    std::vector<Event> mockSyscalls;
+    mockSyscalls.emplace_back("rename");
+
+    Sqlite3StorageEngine engine;
+    CHECK(engine.Initialize(mockSyscalls));
+
+    std::string oldPath = "/var/lib/some/deeply/nested/directory/that/does/not/fit/the/preview/old.conf";
+    std::string newPath = "/var/lib/some/deeply/nested/directory/that/does/not/fit/the/preview/new.conf";
+
+    MockTelemetry renamed = makeTelemetry(4000, "Renamer", mockSyscalls[0].Name());
+    renamed.strings = {oldPath, newPath};
+    CHECK(engine.Store(renamed));
+
+    MockTelemetry other = renamed;
+    other.pid = 4001;
+    other.strings = {};
+    CHECK(engine.Store(other));
+
+    MockTelemetry multiline = renamed;
+    multiline.pid = 4002;
+    multiline.strings = {"/tmp/first\nSecond", ""};
+    CHECK(engine.Store(multiline));
+
+    SECTION("Queried items carry their strings in argument order") {
+        auto results = engine.QueryByPid(4000);
+        REQUIRE(results.size() == 1);
+        REQUIRE(results[0].strings.size() == 2);
+        CHECK(results[0].strings[0] == oldPath);
+        CHECK(results[0].strings[1] == newPath);
+
+        results = engine.QueryByPid(4001);
+        REQUIRE(results.size() == 1);
+        CHECK(results[0].strings.empty());
+    }
+
+    SECTION("Strings keep newlines and empty strings") {
+        auto results = engine.QueryByPid(4002);
+        REQUIRE(results.size() == 1);
+        CHECK(results[0].strings == multiline.strings);
+    }
+
+    SECTION("Items can be filtered on their strings") {
+        auto results = engine.QueryByFilteredEventsinPage("new.conf", {}, 0, 10, ScreenConfiguration::time, true);
+        REQUIRE(results.size() == 1);
+        CHECK(results[0].pid == 4000);
+
+        results = engine.QueryByFilteredEventsinPage("second", {}, 0, 10, ScreenConfiguration::time, true);
+        REQUIRE(results.size() == 1);
+        CHECK(results[0].pid == 4002);
+    }
+}
+
+TEST_CASE("storage engine keeps captured data buffers", "[Sqlite3StorageEngine]") {
+
+    std::vector<Event> mockSyscalls;
+    mockSyscalls.emplace_back("read");
+
+    Sqlite3StorageEngine engine;
+    CHECK(engine.Initialize(mockSyscalls));
+
+    std::vector<uint8_t> payload = {'G', 'E', 'T', ' ', '/', 0x00, 0xff, '\n'};
+
+    MockTelemetry captured = makeTelemetry(5000, "Reader", mockSyscalls[0].Name());
+    captured.result = payload.size();
+    captured.payload = payload;
+    CHECK(engine.Store(captured));
+
+    MockTelemetry uncaptured = captured;
+    uncaptured.pid = 5001;
+    uncaptured.payload = {};
+    CHECK(engine.Store(uncaptured));
+
+    SECTION("Queried items carry their data buffer byte for byte") {
+        auto results = engine.QueryByPid(5000);
+        REQUIRE(results.size() == 1);
+        CHECK(results[0].payload == payload);
+
+        results = engine.QueryByPid(5001);
+        REQUIRE(results.size() == 1);
+        CHECK(results[0].payload.empty());
+    }
+}
+
+TEST_CASE("storage engine keeps decoded socket addresses", "[Sqlite3StorageEngine]") {
+
+    std::vector<Event> mockSyscalls;
+    mockSyscalls.emplace_back("connect");
+
+    Sqlite3StorageEngine engine;
+    CHECK(engine.Initialize(mockSyscalls));
+
+    MockTelemetry connected = makeTelemetry(6000, "Client", mockSyscalls[0].Name());
+    connected.address = "10.1.2.3:443";
+    CHECK(engine.Store(connected));
+
+    MockTelemetry local = connected;
+    local.pid = 6001;
+    local.address = "/run/local.sock";
+    CHECK(engine.Store(local));
+
+    SECTION("Queried items carry their address") {
+        auto results = engine.QueryByPid(6000);
+        REQUIRE(results.size() == 1);
+        CHECK(results[0].address == "10.1.2.3:443");
+    }
+
+    SECTION("Items can be filtered on their address") {
+        auto results = engine.QueryByFilteredEventsinPage("10.1.2.3", {}, 0, 10, ScreenConfiguration::time, true);
+        REQUIRE(results.size() == 1);
+        CHECK(results[0].pid == 6000);
+
+        results = engine.QueryByFilteredEventsinPage("local.sock", {}, 0, 10, ScreenConfiguration::time, true);
+        REQUIRE(results.size() == 1);
+        CHECK(results[0].pid == 6001);
+    }
+}
+
+TEST_CASE("storage engine stores each process once", "[Sqlite3StorageEngine]") {
+
+    std::vector<Event> mockSyscalls;
+    mockSyscalls.emplace_back("write");
+    mockSyscalls.emplace_back("read");
+
+    Sqlite3StorageEngine engine;
+    CHECK(engine.Initialize(mockSyscalls));
+
+    auto shell = std::make_shared<ProcessInfo>();
+    shell->pid = 4000;
+    shell->ppid = 1;
+    shell->uid = 1000;
+    shell->startTime = 100;
+    shell->name = "bash";
+    shell->exe = "/usr/bin/bash";
+    shell->argv = {"bash", "-c", "ls -l\nls -a", ""};
+    shell->cgroup = "/user.slice";
+
+    // the same pid after an exec is a different process
+    auto listing = std::make_shared<ProcessInfo>(*shell);
+    listing->startTime = 200;
+    listing->name = "ls";
+    listing->exe = "/usr/bin/ls";
+    listing->argv = {"ls", "-l"};
+
+    for (auto& process : {shell, shell, listing})
+    {
+        MockTelemetry telemetry = makeTelemetry(4000, process->name, mockSyscalls[0].Name());
+        telemetry.timestamp = process->startTime + 1;
+        telemetry.process = process;
+        CHECK(engine.Store(telemetry));
+    }
+
+    SECTION("Queried items carry their process") {
+        auto results = engine.QueryByPid(4000);
+        REQUIRE(results.size() == 3);
+        for (auto& telemetry: results)
+        {
+            REQUIRE(telemetry.process != nullptr);
+            auto& expected = telemetry.timestamp < 200 ? shell : listing;
+            CHECK(telemetry.processName == expected->name);
+            CHECK(telemetry.process->ppid == 1);
+            CHECK(telemetry.process->uid == 1000);
+            CHECK(telemetry.process->startTime == expected->startTime);
+            CHECK(telemetry.process->exe == expected->exe);
+            CHECK(telemetry.process->argv == expected->argv);
+            CHECK(telemetry.process->cgroup == "/user.slice");
+        }
+    }
+
+    SECTION("The exported trace holds a single copy of each process") {
+        std::string path = "/tmp/procmon_test_processes_" + std::to_string(getpid()) + ".db";
+        REQUIRE(engine.Export(std::make_tuple(0, ""), path));
+
+        sqlite3* db;
+        sqlite3_stmt* stmt;
+        REQUIRE(sqlite3_open(path.c_str(), &db) == SQLITE_OK);
+        REQUIRE(sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM processes;", -1, &stmt, nullptr) == SQLITE_OK);
+        REQUIRE(sqlite3_step(stmt) == SQLITE_ROW);
+        CHECK(sqlite3_column_int(stmt, 0) == 2);
+        sqlite3_finalize(stmt);
+        sqlite3_close(db);
+
+        std::remove(path.c_str());
+    }
+}
+
+TEST_CASE("storage engine forgets stacks and processes of a batch that failed", "[Sqlite3StorageEngine]") {
+
+    std::vector<Event> mockSyscalls;
+    mockSyscalls.emplace_back("read");
+
+    // a trace file where storing events of pid 666 fails
+    std::string path = "/tmp/procmon_test_rollback_" + std::to_string(getpid()) + ".db";
+    {
+        Sqlite3StorageEngine empty;
+        CHECK(empty.Initialize(mockSyscalls));
+        REQUIRE(empty.Export(std::make_tuple(0, ""), path));
+    }
+
+    sqlite3* db;
+    REQUIRE(sqlite3_open(path.c_str(), &db) == SQLITE_OK);
+    REQUIRE(sqlite3_exec(db,
+        "CREATE TRIGGER failing BEFORE INSERT ON ebpf WHEN NEW.pid = 666 "
+        "BEGIN SELECT RAISE(ABORT, 'failing'); END;", 0, 0, nullptr) == SQLITE_OK);
+    sqlite3_close(db);
+
+    Sqlite3StorageEngine engine;
+    CHECK(engine.Initialize(mockSyscalls));
+    engine.Load(path);
+
+    MockTelemetry first = makeTelemetry(9000, "First", mockSyscalls[0].Name());
+    first.stackTrace.userIPs = {10, 20, 40};
+    MockTelemetry failing = makeTelemetry(666, "Failing", mockSyscalls[0].Name());
+
+    std::vector<MockTelemetry> batch = {first, failing};
+    CHECK_FALSE(engine.StoreMany(batch.data(), batch.size()));
+    CHECK(engine.QueryByPid(9000).empty());
+
+    // the stack and process are stored again rather than pointing at rows that are gone
+    CHECK(engine.StoreMany(batch.data(), 1));
+    auto results = engine.QueryByPid(9000);
+    REQUIRE(results.size() == 1);
+    CHECK(results[0].processName == "First");
+    CHECK(results[0].stackTrace.userIPs == std::vector<uint64_t>({10, 20, 40}));
+
+    std::remove(path.c_str());
+}
+
+TEST_CASE("storage engine stores part of a reused batch", "[Sqlite3StorageEngine]") {
+
+    std::vector<Event> mockSyscalls;
+    mockSyscalls.emplace_back("write");
+
+    Sqlite3StorageEngine engine;
+    CHECK(engine.Initialize(mockSyscalls));
+
+    std::vector<MockTelemetry> batch;
+    for (pid_t i = 0; i < 3; i++)
+    {
+        batch.push_back(makeTelemetry(7000 + i, "batch", mockSyscalls[0].Name()));
+        batch.back().timestamp = i;
+    }
+
+    SECTION("Only the given number of items is stored") {
+        CHECK(engine.StoreMany(batch.data(), 2));
+        CHECK(engine.Size() == 2);
+        CHECK(engine.QueryByPid(7002).empty());
+    }
+
+    SECTION("The batch can be written over and stored again") {
+        CHECK(engine.StoreMany(batch.data(), 2));
+        batch[0].pid = 7003;
+        batch[0].timestamp = 3;
+        CHECK(engine.StoreMany(batch.data(), 1));
+
+        CHECK(engine.Size() == 3);
+        CHECK(engine.QueryByPid(7000).size() == 1);
+        CHECK(engine.QueryByPid(7003).size() == 1);
+    }
+
+    SECTION("An empty batch isn't stored") {
+        CHECK_FALSE(engine.StoreMany(batch.data(), 0));
+    }
+}
+
+TEST_CASE("storage engine stores batches of records", "[Sqlite3StorageEngine]") {
+
+    std::vector<Event> mockSyscalls;
+    mockSyscalls.emplace_back("connect");
+
+    Sqlite3StorageEngine engine;
+    CHECK(engine.Initialize(mockSyscalls));
+
+    auto process = std::make_shared<ProcessInfo>();
+    process->pid = 8000;
+    process->name = "curl";
+
+    TelemetryBatch batch;
+    for (int i = 0; i < 2; i++)
+    {
+        TelemetryRecord& record = batch.Add();
+        record.pid = 8000;
+        record.sampleRate = 1;
+        record.result = -111;
+        record.timestamp = i;
+        record.syscall = SyscallNumberForName("connect");
+        record.process = batch.AddProcess(process);
+        strcpy(record.comm, "curl-worker");
+        strcpy((char*)record.arguments, "connect arguments");
+
+        uint64_t userIPs[] = {10, 20, 40};
+        record.userIPs = batch.Append(userIPs, sizeof(userIPs));
+
+        const char strings[] = "first\0second";
+        record.strings = batch.Append(strings, sizeof(strings));
+
+        std::string address = "10.1.2.3:443";
+        record.address = batch.Append(address.data(), address.size());
+    }
+
+    SECTION("Records keep their variable length parts") {
+        REQUIRE(engine.StoreMany(batch));
+        auto results = engine.QueryByPid(8000);
+        REQUIRE(results.size() == 2);
+        for (auto& telemetry: results)
+        {
+            CHECK(telemetry.syscall == SyscallNumberForName("connect"));
+            CHECK(telemetry.result == -111);
+            CHECK(telemetry.comm == "curl-worker");
+            CHECK(telemetry.processName == "curl");
+            CHECK(strcmp((const char*)telemetry.arguments, "connect arguments") == 0);
+            CHECK(telemetry.stackTrace.userIPs == std::vector<uint64_t>({10, 20, 40}));
+            CHECK(telemetry.strings == std::vector<std::string>({"first", "second"}));
+            CHECK(telemetry.payload.empty());
+            CHECK(telemetry.address == "10.1.2.3:443");
+        }
+    }
+
+    SECTION("Records copied to another batch keep their variable length parts") {
+        TelemetryBatch merged;
+        merged.AddFrom(batch, 1);
+        merged.AddFrom(batch, 0);
+        batch.Clear();
+
+        REQUIRE(engine.StoreMany(merged));
+        auto results = engine.QueryByPid(8000);
+        REQUIRE(results.size() == 2);
+        for (auto& telemetry: results)
+        {
+            CHECK(telemetry.processName == "curl");
+            CHECK(telemetry.stackTrace.userIPs == std::vector<uint64_t>({10, 20, 40}));
+            CHECK(telemetry.strings == std::vector<std::string>({"first", "second"}));
+            CHECK(telemetry.address == "10.1.2.3:443");
+        }
+    }
+
+    SECTION("A cleared batch can be filled and stored again") {
+        REQUIRE(engine.StoreMany(batch));
+        batch.Clear();
+        CHECK(batch.Empty());
+        CHECK_FALSE(engine.StoreMany(batch));
+
+        TelemetryRecord& record = batch.Add();
+        record.pid = 8001;
+        record.syscall = SyscallNumberForName("connect");
+        record.process = batch.AddProcess(nullptr);
+        strcpy(record.comm, "nc");
+        REQUIRE(engine.StoreMany(batch));
+
+        auto results = engine.QueryByPid(8001);
+        REQUIRE(results.size() == 1);
+        CHECK(results[0].processName == "nc");
+        CHECK(results[0].strings.empty());
+        CHECK(engine.Size() == 3);
+    }
+}
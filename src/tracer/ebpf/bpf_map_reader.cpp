@@ -0,0 +1,242 @@
+/*
+    Procmon-for-Linux
+
+    Copyright (c) Microsoft Corporation
+
+    All rights reserved.
+
+    MIT License
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "bpf_map_reader.h"
+#include "../../logging/easylogging++.h"
+
+#include <errno.h>
+#include <fstream>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/bpf.h>
+
+// Older uapi headers don't know about batch operations
+#define PROCMON_BPF_MAP_LOOKUP_BATCH    24
+
+// Number of entries fetched per batch lookup
+#define BATCH_ENTRIES                   256
+
+#ifndef ENOTSUPP
+#define ENOTSUPP                        524
+#endif
+
+namespace
+{
+    // Layout of the batch part of union bpf_attr
+    struct BatchAttr
+    {
+        uint64_t inBatch;
+        uint64_t outBatch;
+        uint64_t keys;
+        uint64_t values;
+        uint32_t count;
+        uint32_t mapFd;
+        uint64_t elemFlags;
+        uint64_t flags;
+    };
+
+    int Bpf(int cmd, void *attr, size_t size)
+    {
+        return syscall(__NR_bpf, cmd, attr, size);
+    }
+
+    //--------------------------------------------------------------------
+    //
+    // ReadBatched
+    //
+    // Reads the map with BPF_MAP_LOOKUP_BATCH. Returns -1 with errno set
+    // if batch lookups are not supported.
+    //
+    //--------------------------------------------------------------------
+    int ReadBatched(int mapFd, size_t keySize, size_t valueSize, std::vector<uint8_t>& keys, std::vector<uint8_t>& values)
+    {
+        // hash maps use a bucket index as the batch token, size it for either
+        std::vector<uint8_t> inBatch(keySize < sizeof(uint64_t) ? sizeof(uint64_t) : keySize);
+        std::vector<uint8_t> outBatch(inBatch.size());
+        std::vector<uint8_t> chunkKeys(BATCH_ENTRIES * keySize);
+        std::vector<uint8_t> chunkValues(BATCH_ENTRIES * valueSize);
+        bool first = true;
+        int total = 0;
+
+        while (true)
+        {
+            BatchAttr attr = {};
+            attr.inBatch = first ? 0 : (uint64_t)inBatch.data();
+            attr.outBatch = (uint64_t)outBatch.data();
+            attr.keys = (uint64_t)chunkKeys.data();
+            attr.values = (uint64_t)chunkValues.data();
+            attr.count = BATCH_ENTRIES;
+            attr.mapFd = mapFd;
+
+            int ret = Bpf(PROCMON_BPF_MAP_LOOKUP_BATCH, &attr, sizeof(attr));
+            int error = ret < 0 ? errno : 0;
+            if (ret < 0 && error != ENOENT)
+            {
+                errno = error;
+                return -1;
+            }
+
+            keys.insert(keys.end(), chunkKeys.begin(), chunkKeys.begin() + attr.count * keySize);
+            values.insert(values.end(), chunkValues.begin(), chunkValues.begin() + attr.count * valueSize);
+            total += attr.count;
+
+            // ENOENT marks the end of the map
+            if (error == ENOENT)
+            {
+                break;
+            }
+
+            inBatch.swap(outBatch);
+            first = false;
+        }
+
+        return total;
+    }
+
+    //--------------------------------------------------------------------
+    //
+    // ReadByKey
+    //
+    // Reads the map one entry at a time with BPF_MAP_GET_NEXT_KEY.
+    //
+    //--------------------------------------------------------------------
+    int ReadByKey(int mapFd, size_t keySize, size_t valueSize, std::vector<uint8_t>& keys, std::vector<uint8_t>& values)
+    {
+        std::vector<uint8_t> key(keySize);
+        std::vector<uint8_t> nextKey(keySize);
+        std::vector<uint8_t> value(valueSize);
+        bool first = true;
+        int total = 0;
+
+        while (true)
+        {
+            union bpf_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.map_fd = mapFd;
+            attr.key = first ? 0 : (uint64_t)key.data();
+            attr.next_key = (uint64_t)nextKey.data();
+            if (Bpf(BPF_MAP_GET_NEXT_KEY, &attr, sizeof(attr)) != 0)
+            {
+                if (errno == ENOENT)
+                {
+                    break;
+                }
+
+                return -1;
+            }
+
+            memset(&attr, 0, sizeof(attr));
+            attr.map_fd = mapFd;
+            attr.key = (uint64_t)nextKey.data();
+            attr.value = (uint64_t)value.data();
+
+            // entries deleted while walking are simply skipped
+            if (Bpf(BPF_MAP_LOOKUP_ELEM, &attr, sizeof(attr)) == 0)
+            {
+                keys.insert(keys.end(), nextKey.begin(), nextKey.end());
+                values.insert(values.end(), value.begin(), value.end());
+                total++;
+            }
+
+            key.swap(nextKey);
+            first = false;
+        }
+
+        return total;
+    }
+}
+
+//--------------------------------------------------------------------
+//
+// NumPossibleCpus
+//
+// Parses /sys/devices/system/cpu/possible, e.g. "0-63" or "0,2-3".
+//
+//--------------------------------------------------------------------
+int BpfMapReader::NumPossibleCpus()
+{
+    static int possibleCpus = 0;
+    if (possibleCpus > 0)
+    {
+        return possibleCpus;
+    }
+
+    std::ifstream file("/sys/devices/system/cpu/possible");
+    std::string range;
+    int count = 0;
+    while (std::getline(file, range, ','))
+    {
+        int first = 0, last = 0;
+        int fields = sscanf(range.c_str(), "%d-%d", &first, &last);
+        if (fields == 1)
+        {
+            count++;
+        }
+        else if (fields == 2)
+        {
+            count += last - first + 1;
+        }
+    }
+
+    possibleCpus = count > 0 ? count : sysconf(_SC_NPROCESSORS_CONF);
+    return possibleCpus;
+}
+
+//--------------------------------------------------------------------
+//
+// PerCpuValueSize
+//
+// Each CPU gets its own value, rounded up to 8 bytes.
+//
+//--------------------------------------------------------------------
+size_t BpfMapReader::PerCpuValueSize(size_t valueSize)
+{
+    return ((valueSize + 7) & ~(size_t)7) * NumPossibleCpus();
+}
+
+//--------------------------------------------------------------------
+//
+// ReadAll
+//
+// Reads every entry of the map. keys and values are appended to.
+//
+//--------------------------------------------------------------------
+int BpfMapReader::ReadAll(int mapFd, size_t keySize, size_t valueSize, std::vector<uint8_t>& keys, std::vector<uint8_t>& values)
+{
+    int count = ReadBatched(mapFd, keySize, valueSize, keys, values);
+    if (count >= 0)
+    {
+        return count;
+    }
+
+    if (errno != EINVAL && errno != ENOTSUPP && errno != EOPNOTSUPP)
+    {
+        LOG(ERROR) << "Failed to batch read map: " << strerror(errno);
+        return -1;
+    }
+
+    keys.clear();
+    values.clear();
+    count = ReadByKey(mapFd, keySize, valueSize, keys, values);
+    if (count < 0)
+    {
+        LOG(ERROR) << "Failed to read map: " << strerror(errno);
+    }
+
+    return count;
+}
@@ -0,0 +1,41 @@
+/*
+    Procmon-for-Linux
+
+    Copyright (c) Microsoft Corporation
+
+    All rights reserved.
+
+    MIT License
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+//
+// Helpers for reading whole BPF maps from userland through the bpf()
+// syscall. Values of per-CPU maps hold one 8 byte aligned slot per
+// possible CPU.
+//
+namespace BpfMapReader
+{
+    // Number of possible CPUs, the number of slots in a per-CPU value
+    int NumPossibleCpus();
+
+    // Size of a value as returned to userland for a map with valueSize values
+    size_t PerCpuValueSize(size_t valueSize);
+
+    // Reads every entry of a hash map into keys and values, using batch
+    // lookups (5.6+) and falling back to walking the keys one by one.
+    // Returns the number of entries read or -1 on error.
+    int ReadAll(int mapFd, size_t keySize, size_t valueSize, std::vector<uint8_t>& keys, std::vector<uint8_t>& values);
+}
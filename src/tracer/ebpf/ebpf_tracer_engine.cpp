@@ -15,10 +15,17 @@
 */
 
 #include "ebpf_tracer_engine.h"
+#include "bpf_map_reader.h"
 #include "../../logging/easylogging++.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include <limits.h>
 #include <unordered_map>
+#include <sys/utsname.h>
+#include <arpa/inet.h>
 
 #include "bcc_elf.h"
 #include "bcc_perf_map.h"
@@ -36,10 +43,13 @@ size_t  g_pwEntrySize = 0;
 bool debugTrace = false;
 std::vector<Event> events;
 std::vector<struct SyscallSchema> schemas = Utils::CollectSyscallSchema();
+std::vector<int> schemaIndexes = Utils::IndexSyscallSchema(schemas);
 void* symResolver = NULL;
 std::vector<int> pids;
+TracerOptions tracerOptions;
 pthread_cond_t cond = PTHREAD_COND_INITIALIZER;;
 pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;;
+bool telemetryIsReady = false;
 
 const ebpfSyscallRTPprog        RTPenterProgs[] =
 {
@@ -51,14 +61,38 @@ const ebpfSyscallRTPprog        RTPexitProgs[] =
     {"genericRawExit", EBPF_GENERIC_SYSCALL}
 };
 
-const ebpfTelemetryMapObject mapObjects[4] =
+const ebpfTracepointProg        otherTPprogs[] =
+{
+    {"procmonProcessFork", "task", "task_newtask"},
+    {"procmonProcessExec", "sched", "sched_process_exec"},
+    {"procmonProcessExit", "sched", "sched_process_exit"},
+    {"procmonSchedSwitch", "sched", "sched_switch"}   // must stay last, see Poll
+};
+
+// eventRingBuffer must stay last, it only exists in the 5.8+ objects
+// and is left out of the map count on older kernels.
+const ebpfTelemetryMapObject mapObjects[14] =
 {
     {"configuration", 0, NULL, NULL},
     {"pids", 0, NULL, NULL},
     {"runstate", 0, NULL, NULL},
-    {"syscalls", 0, NULL, NULL}
+    {"syscalls", 0, NULL, NULL},
+    {"syscallFlags", 0, NULL, NULL},
+    {"stackTraces", 0, NULL, NULL},
+    {"syscallSummary", 0, NULL, NULL},
+    {"errnoFilter", 0, NULL, NULL},
+    {"procmonStats", 0, NULL, NULL},
+    {"syscallsMap", 0, NULL, NULL},
+    {"processes", 0, NULL, NULL},
+    {"processImages", 0, NULL, NULL},
+    {"exitedProcesses", 0, NULL, NULL},
+    {"eventRingBuffer", 0, NULL, NULL}
 };
 
+// Maps of the objects without eventRingBuffer
+#define MAP_COUNT_NO_RINGBUF    (sizeof(mapObjects) / sizeof(*mapObjects) - 1)
+static_assert(RINGBUF_INDEX == MAP_COUNT_NO_RINGBUF, "eventRingBuffer must be the last map");
+
 // this holds the FDs for the above maps.
 // mapObjects above gets passed into sysinternalsEBPF config during telemetryStart.
 // mapFds also gets passed into telemetryStart. mapFds gets populated during telemetryStart
@@ -102,6 +136,63 @@ void logHandler(const char *format, va_list args)
     //vfprintf(stderr, format, args);
 }
 
+//--------------------------------------------------------------------
+//
+// TraceSyscall
+//
+// Writes the schema and flags of a syscall into the maps the
+// kernel programs check at sys_enter.
+//
+//--------------------------------------------------------------------
+void TraceSyscall(const Event& event)
+{
+    int num = ::Utils::GetSyscallNumberForName(event.Name());
+    if(num >= 0 && schemaIndexes[num] >= 0)
+    {
+        auto schemaItr = schemas.begin() + schemaIndexes[num];
+        telemetryMapUpdateElem(mapFds[SYSCALL_INDEX], &num, static_cast<void*>(&(*schemaItr)), MAP_UPDATE_CREATE_OR_OVERWRITE);
+
+        uint32_t flags = SYSCALL_FLAG_TRACED;
+        auto sampleRate = tracerOptions.sampleRates.find(event.Name());
+        if (sampleRate != tracerOptions.sampleRates.end())
+        {
+            flags |= sampleRate->second << SYSCALL_SAMPLE_SHIFT;
+        }
+
+        for (int arg = 0; arg < schemaItr->usedArgCount && arg < 6; arg++)
+        {
+            if (::Utils::IsStringArg(*schemaItr, arg))
+            {
+                flags |= (1 << arg) << SYSCALL_STRING_ARGS_SHIFT;
+            }
+        }
+
+        bool write = false;
+        int payloadArg = ::Utils::GetPayloadArg(*schemaItr, write);
+        if (payloadArg >= 0 && (write ? tracerOptions.snaplenWrite : tracerOptions.snaplenRead) > 0)
+        {
+            flags |= (payloadArg + 1) << SYSCALL_PAYLOAD_ARG_SHIFT;
+            if (write)
+            {
+                flags |= SYSCALL_FLAG_PAYLOAD_WRITE;
+            }
+        }
+
+        bool filled = false;
+        int addressArg = ::Utils::GetSocketAddressArg(*schemaItr, filled);
+        if (addressArg >= 0)
+        {
+            flags |= (addressArg + 1) << SYSCALL_SOCKADDR_ARG_SHIFT;
+            if (filled)
+            {
+                flags |= SYSCALL_FLAG_SOCKADDR_OUT;
+            }
+        }
+
+        telemetryMapUpdateElem(mapFds[SYSCALL_FLAGS_INDEX], &num, &flags, MAP_UPDATE_CREATE_OR_OVERWRITE);
+    }
+}
+
 //--------------------------------------------------------------------
 //
 // telemetryReady
@@ -112,9 +203,15 @@ void logHandler(const char *format, va_list args)
 void telemetryReady()
 {
     //
-    // Set PID
+    // Hold the lock while the maps are filled so that pids and syscalls
+    // added or removed at runtime in the meantime aren't lost
+    //
+    pthread_mutex_lock(&mutex);
+
+    //
+    // Set PID, configuration items are 64 bit
     //
-    pid_t act_pid = getpid();
+    uint64_t act_pid = getpid();
     int key = CONFIG_PID_KEY;
     telemetryMapUpdateElem(mapFds[CONFIG_INDEX], &key, &act_pid, MAP_UPDATE_CREATE_OR_OVERWRITE);
 
@@ -128,42 +225,111 @@ void telemetryReady()
     //
     // Init the PIDs
     //
-    int init_pid = -1;
-    for(int i=0; i<MAX_PIDS; i++)
+    uint32_t pidValue = PID_FILTER_USER;
+    for(int i=0; i<pids.size(); i++)
     {
-       telemetryMapUpdateElem(mapFds[PIDS_INDEX], &i, &init_pid, MAP_UPDATE_CREATE_OR_OVERWRITE);
+        telemetryMapUpdateElem(mapFds[PIDS_INDEX], &pids[i], &pidValue, MAP_UPDATE_CREATE_OR_OVERWRITE);
     }
 
-    for(int i=0; i<pids.size(); i++)
+    uint64_t configValue = pids.size() > 0 ? 1 : 0;
+    key = CONFIG_PID_FILTER_KEY;
+    telemetryMapUpdateElem(mapFds[CONFIG_INDEX], &key, &configValue, MAP_UPDATE_CREATE_OR_OVERWRITE);
+
+    configValue = tracerOptions.followChildren ? 1 : 0;
+    key = CONFIG_FOLLOW_CHILDREN_KEY;
+    telemetryMapUpdateElem(mapFds[CONFIG_INDEX], &key, &configValue, MAP_UPDATE_CREATE_OR_OVERWRITE);
+
+    //
+    // Set how user stacks are captured
+    //
+    configValue = tracerOptions.stackIds ? STACK_MODE_ID : STACK_MODE_FRAMES;
+    key = CONFIG_STACK_MODE_KEY;
+    telemetryMapUpdateElem(mapFds[CONFIG_INDEX], &key, &configValue, MAP_UPDATE_CREATE_OR_OVERWRITE);
+
+    //
+    // Aggregate in the kernel instead of sending events
+    //
+    configValue = tracerOptions.summary ? 1 : 0;
+    key = CONFIG_SUMMARY_MODE_KEY;
+    telemetryMapUpdateElem(mapFds[CONFIG_INDEX], &key, &configValue, MAP_UPDATE_CREATE_OR_OVERWRITE);
+
+    //
+    // Set the duration and result code predicates
+    //
+    configValue = tracerOptions.minDurationNs;
+    key = CONFIG_MIN_DURATION_KEY;
+    telemetryMapUpdateElem(mapFds[CONFIG_INDEX], &key, &configValue, MAP_UPDATE_CREATE_OR_OVERWRITE);
+
+    configValue = tracerOptions.errorsOnly ? 1 : 0;
+    key = CONFIG_ERRORS_ONLY_KEY;
+    telemetryMapUpdateElem(mapFds[CONFIG_INDEX], &key, &configValue, MAP_UPDATE_CREATE_OR_OVERWRITE);
+
+    uint32_t errnoValue = 1;
+    for (int error : tracerOptions.errnos)
     {
-        telemetryMapUpdateElem(mapFds[PIDS_INDEX], &i, &pids[i], MAP_UPDATE_CREATE_OR_OVERWRITE);
+        telemetryMapUpdateElem(mapFds[ERRNO_FILTER_INDEX], &error, &errnoValue, MAP_UPDATE_CREATE_OR_OVERWRITE);
     }
 
+    configValue = tracerOptions.errnos.size() > 0 ? 1 : 0;
+    key = CONFIG_ERRNO_FILTER_KEY;
+    telemetryMapUpdateElem(mapFds[CONFIG_INDEX], &key, &configValue, MAP_UPDATE_CREATE_OR_OVERWRITE);
+
+    configValue = tracerOptions.rateLimit;
+    key = CONFIG_RATE_LIMIT_KEY;
+    telemetryMapUpdateElem(mapFds[CONFIG_INDEX], &key, &configValue, MAP_UPDATE_CREATE_OR_OVERWRITE);
+
+    configValue = tracerOptions.maxStringLength;
+    key = CONFIG_MAX_STRING_KEY;
+    telemetryMapUpdateElem(mapFds[CONFIG_INDEX], &key, &configValue, MAP_UPDATE_CREATE_OR_OVERWRITE);
+
+    configValue = tracerOptions.snaplenRead;
+    key = CONFIG_SNAPLEN_READ_KEY;
+    telemetryMapUpdateElem(mapFds[CONFIG_INDEX], &key, &configValue, MAP_UPDATE_CREATE_OR_OVERWRITE);
+
+    configValue = tracerOptions.snaplenWrite;
+    key = CONFIG_SNAPLEN_WRITE_KEY;
+    telemetryMapUpdateElem(mapFds[CONFIG_INDEX], &key, &configValue, MAP_UPDATE_CREATE_OR_OVERWRITE);
+
+    configValue = tracerOptions.payloadBudget;
+    key = CONFIG_PAYLOAD_BUDGET_KEY;
+    telemetryMapUpdateElem(mapFds[CONFIG_INDEX], &key, &configValue, MAP_UPDATE_CREATE_OR_OVERWRITE);
+
     //
     // Set targeted syscalls
     //
     for (auto event : events)
     {
-        auto schemaItr = std::find_if(schemas.begin(), schemas.end(), [event](auto s) -> bool {return event.Name().compare(s.syscallName) == 0; });
-        if(schemaItr != schemas.end())
-        {
-            std::string str = schemaItr->syscallName;
-            char* charPtr = new char[str.size() + 1];
-            std::strcpy(charPtr, str.c_str());
-
-            int num = ::Utils::GetSyscallNumberForName(event.Name());
-            telemetryMapUpdateElem(mapFds[SYSCALL_INDEX], &num, static_cast<void*>(&(*schemaItr)), MAP_UPDATE_CREATE_OR_OVERWRITE);
-        }
+        TraceSyscall(event);
     }
 
     //
-    // Signal the consuming thread that telemetry has been initialized
+    // Signal the consuming threads that telemetry has been initialized
     //
-    pthread_mutex_lock(&mutex);
-    pthread_cond_signal(&cond);
+    telemetryIsReady = true;
+    pthread_cond_broadcast(&cond);
     pthread_mutex_unlock(&mutex);
 }
 
+//--------------------------------------------------------------------
+//
+// KernelSupportsRingBuffer
+//
+// BPF_MAP_TYPE_RINGBUF is available from 5.8 onwards.
+//
+//--------------------------------------------------------------------
+bool KernelSupportsRingBuffer()
+{
+    struct utsname name;
+    int major = 0, minor = 0;
+
+    if (uname(&name) != 0 || sscanf(name.release, "%d.%d", &major, &minor) != 2)
+    {
+        return false;
+    }
+
+    return major > 5 || (major == 5 && minor >= 8);
+}
+
 //--------------------------------------------------------------------
 //
 // configChange
@@ -239,7 +405,25 @@ void SetBootTime()
 void EbpfTracerEngine::Initialize()
 {
     PollingThread = std::thread(&EbpfTracerEngine::Poll, this);
-    ConsumerThread = std::thread(&EbpfTracerEngine::Consume, this);
+
+    if (EventQueues.size() > 1)
+    {
+        for (size_t decoder = 0; decoder < EventQueues.size(); decoder++)
+        {
+            DecoderThreads.emplace_back(&EbpfTracerEngine::Decode, this, decoder);
+        }
+        ConsumerThread = std::thread(&EbpfTracerEngine::Merge, this);
+    }
+    else
+    {
+        ConsumerThread = std::thread(&EbpfTracerEngine::Consume, this);
+    }
+    WriterThread = std::thread(&EbpfTracerEngine::Write, this);
+
+    if (UseRingBuffer)
+    {
+        RingBufferThread = std::thread(&EbpfTracerEngine::PollRingBuffer, this);
+    }
 }
 
 
@@ -250,11 +434,29 @@ void EbpfTracerEngine::Initialize()
 // Constructor for the eBPF tracer engine.
 //
 //--------------------------------------------------------------------
-EbpfTracerEngine::EbpfTracerEngine(std::shared_ptr<IStorageEngine> storageEngine, std::vector<Event> targetEvents, std::vector<int> pidList)
+EbpfTracerEngine::EbpfTracerEngine(std::shared_ptr<IStorageEngine> storageEngine, std::vector<Event> targetEvents, std::vector<int> pidList, TracerOptions options)
     : ITracerEngine(storageEngine, targetEvents), Schemas(Utils::CollectSyscallSchema())
 {
     events = targetEvents;
     pids = pidList;
+    tracerOptions = options;
+
+    size_t decoders = std::max(options.decoders, 1U);
+    for (size_t decoder = 0; decoder < decoders; decoder++)
+    {
+        EventQueues.emplace_back(new SpscRing(std::max(EVENT_QUEUE_SIZE / decoders, (size_t)EVENT_QUEUE_MIN_SIZE)));
+    }
+    DecodedBatches.resize(decoders);
+    DecodedWatermarks.resize(decoders, 0);
+
+    // the consumer holds one batch, the writer gets the others as it needs them
+    FreeWriteBatches.resize(WRITE_BATCH_COUNT - 1);
+    for (auto& batch : FreeWriteBatches)
+    {
+        batch.Reserve(DECODE_BATCH_SIZE, DECODE_BATCH_SIZE * 1024);
+    }
+    UseRingBuffer = KernelSupportsRingBuffer();
+    LostEvents.resize(BpfMapReader::NumPossibleCpus(), 0);
 }
 
 //--------------------------------------------------------------------
@@ -280,9 +482,20 @@ void EbpfTracerEngine::SetRunState(int runState)
 //--------------------------------------------------------------------
 EbpfTracerEngine::~EbpfTracerEngine()
 {
-    EventQueue.cancel();
+    Cancel();
     PollingThread.join();
     ConsumerThread.join();
+    WriterThread.join();
+
+    for (auto& decoder : DecoderThreads)
+    {
+        decoder.join();
+    }
+
+    if (RingBufferThread.joinable())
+    {
+        RingBufferThread.join();
+    }
 }
 
 //--------------------------------------------------------------------
@@ -295,19 +508,72 @@ EbpfTracerEngine::~EbpfTracerEngine()
 //--------------------------------------------------------------------
 void EbpfTracerEngine::PerfCallbackWrapper(/* EbpfTracerEngine* */void *cbCookie, int cpu, void* rawMessage, uint32_t rawMessageSize)
 {
-    static_cast<EbpfTracerEngine *>(cbCookie)->PerfCallback(rawMessage, rawMessageSize);
+    static_cast<EbpfTracerEngine *>(cbCookie)->PerfCallback(cpu, rawMessage, rawMessageSize);
+}
+
+//--------------------------------------------------------------------
+//
+// RingBufferCallbackWrapper
+//
+// Wrapper for the PerfCallback function. Called for every record
+// committed to the shared ring buffer.
+//
+//--------------------------------------------------------------------
+void EbpfTracerEngine::RingBufferCallbackWrapper(/* EbpfTracerEngine* */void *cbCookie, void* rawMessage, uint32_t rawMessageSize)
+{
+    static_cast<EbpfTracerEngine *>(cbCookie)->PerfCallback(-1, rawMessage, rawMessageSize);
 }
 
 //--------------------------------------------------------------------
 //
 // PerfCallback
 //
-// Called when new events arrive in the perf buffer.
+// Called when new events arrive in the perf buffer, with the CPU
+// the event came from or -1 for the shared ring buffer.
 //
 //--------------------------------------------------------------------
-void EbpfTracerEngine::PerfCallback(void *rawMessage, int rawMessageSize)
+void EbpfTracerEngine::PerfCallback(int cpu, void *rawMessage, int rawMessageSize)
 {
-    EventQueue.push(*static_cast<SyscallEvent*>(rawMessage));
+    //
+    // Records only carry the used stack frames, argument bytes, strings,
+    // payload and address, so copy what was sent and make sure the counts
+    // agree with the size
+    //
+    if (rawMessageSize < (int)SYSCALL_EVENT_HEADER_SIZE)
+    {
+        return;
+    }
+
+    //
+    // The record is copied straight into the ring, so nothing is allocated
+    // per event. If the consumer fell too far behind the event is dropped.
+    // Shared ring buffer records are spread over the decoders round robin,
+    // the ring is in the order syscalls returned, not timestamp order, so
+    // this loses nothing Merge doesn't put back.
+    //
+    SpscRing& queue = *EventQueues[(cpu >= 0 ? cpu : NextEventQueue++) % EventQueues.size()];
+
+    size_t size = std::min((size_t)rawMessageSize, sizeof(SyscallEvent));
+    SyscallEvent* event = static_cast<SyscallEvent*>(queue.reserve(size));
+    if (event == nullptr)
+    {
+        QueueDropped++;
+        return;
+    }
+
+    memcpy(event, rawMessage, size);
+
+    size_t dataSize = size - SYSCALL_EVENT_HEADER_SIZE;
+    event->userStackCount = std::min((size_t)event->userStackCount, std::min((size_t)MAX_STACK_FRAMES, dataSize / sizeof(uint64_t)));
+    event->bufferLength = std::min((size_t)event->bufferLength, std::min((size_t)MAX_BUFFER, dataSize - event->userStackCount * sizeof(uint64_t)));
+    event->stringsLength = std::min((size_t)event->stringsLength, std::min((size_t)MAX_STRINGS_BYTES, dataSize - event->userStackCount * sizeof(uint64_t) - event->bufferLength));
+    event->payloadLength = std::min((size_t)event->payloadLength, std::min((size_t)MAX_PAYLOAD_BYTES, dataSize - event->userStackCount * sizeof(uint64_t) - event->bufferLength - event->stringsLength));
+    if (dataSize - event->userStackCount * sizeof(uint64_t) - event->bufferLength - event->stringsLength - event->payloadLength < sizeof(SocketAddress))
+    {
+        event->addressLength = 0;
+    }
+
+    queue.commit();
 }
 
 //--------------------------------------------------------------------
@@ -319,19 +585,23 @@ void EbpfTracerEngine::PerfCallback(void *rawMessage, int rawMessageSize)
 //--------------------------------------------------------------------
 void EbpfTracerEngine::PerfLostCallbackWrapper(void *cbCookie, int cpu, uint64_t lost)
 {
-    static_cast<EbpfTracerEngine*>(cbCookie)->PerfLostCallback(lost);
+    static_cast<EbpfTracerEngine*>(cbCookie)->PerfLostCallback(cpu, lost);
 }
 
 //--------------------------------------------------------------------
 //
 // PerfLostCallback
 //
-// Lost events callback.
+// Lost events callback. Keeps a running count per CPU.
 //
 //--------------------------------------------------------------------
-void EbpfTracerEngine::PerfLostCallback(uint64_t lost)
+void EbpfTracerEngine::PerfLostCallback(int cpu, uint64_t lost)
 {
-    return;
+    std::lock_guard<std::mutex> lock(LostEventsLock);
+    if (cpu >= 0 && cpu < LostEvents.size())
+    {
+        LostEvents[cpu] += lost;
+    }
 }
 
 //--------------------------------------------------------------------
@@ -353,6 +623,16 @@ void EbpfTracerEngine::Poll()
 
     SetBootTime();
 
+    //
+    // procmonSchedSwitch runs on every context switch, so it is only
+    // attached when kernel stacks are asked for
+    //
+    unsigned int otherTPprogCount = sizeof(otherTPprogs) / sizeof(*otherTPprogs);
+    if (!tracerOptions.kernelStacks)
+    {
+        otherTPprogCount--;
+    }
+
     const ebpfTelemetryObject   kernelObjs[] =
     {
         {
@@ -363,7 +643,8 @@ void EbpfTracerEngine::Poll()
             sizeof(RTPexitProgs) / sizeof(*RTPexitProgs),
             RTPexitProgs,
             activeSyscalls,
-            0, NULL
+            otherTPprogCount,
+            otherTPprogs
         },
         {
             KERN_5_2_OBJ, {5, 2}, {5, 3}, true,
@@ -373,7 +654,8 @@ void EbpfTracerEngine::Poll()
             sizeof(RTPexitProgs) / sizeof(*RTPexitProgs),
             RTPexitProgs,
             activeSyscalls,
-            0, NULL
+            otherTPprogCount,
+            otherTPprogs
         },
         {
             KERN_5_3_5_5_OBJ, {5, 3}, {5, 6}, true,
@@ -383,17 +665,30 @@ void EbpfTracerEngine::Poll()
             sizeof(RTPexitProgs) / sizeof(*RTPexitProgs),
             RTPexitProgs,
             activeSyscalls,
-            0, NULL
+            otherTPprogCount,
+            otherTPprogs
         },
         {
-            KERN_5_6__OBJ, {5, 6}, {0, 0}, true,
+            KERN_5_6_5_7_OBJ, {5, 6}, {5, 8}, true,
             0, NULL, 0, NULL, // No traditional tracepoint programs
             sizeof(RTPenterProgs) / sizeof(*RTPenterProgs),
             RTPenterProgs,
             sizeof(RTPexitProgs) / sizeof(*RTPexitProgs),
             RTPexitProgs,
             activeSyscalls,
-            0, NULL
+            otherTPprogCount,
+            otherTPprogs
+        },
+        {
+            KERN_5_8__OBJ, {5, 8}, {0, 0}, true,
+            0, NULL, 0, NULL, // No traditional tracepoint programs
+            sizeof(RTPenterProgs) / sizeof(*RTPenterProgs),
+            RTPenterProgs,
+            sizeof(RTPexitProgs) / sizeof(*RTPexitProgs),
+            RTPexitProgs,
+            activeSyscalls,
+            otherTPprogCount,
+            otherTPprogs
         }
     };
 
@@ -407,7 +702,8 @@ void EbpfTracerEngine::Poll()
             sizeof(RTPexitProgs) / sizeof(*RTPexitProgs),
             RTPexitProgs,
             activeSyscalls,
-            0, NULL
+            otherTPprogCount,
+            otherTPprogs
         },
         {
             KERN_5_2_CORE_OBJ, {5, 2}, {5, 3}, true,
@@ -417,7 +713,8 @@ void EbpfTracerEngine::Poll()
             sizeof(RTPexitProgs) / sizeof(*RTPexitProgs),
             RTPexitProgs,
             activeSyscalls,
-            0, NULL
+            otherTPprogCount,
+            otherTPprogs
         },
         {
             KERN_5_3_5_5_CORE_OBJ, {5, 3}, {5, 6}, true,
@@ -427,17 +724,30 @@ void EbpfTracerEngine::Poll()
             sizeof(RTPexitProgs) / sizeof(*RTPexitProgs),
             RTPexitProgs,
             activeSyscalls,
-            0, NULL
+            otherTPprogCount,
+            otherTPprogs
+        },
+        {
+            KERN_5_6_5_7_CORE_OBJ, {5, 6}, {5, 8}, true,
+            0, NULL, 0, NULL, // No traditional tracepoint programs
+            sizeof(RTPenterProgs) / sizeof(*RTPenterProgs),
+            RTPenterProgs,
+            sizeof(RTPexitProgs) / sizeof(*RTPexitProgs),
+            RTPexitProgs,
+            activeSyscalls,
+            otherTPprogCount,
+            otherTPprogs
         },
         {
-            KERN_5_6__CORE_OBJ, {5, 6}, {0, 0}, true,
+            KERN_5_8__CORE_OBJ, {5, 8}, {0, 0}, true,
             0, NULL, 0, NULL, // No traditional tracepoint programs
             sizeof(RTPenterProgs) / sizeof(*RTPenterProgs),
             RTPenterProgs,
             sizeof(RTPexitProgs) / sizeof(*RTPexitProgs),
             RTPexitProgs,
             activeSyscalls,
-            0, NULL
+            otherTPprogCount,
+            otherTPprogs
         }
     };
 
@@ -451,7 +761,7 @@ void EbpfTracerEngine::Poll()
         btfEnabled ? kernelObjs_core : kernelObjs,
         sizeof(defPaths) / sizeof(*defPaths),
         defPaths,
-        sizeof(mapObjects) / sizeof(*mapObjects),
+        UseRingBuffer ? sizeof(mapObjects) / sizeof(*mapObjects) : MAP_COUNT_NO_RINGBUF,
         mapObjects,
         NULL,
         debugTrace
@@ -466,6 +776,162 @@ void EbpfTracerEngine::Poll()
     return;
 }
 
+//--------------------------------------------------------------------
+//
+// WaitForTelemetry
+//
+// Blocks until sysinternalsEBPF is ready (telemetryReady is completed)
+// or the tracer is cancelled. Returns true if telemetry is ready.
+//
+//--------------------------------------------------------------------
+bool EbpfTracerEngine::WaitForTelemetry()
+{
+    pthread_mutex_lock(&mutex);
+    while (!telemetryIsReady && !IsCancelled())
+    {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += 100 * 1000 * 1000;
+        if (deadline.tv_nsec >= 1000 * 1000 * 1000)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000 * 1000 * 1000;
+        }
+
+        pthread_cond_timedwait(&cond, &mutex, &deadline);
+    }
+
+    bool ready = telemetryIsReady;
+    pthread_mutex_unlock(&mutex);
+
+    return ready;
+}
+
+//--------------------------------------------------------------------
+//
+// PollRingBuffer
+//
+// Polls the shared ring buffer for new events. Records come out of
+// the ring in the order they were committed across all CPUs.
+//
+//--------------------------------------------------------------------
+void EbpfTracerEngine::PollRingBuffer()
+{
+    if (!WaitForTelemetry())
+    {
+        return;
+    }
+
+    if (!RingBuffer.Open(mapFds[RINGBUF_INDEX], RINGBUF_SIZE, RingBufferCallbackWrapper, this))
+    {
+        LOG(ERROR) << "Failed to open the event ring buffer";
+        return;
+    }
+
+    while (!IsCancelled() && RunState != TRACER_STOP)
+    {
+        if (RingBuffer.Poll(100) < 0)
+        {
+            LOG(ERROR) << "Failed to poll the event ring buffer: " << strerror(errno);
+            break;
+        }
+    }
+
+    RingBuffer.Close();
+}
+
+//--------------------------------------------------------------------
+//
+// DecodeEvent
+//
+// Decodes a raw event straight from the ring into a fixed layout
+// record, with its variable length parts in the arena of the batch.
+// Batches are cleared rather than freed once stored, so after the
+// first few batches nothing is allocated per event.
+//
+//--------------------------------------------------------------------
+void EbpfTracerEngine::DecodeEvent(const SyscallEvent* event, TelemetryBatch& batch)
+{
+    TelemetryRecord& record = batch.Add();
+
+    record.pid = event->pid;
+
+    //
+    // Since symbol resolution takes a substantial amount of time we only
+    // store the IPs during event processing, otherwise we end up saturating
+    // the perf buffer. When a user clicks into an event we resolve the
+    // symbols at that time.
+    //
+    if (event->userStackId >= 0)
+    {
+        auto frames = GetStackFramesForId(event->userStackId);
+        record.userIPs = batch.Append(frames->data(), frames->size() * sizeof(uint64_t));
+    }
+    else
+    {
+        record.userIPs = batch.Append(event->data, event->userStackCount * sizeof(uint64_t));
+    }
+    if (event->kernelStackId >= 0)
+    {
+        auto frames = GetStackFramesForId(event->kernelStackId);
+        record.kernelIPs = batch.Append(frames->data(), frames->size() * sizeof(uint64_t));
+    }
+
+    memcpy(record.comm, event->comm, sizeof(record.comm));
+    record.process = batch.AddProcess(GetProcess(*event));
+    record.syscall = event->sysnum;
+
+    if((int64_t)event->ret < 0)
+    {
+        constexpr uint64_t sign_bits = ~uint64_t{} << 63;
+        record.result = (int)(-1 * (event->ret & sign_bits) + (event->ret & ~sign_bits));
+    }
+    else
+    {
+        record.result = event->ret;
+    }
+
+    record.duration = event->duration_ns;
+    memcpy(record.arguments, event->data + event->userStackCount * sizeof(uint64_t), event->bufferLength);
+    record.timestamp = event->timestamp;
+    record.sampleRate = event->sampleRate > 0 ? event->sampleRate : 1;
+
+    // the NUL terminated string arguments are kept as they are
+    const uint8_t* strings = event->data + event->userStackCount * sizeof(uint64_t) + event->bufferLength;
+    record.strings = batch.Append(strings, event->stringsLength);
+
+    const uint8_t* payload = strings + event->stringsLength;
+    record.payload = batch.Append(payload, event->payloadLength);
+
+    if (event->addressLength >= sizeof(SocketAddress))
+    {
+        SocketAddress address;
+        memcpy(&address, payload + event->payloadLength, sizeof(address));
+        std::string formatted = FormatSocketAddress(address);
+        record.address = batch.Append(formatted.data(), formatted.size());
+    }
+}
+
+//--------------------------------------------------------------------
+//
+// ElapsedNs
+//
+// Nanoseconds since start, for timing the stages of the pipeline.
+//
+//--------------------------------------------------------------------
+static uint64_t ElapsedNs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The clock of bpf_ktime_get_ns, which event timestamps come from
+static uint64_t MonotonicNs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
 //--------------------------------------------------------------------
 //
 // Consume
@@ -478,17 +944,15 @@ void EbpfTracerEngine::Consume()
     //
     // We wait until sysinternalsEBPF is ready (telemetryReady is completed)
     //
-    pthread_mutex_lock(&mutex);
-    pthread_cond_wait(&cond, &mutex);
-    pthread_mutex_unlock(&mutex);
+    WaitForTelemetry();
 
-    // blocking pop return optional<T>, evaluates to "true" if we get a value
-    // "false" if we've been cancelled
     // auto stacks = BPF->get_stack_table("stack_traces");
-    std::vector<ITelemetry> batch;
-    size_t batchSize = 50;
-    batch.reserve(batchSize);
-    while (!EventQueue.isCancelled())
+    SpscRing& queue = *EventQueues.front();
+    TelemetryBatch batch;
+    batch.Reserve(DECODE_BATCH_SIZE, DECODE_BATCH_SIZE * 1024);
+    auto decode = [&](const uint8_t* data, uint32_t size) { DecodeEvent(reinterpret_cast<const SyscallEvent*>(data), batch); };
+
+    while (!IsCancelled())
     {
         if(RunState == TRACER_STOP) break;
 
@@ -498,62 +962,31 @@ void EbpfTracerEngine::Consume()
             continue;
         }
 
-        auto event = EventQueue.pop();
-
-        if (!event.has_value())
-        {
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-            continue;
-        }
-
-        if (batch.size() >= batchSize)
-        {
-            auto res = _storageEngine->StoreMany(batch);
-            // Free memory used for the arguments
-            for (ITelemetry& datam: batch)
-            {
-                free(datam.arguments);
-                datam.arguments = NULL;
-            }
-
-            batch.clear();
-        }
+        EvictExitedProcesses();
 
-        std::string syscall;
-        for(auto sys : syscalls)
+        // wait returns false if we've been cancelled or timed out, a partial
+        // batch is stored once no more events arrived for a little while
+        if (!queue.wait(batch.Empty() ? 100 : 10))
         {
-            if(sys.number == event->sysnum)
+            if (!batch.Empty())
             {
-                syscall = sys.name;
+                HandToWriter(batch);
             }
+            continue;
         }
 
-        ITelemetry tel;
-        tel.pid = event->pid;
-        tel.stackTrace = GetStackTraceForIPs(event->pid, event->userStack, event->userStackCount);
-        tel.comm = std::string(event->comm);
-        tel.processName = std::string(event->comm);
-        tel.syscall = syscall;
+        auto start = std::chrono::steady_clock::now();
+        queue.popBatch(decode, DECODE_BATCH_SIZE - batch.Size());
+        DecodeTime += ElapsedNs(start);
 
-        if((int64_t)event->ret < 0)
-        {
-            constexpr uint64_t sign_bits = ~uint64_t{} << 63;
-            tel.result = (int)(-1 * (event->ret & sign_bits) + (event->ret & ~sign_bits));
-        }
-        else
+        if (batch.Size() >= DECODE_BATCH_SIZE)
         {
-            tel.result = event->ret;
+            HandToWriter(batch);
         }
-
-        tel.duration = event->duration_ns;
-        tel.arguments = (unsigned char*) malloc(MAX_BUFFER);
-        memset(tel.arguments, 0, MAX_BUFFER);
-        memcpy(tel.arguments, event->buffer, MAX_BUFFER);
-        tel.timestamp = event->timestamp;
-
-        batch.push_back(tel);
     }
 
+    StopWriter();
+
     //
     // Cancel the sysinternalsEBPF polling loop
     //
@@ -564,37 +997,844 @@ void EbpfTracerEngine::Consume()
 
 //--------------------------------------------------------------------
 //
-// GetStackTraceForIPs
+// Decode
 //
-// Gets callstack. Since symbol resolution takes a substantial amount
-// of time we only store the IPs during event processing, otherwise we
-// end up saturating the perf buffer. When a user clicks into an event
-// we resolve the symbols at that time.
+// Decodes the events from the event queue of one decoder, when there
+// is more than one, and hands the batches over to Merge. Along with each
+// batch goes the decoder's watermark. Events carry the time their syscall
+// was entered but arrive once it returned, so the watermark is the last
+// time the decoder emptied its queue less MERGE_REORDER_WINDOW_MS, which
+// leaves room for syscalls that were blocked and for events the poll
+// thread hasn't handed over yet.
 //
 //--------------------------------------------------------------------
-StackTrace EbpfTracerEngine::GetStackTraceForIPs(int pid, uint64_t *userIPs, uint64_t userCount)
+void EbpfTracerEngine::Decode(size_t decoder)
 {
-    StackTrace result;
-    for (int i = 0; i < userCount; i++)
-    {
-        result.userIPs.push_back(userIPs[i]);
-    }
+    WaitForTelemetry();
 
-    return result;
-}
+    SpscRing& queue = *EventQueues[decoder];
+    TelemetryBatch batch;
+    batch.Reserve(DECODE_BATCH_SIZE, DECODE_BATCH_SIZE * 1024);
+    auto decode = [&](const uint8_t* data, uint32_t size) { DecodeEvent(reinterpret_cast<const SyscallEvent*>(data), batch); };
+    uint64_t watermark = 0;
 
-//--------------------------------------------------------------------
-//
-// AddPids
-//
-// Sets the pids to trace
-//
-//--------------------------------------------------------------------
-void EbpfTracerEngine::AddPids(std::vector<int> pidsToTrace)
-{
-    for(int i=0; i<pidsToTrace.size(); i++)
+    while (!IsCancelled())
     {
-        telemetryMapUpdateElem(mapFds[PIDS_INDEX], &i, &pidsToTrace[i], MAP_UPDATE_CREATE_OR_OVERWRITE);
+        if(RunState == TRACER_STOP) break;
+
+        if(RunState == TRACER_SUSPENDED)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+
+        // everything queued before this time is decoded once the pop
+        // doesn't stop short at the batch size
+        uint64_t popStart = MonotonicNs();
+        bool pending = queue.wait(batch.Empty() ? 100 : 10);
+        bool emptied = !pending;
+        if (pending)
+        {
+            auto start = std::chrono::steady_clock::now();
+            size_t room = DECODE_BATCH_SIZE - batch.Size();
+            emptied = queue.popBatch(decode, room) < room;
+            DecodeTime += ElapsedNs(start);
+        }
+
+        uint64_t reorderWindow = MERGE_REORDER_WINDOW_MS * 1000000ULL;
+        if (emptied && popStart > reorderWindow)
+        {
+            watermark = popStart - reorderWindow;
+        }
+
+        if (batch.Size() >= DECODE_BATCH_SIZE || !pending)
+        {
+            std::lock_guard<std::mutex> lock(DecodedLock);
+            DecodedWatermarks[decoder] = std::max(DecodedWatermarks[decoder], watermark);
+            DecodedUpdated = true;
+            if (!batch.Empty())
+            {
+                DecodedBatches[decoder].push_back(std::move(batch));
+                if (!FreeBatches.empty())
+                {
+                    batch = std::move(FreeBatches.back());
+                    FreeBatches.pop_back();
+                }
+                else
+                {
+                    batch = TelemetryBatch();
+                }
+            }
+            DecodedCondition.notify_one();
+        }
+    }
+}
+
+//--------------------------------------------------------------------
+//
+// Merge
+//
+// Merges the batches of all decoders in timestamp order and stores
+// them. Events are only merged once every decoder's watermark is past
+// them, so a decoder that fell behind holds back the newer events of
+// the others instead of having its own stored out of order.
+//
+//--------------------------------------------------------------------
+void EbpfTracerEngine::Merge()
+{
+    WaitForTelemetry();
+
+    BatchMerge merge(DecodedBatches.size());
+    TelemetryBatch merged;
+    merged.Reserve(DECODE_BATCH_SIZE, DECODE_BATCH_SIZE * 1024);
+
+    // waiting for the writer isn't merging, leave it out of the merge time
+    uint64_t waited = 0;
+    auto store = [&](const TelemetryBatch& batch, size_t record)
+    {
+        merged.AddFrom(batch, record);
+        if (merged.Size() >= DECODE_BATCH_SIZE)
+        {
+            waited += HandToWriter(merged);
+        }
+    };
+
+    while (!IsCancelled())
+    {
+        if(RunState == TRACER_STOP) break;
+
+        EvictExitedProcesses();
+
+        {
+            std::unique_lock<std::mutex> lock(DecodedLock);
+            DecodedCondition.wait_for(lock, std::chrono::milliseconds(100), [&] { return IsCancelled() || DecodedUpdated; });
+            DecodedUpdated = false;
+
+            for (size_t decoder = 0; decoder < DecodedBatches.size(); decoder++)
+            {
+                for (auto& batch : DecodedBatches[decoder])
+                {
+                    merge.Add(std::move(batch));
+                }
+                DecodedBatches[decoder].clear();
+                merge.Advance(decoder, DecodedWatermarks[decoder]);
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        waited = 0;
+        if (merge.MergeReady(store) == 0)
+        {
+            continue;
+        }
+
+        if (!merged.Empty())
+        {
+            waited += HandToWriter(merged);
+        }
+        MergeTime += ElapsedNs(start) - waited;
+
+        // hand the merged batches back to the decoders to fill again
+        std::lock_guard<std::mutex> lock(DecodedLock);
+        merge.TakeMerged(FreeBatches);
+    }
+
+    //
+    // Store everything handed over so far, whatever the watermarks
+    //
+    {
+        std::lock_guard<std::mutex> lock(DecodedLock);
+        for (size_t decoder = 0; decoder < DecodedBatches.size(); decoder++)
+        {
+            for (auto& batch : DecodedBatches[decoder])
+            {
+                merge.Add(std::move(batch));
+            }
+            DecodedBatches[decoder].clear();
+        }
+    }
+    merge.Merge(UINT64_MAX, store);
+    if (!merged.Empty())
+    {
+        HandToWriter(merged);
+    }
+
+    StopWriter();
+
+    //
+    // Cancel the sysinternalsEBPF polling loop
+    //
+    telemetryCancel();
+}
+
+//--------------------------------------------------------------------
+//
+// HandToWriter
+//
+// Queues a filled batch for the writer thread and replaces it with an
+// empty one, waiting for the writer to free one up if it is behind.
+// Returns the nanoseconds spent waiting.
+//
+//--------------------------------------------------------------------
+uint64_t EbpfTracerEngine::HandToWriter(TelemetryBatch& batch)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(WriteLock);
+    WriteBatches.push_back(std::move(batch));
+    WriteCondition.notify_all();
+
+    WriteCondition.wait(lock, [&] { return !FreeWriteBatches.empty() || IsCancelled(); });
+    if (!FreeWriteBatches.empty())
+    {
+        batch = std::move(FreeWriteBatches.back());
+        FreeWriteBatches.pop_back();
+    }
+    else
+    {
+        batch = TelemetryBatch();
+    }
+
+    uint64_t waited = ElapsedNs(start);
+    WriteWaitTime += waited;
+    return waited;
+}
+
+//--------------------------------------------------------------------
+//
+// StopWriter
+//
+// Lets the writer thread exit once it stored the batches queued so far.
+//
+//--------------------------------------------------------------------
+void EbpfTracerEngine::StopWriter()
+{
+    std::lock_guard<std::mutex> lock(WriteLock);
+    ConsumerDone = true;
+    WriteCondition.notify_all();
+}
+
+//--------------------------------------------------------------------
+//
+// Write
+//
+// Stores the batches the consumer filled, in the order they were
+// handed over, so the consumer isn't held up by the storage engine's
+// transactions and decodes the next batch while one is being stored.
+//
+//--------------------------------------------------------------------
+void EbpfTracerEngine::Write()
+{
+    TelemetryBatch batch;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(WriteLock);
+            WriteCondition.wait(lock, [&] { return !WriteBatches.empty() || ConsumerDone; });
+            if (WriteBatches.empty())
+            {
+                break;
+            }
+
+            batch = std::move(WriteBatches.front());
+            WriteBatches.pop_front();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        _storageEngine->StoreMany(batch);
+        StoreTime += ElapsedNs(start);
+
+        batch.Clear();
+        std::lock_guard<std::mutex> lock(WriteLock);
+        FreeWriteBatches.push_back(std::move(batch));
+        WriteCondition.notify_all();
+    }
+}
+
+//--------------------------------------------------------------------
+//
+// GetProcess
+//
+// Gets the process an event belongs to. Each process, told apart by
+// its pid and start time, is looked up only the first time one of its
+// events is seen. Processes forked or exec'd since tracing started were
+// recorded in the kernel along with what they exec'd, only older ones
+// are read from /proc. The lookup is done without holding CacheLock so
+// the other decoders aren't held up.
+//
+//--------------------------------------------------------------------
+std::shared_ptr<const ProcessInfo> EbpfTracerEngine::GetProcess(const SyscallEvent& event)
+{
+    auto key = std::make_pair(event.pid, event.processStartTime);
+    {
+        std::lock_guard<std::mutex> lock(CacheLock);
+        auto cached = ProcessCache.find(key);
+        if (cached != ProcessCache.end())
+        {
+            return cached->second;
+        }
+    }
+
+    auto process = std::make_shared<ProcessInfo>();
+    process->pid = event.pid;
+    process->startTime = event.processStartTime;
+
+    std::string procPath = "/proc/" + std::to_string(event.pid);
+
+    // the records are only of use if the process hasn't exec'd again since
+    ProcessRecord record;
+    bool recorded = event.processStartTime != 0 &&
+                    telemetryMapLookupElem(mapFds[PROCESSES_INDEX], &event.pid, &record) == 0 &&
+                    record.startTime == event.processStartTime;
+
+    ProcessImage image;
+    bool imaged = recorded &&
+                  telemetryMapLookupElem(mapFds[PROCESS_IMAGES_INDEX], &event.pid, &image) == 0 &&
+                  image.startTime == event.processStartTime;
+
+    if (recorded)
+    {
+        process->ppid = record.ppid;
+        process->uid = record.uid;
+    }
+    else
+    {
+        std::ifstream statusFile(procPath + "/status");
+        std::string line;
+        while (std::getline(statusFile, line))
+        {
+            if (line.compare(0, 5, "PPid:") == 0)
+                process->ppid = std::atoi(line.c_str() + 5);
+            else if (line.compare(0, 4, "Uid:") == 0)
+                process->uid = std::atoi(line.c_str() + 4);
+        }
     }
+
+    if (imaged)
+    {
+        process->name.assign(image.comm, strnlen(image.comm, sizeof(image.comm)));
+        process->exe.assign(image.exe, std::min<size_t>(image.exeLength, sizeof(image.exe)));
+
+        // the last argument may have been cut short before its NUL
+        const char* arg = image.argv;
+        const char* end = image.argv + std::min<size_t>(image.argvLength, sizeof(image.argv));
+        while (arg < end)
+        {
+            const char* argEnd = std::find(arg, end, '\0');
+            process->argv.emplace_back(arg, argEnd);
+            arg = argEnd + 1;
+        }
+    }
+    else
+    {
+        // the rest is only in /proc, which is gone if the process already exited
+        std::ifstream commFile(procPath + "/comm");
+        if (!std::getline(commFile, process->name))
+        {
+            process->name = std::string(event.comm);
+        }
+
+        char exe[PATH_MAX];
+        ssize_t exeLength = readlink((procPath + "/exe").c_str(), exe, sizeof(exe));
+        if (exeLength > 0)
+        {
+            process->exe.assign(exe, exeLength);
+        }
+    }
+
+    // argv is only captured in the kernel by the CO-RE objects
+    if (!imaged || image.argvLength == 0)
+    {
+        std::ifstream cmdlineFile(procPath + "/cmdline");
+        std::string arg;
+        while (std::getline(cmdlineFile, arg, '\0'))
+        {
+            process->argv.push_back(arg);
+        }
+    }
+
+    // the unified hierarchy line is 0::/path
+    std::ifstream cgroupFile(procPath + "/cgroup");
+    std::string line;
+    while (std::getline(cgroupFile, line))
+    {
+        if (line.compare(0, 3, "0::") == 0)
+        {
+            process->cgroup = line.substr(3);
+            break;
+        }
+    }
+
+    // another decoder may have looked the process up meanwhile
+    std::lock_guard<std::mutex> lock(CacheLock);
+    return ProcessCache.emplace(key, process).first->second;
+}
+
+//--------------------------------------------------------------------
+//
+// EvictExitedProcesses
+//
+// Drops the processes that exited from ProcessCache, at most every
+// PROCESS_EVICTION_INTERVAL_MS. Processes are dropped an interval
+// after the kernel reported them, once their last events were decoded.
+// Events that still turn up just look the process up again.
+//
+//--------------------------------------------------------------------
+void EbpfTracerEngine::EvictExitedProcesses()
+{
+    auto now = std::chrono::steady_clock::now();
+    if (now - LastEviction < std::chrono::milliseconds(PROCESS_EVICTION_INTERVAL_MS))
+    {
+        return;
+    }
+    LastEviction = now;
+
+    {
+        std::lock_guard<std::mutex> lock(CacheLock);
+        for (auto& key : ExitedProcesses)
+        {
+            ProcessCache.erase(key);
+        }
+    }
+    ExitedProcesses.clear();
+
+    std::vector<uint8_t> keys;
+    std::vector<uint8_t> values;
+    int count = BpfMapReader::ReadAll(mapFds[EXITED_PROCESSES_INDEX], sizeof(int), sizeof(uint64_t), keys, values);
+    for (int i = 0; i < count; i++)
+    {
+        int tgid;
+        uint64_t startTime;
+        memcpy(&tgid, keys.data() + i * sizeof(tgid), sizeof(tgid));
+        memcpy(&startTime, values.data() + i * sizeof(startTime), sizeof(startTime));
+
+        telemetryMapDeleteElem(mapFds[EXITED_PROCESSES_INDEX], &tgid);
+        ExitedProcesses.emplace_back(tgid, startTime);
+    }
+}
+
+//--------------------------------------------------------------------
+//
+// FormatSocketAddress
+//
+// Formats an address decoded in the kernel as ip:port, [ipv6]:port or
+// the path of a unix socket.
+//
+//--------------------------------------------------------------------
+std::string EbpfTracerEngine::FormatSocketAddress(const SocketAddress& address)
+{
+    char ip[INET6_ADDRSTRLEN] = {};
+    switch (address.family)
+    {
+        case SOCKADDR_FAMILY_INET:
+            inet_ntop(AF_INET, address.addr, ip, sizeof(ip));
+            return std::string(ip) + ":" + std::to_string(ntohs(address.port));
+
+        case SOCKADDR_FAMILY_INET6:
+            inet_ntop(AF_INET6, address.addr, ip, sizeof(ip));
+            return "[" + std::string(ip) + "]:" + std::to_string(ntohs(address.port));
+
+        case SOCKADDR_FAMILY_UNIX:
+            return std::string(address.path, strnlen(address.path, sizeof(address.path)));
+    }
+
+    return "";
+}
+
+//--------------------------------------------------------------------
+//
+// GetSummary
+//
+// Reads the per CPU aggregates built in summary mode and sums them
+// up per (pid, syscall).
+//
+//--------------------------------------------------------------------
+std::vector<SyscallSummary> EbpfTracerEngine::GetSummary()
+{
+    std::vector<SyscallSummary> summaries;
+    if (!tracerOptions.summary || !telemetryIsReady)
+    {
+        return summaries;
+    }
+
+    std::vector<uint8_t> keys;
+    std::vector<uint8_t> values;
+    int cpus = BpfMapReader::NumPossibleCpus();
+    size_t valueSize = BpfMapReader::PerCpuValueSize(sizeof(SyscallSummaryStats));
+    size_t cpuStride = valueSize / cpus;
+    int count = BpfMapReader::ReadAll(mapFds[SUMMARY_INDEX], sizeof(SyscallSummaryKey), valueSize, keys, values);
+
+    for (int i = 0; i < count; i++)
+    {
+        SyscallSummaryKey* key = reinterpret_cast<SyscallSummaryKey*>(keys.data() + i * sizeof(SyscallSummaryKey));
+
+        SyscallSummary summary;
+        summary.pid = key->pid;
+        summary.histogram.resize(SUMMARY_HISTOGRAM_SLOTS, 0);
+        const char* name = SyscallNameForNumber(key->sysnum);
+        if (name != nullptr)
+        {
+            summary.syscall = name;
+        }
+
+        for (int cpu = 0; cpu < cpus; cpu++)
+        {
+            SyscallSummaryStats* stats = reinterpret_cast<SyscallSummaryStats*>(values.data() + i * valueSize + cpu * cpuStride);
+            summary.count += stats->count;
+            summary.errors += stats->errors;
+            summary.totalDuration += stats->totalDuration;
+            for (int slot = 0; slot < SUMMARY_HISTOGRAM_SLOTS; slot++)
+            {
+                summary.histogram[slot] += stats->histogram[slot];
+            }
+        }
+
+        summaries.push_back(summary);
+    }
+
+    std::sort(summaries.begin(), summaries.end(), [](const SyscallSummary& a, const SyscallSummary& b) { return a.count > b.count; });
+
+    return summaries;
+}
+
+//--------------------------------------------------------------------
+//
+// GetStats
+//
+// Sums up the per CPU counters of events dropped in the kernel and
+// adds the events the perf buffers reported as lost and the ones
+// dropped because the event queue was full, along with the time spent
+// in each stage of the pipeline.
+//
+//--------------------------------------------------------------------
+TracerStats EbpfTracerEngine::GetStats()
+{
+    TracerStats stats;
+    {
+        std::lock_guard<std::mutex> lock(LostEventsLock);
+        stats.lostPerCpu = LostEvents;
+    }
+
+    if (telemetryIsReady)
+    {
+        int cpus = BpfMapReader::NumPossibleCpus();
+        std::vector<uint64_t> values(BpfMapReader::PerCpuValueSize(sizeof(uint64_t)) / sizeof(uint64_t));
+        stats.lostPerCpu.resize(cpus, 0);
+
+        for (uint32_t stat = STAT_SAMPLED_OUT; stat <= STAT_PAYLOAD_DROPPED; stat++)
+        {
+            if (telemetryMapLookupElem(mapFds[STATS_INDEX], &stat, values.data()) != 0)
+            {
+                continue;
+            }
+
+            for (int cpu = 0; cpu < cpus; cpu++)
+            {
+                switch (stat)
+                {
+                    case STAT_SAMPLED_OUT:
+                        stats.sampledOut += values[cpu];
+                        break;
+                    case STAT_THROTTLED:
+                        stats.throttled += values[cpu];
+                        break;
+                    case STAT_LOST:
+                        // ring buffer drops, counted in the kernel
+                        stats.lostPerCpu[cpu] += values[cpu];
+                        break;
+                    case STAT_IN_FLIGHT_FAILED:
+                        stats.inFlightFailed += values[cpu];
+                        break;
+                    case STAT_PAYLOAD_DROPPED:
+                        stats.payloadDropped += values[cpu];
+                        break;
+                }
+            }
+        }
+    }
+
+    for (uint64_t lost : stats.lostPerCpu)
+    {
+        stats.lost += lost;
+    }
+
+    // dropped in userland, so not tied to a CPU
+    stats.lost += QueueDropped;
+
+    stats.decodeNs = DecodeTime;
+    stats.mergeNs = MergeTime;
+    stats.storeNs = StoreTime;
+    stats.writeWaitNs = WriteWaitTime;
+
+    return stats;
+}
+
+//--------------------------------------------------------------------
+//
+// GetBlockedSyscalls
+//
+// Walks the in flight table and reports every syscall a thread has
+// entered but not yet returned from, along with how long it has been
+// blocked. Only the raw register values are known at this point so
+// pointers are shown as addresses.
+//
+//--------------------------------------------------------------------
+std::vector<BlockedSyscall> EbpfTracerEngine::GetBlockedSyscalls()
+{
+    std::vector<BlockedSyscall> blocked;
+    if (!telemetryIsReady)
+    {
+        return blocked;
+    }
+
+    std::vector<uint8_t> keys;
+    std::vector<uint8_t> values;
+    int count = BpfMapReader::ReadAll(mapFds[IN_FLIGHT_INDEX], sizeof(uint64_t), sizeof(InFlightSyscall), keys, values);
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t nowNs = now.tv_sec * 1000000000ULL + now.tv_nsec;
+
+    for (int i = 0; i < count; i++)
+    {
+        uint64_t pidTid = *reinterpret_cast<uint64_t*>(keys.data() + i * sizeof(uint64_t));
+        InFlightSyscall* inFlight = reinterpret_cast<InFlightSyscall*>(values.data() + i * sizeof(InFlightSyscall));
+
+        BlockedSyscall syscall;
+        syscall.pid = pidTid >> 32;
+        syscall.tid = pidTid & 0xFFFFFFFF;
+        syscall.blockedNs = nowNs > inFlight->timestamp ? nowNs - inFlight->timestamp : 0;
+
+        const char* name = SyscallNameForNumber(inFlight->sysnum);
+        if (name != nullptr)
+        {
+            syscall.syscall = name;
+        }
+
+        if (name != nullptr && schemaIndexes[inFlight->sysnum] >= 0)
+        {
+            auto schema = schemas.begin() + schemaIndexes[inFlight->sysnum];
+            std::stringstream args;
+            for (int arg = 0; arg < schema->usedArgCount && arg < 6; arg++)
+            {
+                if (arg > 0) args << ", ";
+                args << schema->argNames[arg] << "=";
+                switch (schema->types[arg])
+                {
+                    case ProcmonArgTag::INT:
+                    case ProcmonArgTag::PID_T:
+                    case ProcmonArgTag::LONG:
+                    case ProcmonArgTag::FD:
+                        args << (int64_t)inFlight->args[arg];
+                        break;
+                    case ProcmonArgTag::UNSIGNED_INT:
+                    case ProcmonArgTag::UINT32:
+                    case ProcmonArgTag::SIZE_T:
+                    case ProcmonArgTag::UNSIGNED_LONG:
+                        args << inFlight->args[arg];
+                        break;
+                    default:
+                        args << "0x" << std::hex << inFlight->args[arg] << std::dec;
+                        break;
+                }
+            }
+            syscall.arguments = args.str();
+        }
+
+        std::ifstream commFile("/proc/" + std::to_string(syscall.pid) + "/task/" + std::to_string(syscall.tid) + "/comm");
+        std::getline(commFile, syscall.comm);
+
+        blocked.push_back(syscall);
+    }
+
+    std::sort(blocked.begin(), blocked.end(), [](const BlockedSyscall& a, const BlockedSyscall& b) { return a.blockedNs > b.blockedNs; });
+
+    return blocked;
+}
+
+//--------------------------------------------------------------------
+//
+// GetStackFramesForId
+//
+// Gets the frames of a user or kernel stack deduplicated in the
+// stackTraces map, looking each stack up only once while it stays
+// among the STACK_CACHE_SIZE most recently used ones.
+//
+//--------------------------------------------------------------------
+std::shared_ptr<const std::vector<uint64_t>> EbpfTracerEngine::GetStackFramesForId(int32_t stackId)
+{
+    static const auto noFrames = std::make_shared<const std::vector<uint64_t>>();
+
+    std::lock_guard<std::mutex> lock(CacheLock);
+
+    auto cached = StackCache.find(stackId);
+    if (cached != StackCache.end())
+    {
+        StackUses.splice(StackUses.begin(), StackUses, cached->second.use);
+        return cached->second.frames;
+    }
+
+    uint64_t frames[MAX_STACK_FRAMES] = {0};
+    if (telemetryMapLookupElem(mapFds[STACK_TRACES_INDEX], &stackId, frames) != 0)
+    {
+        return noFrames;
+    }
+
+    auto ips = std::make_shared<std::vector<uint64_t>>();
+    for (int i = 0; i < MAX_STACK_FRAMES && frames[i] != 0; i++)
+    {
+        ips->push_back(frames[i]);
+    }
+
+    // frames handed out before stay valid as the events hold on to them
+    if (StackCache.size() >= STACK_CACHE_SIZE)
+    {
+        StackCache.erase(StackUses.back());
+        StackUses.pop_back();
+    }
+
+    StackUses.push_front(stackId);
+    StackCache.emplace(stackId, CachedStack{ips, StackUses.begin()});
+
+    return ips;
+}
+
+//--------------------------------------------------------------------
+//
+// AddPids
+//
+// Sets the pids to trace
+//
+//--------------------------------------------------------------------
+void EbpfTracerEngine::AddPids(std::vector<int> pidsToTrace)
+{
+    pthread_mutex_lock(&mutex);
+    for(int i=0; i<pidsToTrace.size(); i++)
+    {
+        if(std::find(pids.begin(), pids.end(), pidsToTrace[i]) == pids.end())
+        {
+            pids.push_back(pidsToTrace[i]);
+        }
+    }
+
+    // before the maps exist telemetryReady writes the pids
+    if (telemetryIsReady)
+    {
+        uint32_t pidValue = PID_FILTER_USER;
+        for(int i=0; i<pidsToTrace.size(); i++)
+        {
+            telemetryMapUpdateElem(mapFds[PIDS_INDEX], &pidsToTrace[i], &pidValue, MAP_UPDATE_CREATE_OR_OVERWRITE);
+        }
+
+        if (pidsToTrace.size() > 0)
+        {
+            int key = CONFIG_PID_FILTER_KEY;
+            uint64_t enabled = 1;
+            telemetryMapUpdateElem(mapFds[CONFIG_INDEX], &key, &enabled, MAP_UPDATE_CREATE_OR_OVERWRITE);
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+//--------------------------------------------------------------------
+//
+// RemovePids
+//
+// Stops tracing the given pids. Children already followed from them
+// stay traced until they exit. Removing the last pid turns the pid
+// filter off, so all processes are traced as when no pids were given.
+//
+//--------------------------------------------------------------------
+void EbpfTracerEngine::RemovePids(std::vector<int> pidsToRemove)
+{
+    pthread_mutex_lock(&mutex);
+    for(int i=0; i<pidsToRemove.size(); i++)
+    {
+        pids.erase(std::remove(pids.begin(), pids.end(), pidsToRemove[i]), pids.end());
+
+        if (telemetryIsReady)
+        {
+            telemetryMapDeleteElem(mapFds[PIDS_INDEX], &pidsToRemove[i]);
+        }
+    }
+
+    if (telemetryIsReady && pids.empty())
+    {
+        int key = CONFIG_PID_FILTER_KEY;
+        uint64_t enabled = 0;
+        telemetryMapUpdateElem(mapFds[CONFIG_INDEX], &key, &enabled, MAP_UPDATE_CREATE_OR_OVERWRITE);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+//--------------------------------------------------------------------
+//
+// AddEvent
+//
+// Starts tracing the given syscalls
+//
+//--------------------------------------------------------------------
+void EbpfTracerEngine::AddEvent(Event eventToTrace)
+{
+    AddEvent(std::vector<Event>{eventToTrace});
+}
+
+void EbpfTracerEngine::AddEvent(std::vector<Event> eventsToTrace)
+{
+    pthread_mutex_lock(&mutex);
+    for (auto& event : eventsToTrace)
+    {
+        auto sameName = [&event](const Event& e) -> bool { return e.Name() == event.Name(); };
+        if (std::find_if(events.begin(), events.end(), sameName) != events.end())
+        {
+            continue;
+        }
+
+        events.push_back(event);
+
+        // before the maps exist telemetryReady writes the syscalls
+        if (telemetryIsReady)
+        {
+            TraceSyscall(event);
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+//--------------------------------------------------------------------
+//
+// RemoveEvent
+//
+// Stops tracing the given syscalls. Their flags are cleared rather
+// than deleted so that calls already in flight still find a schema
+// when they return.
+//
+//--------------------------------------------------------------------
+void EbpfTracerEngine::RemoveEvent(Event eventToRemove)
+{
+    RemoveEvent(std::vector<Event>{eventToRemove});
+}
+
+void EbpfTracerEngine::RemoveEvent(std::vector<Event> eventsToRemove)
+{
+    pthread_mutex_lock(&mutex);
+    for (auto& event : eventsToRemove)
+    {
+        auto found = std::find_if(events.begin(), events.end(), [&event](const Event& e) -> bool { return e.Name() == event.Name(); });
+        if (found == events.end())
+        {
+            continue;
+        }
+
+        events.erase(found);
+
+        int num = ::Utils::GetSyscallNumberForName(event.Name());
+        if (telemetryIsReady && num >= 0)
+        {
+            uint32_t flags = 0;
+            telemetryMapUpdateElem(mapFds[SYSCALL_FLAGS_INDEX], &num, &flags, MAP_UPDATE_CREATE_OR_OVERWRITE);
+        }
+    }
+    pthread_mutex_unlock(&mutex);
 }
 
@@ -16,15 +16,24 @@
 
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 #include <thread>
 #include <elf.h>
 
 #include "syscall_schema.h"
+#include "ring_buffer_reader.h"
 #include "kern/procmonEBPF_common.h"
-#include "../../common/cancellable_message_queue.h"
+#include "../../common/batch_merge.h"
+#include "../../common/spsc_ring.h"
+#include "../../common/telemetry_record.h"
 #include "../tracer_engine.h"
 #include "../../common/event.h"
 #include "../../storage/storage_engine.h"
@@ -40,11 +49,37 @@ extern "C"
 #define KERN_4_17_5_1_OBJ       "procmonEBPFkern4.17-5.1.o"
 #define KERN_5_2_OBJ            "procmonEBPFkern5.2.o"
 #define KERN_5_3_5_5_OBJ        "procmonEBPFkern5.3-5.5.o"
-#define KERN_5_6__OBJ           "procmonEBPFkern5.6-.o"
+#define KERN_5_6_5_7_OBJ        "procmonEBPFkern5.6-5.7.o"
+#define KERN_5_8__OBJ           "procmonEBPFkern5.8-.o"
 #define KERN_4_17_5_1_CORE_OBJ  "procmonEBPFkern4.17-5.1_core.o"
 #define KERN_5_2_CORE_OBJ       "procmonEBPFkern5.2_core.o"
 #define KERN_5_3_5_5_CORE_OBJ   "procmonEBPFkern5.3-5.5_core.o"
-#define KERN_5_6__CORE_OBJ      "procmonEBPFkern5.6-_core.o"
+#define KERN_5_6_5_7_CORE_OBJ   "procmonEBPFkern5.6-5.7_core.o"
+#define KERN_5_8__CORE_OBJ      "procmonEBPFkern5.8-_core.o"
+
+// Bytes of raw events handed from the poll thread to the consumer,
+// split between the decoders but at least EVENT_QUEUE_MIN_SIZE each
+#define EVENT_QUEUE_SIZE        (32 * 1024 * 1024)
+#define EVENT_QUEUE_MIN_SIZE    (4 * 1024 * 1024)
+
+// Events decoded before they are stored or handed to the merge
+#define DECODE_BATCH_SIZE       50
+
+// How far a decoder's watermark stays behind the last time it emptied its
+// queue. Events are stamped when their syscall is entered, so a syscall
+// that was blocked for longer than this is stored once it returns, after
+// events that happened while it was blocked.
+#define MERGE_REORDER_WINDOW_MS 500
+
+// Batches shared between the consumer and the writer thread, so the
+// consumer can fill the next ones while one is being stored
+#define WRITE_BATCH_COUNT       3
+
+// Stacks kept in the stack cache, the least recently used go past this
+#define STACK_CACHE_SIZE        4096
+
+// How often processes that exited are dropped from the process cache
+#define PROCESS_EVICTION_INTERVAL_MS 1000
 
 class EbpfTracerEngine : public ITracerEngine
 {
@@ -56,37 +91,145 @@ private:
     // callback for every event
     std::thread PollingThread;
 
-    // The thread for consuming the raw events
+    // The thread for consuming the raw events, or with more than one
+    // decoder for merging and storing what the decoders decoded
     std::thread ConsumerThread;
 
-    // The queue for containing raw events
-    // from eBPF to be processed into telemetry
-    CancellableMessageQueue<SyscallEvent> EventQueue;
+    // The threads decoding the raw events when there is more than one decoder
+    std::vector<std::thread> DecoderThreads;
+
+    // The thread storing the batches the consumer filled
+    std::thread WriterThread;
+
+    // The thread for polling the shared ring buffer
+    // on kernels that support it (5.8+)
+    std::thread RingBufferThread;
+    RingBufferReader RingBuffer;
+    bool UseRingBuffer;
+
+    // The rings for containing raw events from eBPF to be processed
+    // into telemetry, one per decoder. Perf buffer events go to the
+    // ring of their CPU's decoder, shared ring buffer events, which
+    // don't carry a CPU, go round robin. Neither the shared ring nor the
+    // perf buffers are in timestamp order, events are written as their
+    // syscall returns, so Merge sorts them whichever decoder they go to.
+    std::vector<std::unique_ptr<SpscRing>> EventQueues;
+    uint32_t NextEventQueue = 0;
+
+    // Batches each decoder decoded, waiting to be merged, the watermark
+    // of each decoder, and the merged batches the decoders can reuse.
+    // DecodedUpdated tells Merge a decoder handed over something new.
+    std::mutex DecodedLock;
+    std::condition_variable DecodedCondition;
+    std::vector<std::deque<TelemetryBatch>> DecodedBatches;
+    std::vector<uint64_t> DecodedWatermarks;
+    std::vector<TelemetryBatch> FreeBatches;
+    bool DecodedUpdated = false;
+
+    // Batches waiting for the writer thread, in order, and the empty
+    // ones the consumer fills next. The consumer waits for an empty one
+    // when the writer is WRITE_BATCH_COUNT batches behind.
+    std::mutex WriteLock;
+    std::condition_variable WriteCondition;
+    std::deque<TelemetryBatch> WriteBatches;
+    std::vector<TelemetryBatch> FreeWriteBatches;
+    bool ConsumerDone = false;
+
+    // Events dropped because the consumer didn't keep up with the ring
+    std::atomic<uint64_t> QueueDropped = 0;
+
+    // Nanoseconds spent in each stage of the pipeline
+    std::atomic<uint64_t> DecodeTime = 0;
+    std::atomic<uint64_t> MergeTime = 0;
+    std::atomic<uint64_t> StoreTime = 0;
+    std::atomic<uint64_t> WriteWaitTime = 0;
 
     std::map<int, void*> SymbolCacheMap;
 
     void Poll();
+    void PollRingBuffer();
     void Consume();
-
-    StackTrace GetStackTraceForIPs(int pid, uint64_t *userIPs, uint64_t userCount);
+    void Decode(size_t decoder);
+    void Merge();
+    void Write();
+    uint64_t HandToWriter(TelemetryBatch& batch);
+    void StopWriter();
+    void DecodeEvent(const SyscallEvent* event, TelemetryBatch& batch);
+    bool WaitForTelemetry();
+    bool IsCancelled() { return EventQueues.front()->isCancelled(); }
+
+    // Guards the caches below, which all decoders share
+    std::mutex CacheLock;
+
+    // Frames of the most recently used stacks in stack id mode or of kernel stacks, keyed by
+    // stack id. StackUses holds the ids from the most to the least recently used.
+    struct CachedStack
+    {
+        std::shared_ptr<const std::vector<uint64_t>> frames;
+        std::list<int32_t>::iterator use;
+    };
+    std::unordered_map<int32_t, CachedStack> StackCache;
+    std::list<int32_t> StackUses;
+
+    // Processes seen so far, keyed by pid and start time
+    std::map<std::pair<pid_t, uint64_t>, std::shared_ptr<const ProcessInfo>> ProcessCache;
+
+    // Processes the kernel reported as exited at the last eviction. They are only
+    // dropped at the next one, so the events they sent before exiting find them.
+    std::vector<std::pair<pid_t, uint64_t>> ExitedProcesses;
+    std::chrono::steady_clock::time_point LastEviction;
+
+    std::shared_ptr<const ProcessInfo> GetProcess(const SyscallEvent& event);
+    void EvictExitedProcesses();
+
+    static std::string FormatSocketAddress(const SocketAddress& address);
+
+    std::shared_ptr<const std::vector<uint64_t>> GetStackFramesForId(int32_t stackId);
 
     // Instance level callback
-    void PerfCallback(void *rawMessage, int rawMessageSize);
+    void PerfCallback(int cpu, void *rawMessage, int rawMessageSize);
     // static callback that passes the instance pointer in cbCookie
     static void PerfCallbackWrapper(void *cbCookie, int cpu, void *rawMessage, uint32_t rawMessageSize);
+    // static ring buffer callback that passes the instance pointer in cbCookie
+    static void RingBufferCallbackWrapper(void *cbCookie, void *rawMessage, uint32_t rawMessageSize);
+
+    // Events the perf buffers reported as lost, per CPU
+    std::mutex LostEventsLock;
+    std::vector<uint64_t> LostEvents;
 
     // Instance level callback
-    void PerfLostCallback(uint64_t lost);
+    void PerfLostCallback(int cpu, uint64_t lost);
     // static callback that passes the instance pointer in cbCookie
     static void PerfLostCallbackWrapper(void *cbCookie, int cpu, uint64_t lost);
 public:
     std::vector<struct SyscallSchema> Schemas;
 
-    EbpfTracerEngine(std::shared_ptr<IStorageEngine> storageEngine, std::vector<Event> targetEvents, std::vector<int> pids);
+    EbpfTracerEngine(std::shared_ptr<IStorageEngine> storageEngine, std::vector<Event> targetEvents, std::vector<int> pids, TracerOptions options);
     void Initialize() override;
 
+    void AddEvent(Event eventToTrace) override;
+    void AddEvent(std::vector<Event> eventsToTrace) override;
+
     void AddPids(std::vector<int> pidsToTrace) override;
+    void RemovePids(std::vector<int> pidsToRemove) override;
+
+    void RemoveEvent(Event eventToRemove) override;
+    void RemoveEvent(std::vector<Event> eventsToRemove) override;
+
+    std::vector<SyscallSummary> GetSummary() override;
+
+    TracerStats GetStats() override;
+
+    std::vector<BlockedSyscall> GetBlockedSyscalls() override;
 
     void SetRunState(int runState) override;
-    void Cancel() { EventQueue.cancel(); }
+    void Cancel()
+    {
+        for (auto& queue : EventQueues)
+        {
+            queue->cancel();
+        }
+        DecodedCondition.notify_all();
+        WriteCondition.notify_all();
+    }
 };
\ No newline at end of file
@@ -32,11 +32,45 @@
 #define LINUX_MAX_EVENT_SIZE (65536 - 24)
 
 #define MAX_BUFFER 128
+
+// file type bits of i_mode used to name fds that aren't backed by a path
+#define FD_MODE_MASK        0170000
+#define FD_MODE_SOCKET      0140000
+#define FD_MODE_PIPE        0010000
+
+// string arguments such as paths are copied in full up to this many bytes
+// each, on top of the short preview in the arguments
+#define MAX_STRING_BYTES    4096
+#define MAX_STRINGS_BYTES   (MAX_STRING_BYTES * 2)
+
+// most bytes of a read or written data buffer that are captured
+#define MAX_PAYLOAD_BYTES   4096
+
+// clone flag of new threads, which share the tgid of their parent
+#define CLONE_THREAD_FLAG   0x00010000
+
+// address families decoded from the sockaddr of network syscalls
+#define SOCKADDR_FAMILY_UNIX    1
+#define SOCKADDR_FAMILY_INET    2
+#define SOCKADDR_FAMILY_INET6   10
+#define SOCKADDR_PATH_BYTES     108
+
 #define MAX_STACK_FRAMES 32
-#define MAX_PROC 512
 
-#define CONFIG_ITEMS        1
-#define MAX_PIDS           10
+#define CONFIG_ITEMS        14
+#define MAX_PIDS            65536
+#define MAX_IN_FLIGHT       65536
+#define MAX_IN_FLIGHT_DATA  1024
+#define MAX_PROCESSES       16384
+#define MAX_PROCESS_IMAGES  4096
+#define MAX_EXITED_PROCESSES 4096
+
+// bytes of the path and arguments of an exec that are kept
+#define PROCESS_EXE_BYTES   256
+#define PROCESS_ARGV_BYTES  1024
+
+// must be a power of 2 and a multiple of the page size
+#define RINGBUF_SIZE        (16 * 1024 * 1024)
 
 #define TRACER_RUNNING      0
 #define TRACER_SUSPENDED    1
@@ -44,25 +78,238 @@
 
 #define RUNSTATE_KEY        0
 #define CONFIG_PID_KEY      0
+#define CONFIG_PID_FILTER_KEY       1
+#define CONFIG_FOLLOW_CHILDREN_KEY  2
+#define CONFIG_PROCMON_CHILDREN_KEY 3
+#define CONFIG_STACK_MODE_KEY       4
+#define CONFIG_SUMMARY_MODE_KEY     5
+#define CONFIG_MIN_DURATION_KEY     6
+#define CONFIG_ERRORS_ONLY_KEY      7
+#define CONFIG_ERRNO_FILTER_KEY     8
+#define CONFIG_RATE_LIMIT_KEY       9
+#define CONFIG_MAX_STRING_KEY       10
+#define CONFIG_SNAPLEN_READ_KEY     11
+#define CONFIG_SNAPLEN_WRITE_KEY    12
+#define CONFIG_PAYLOAD_BUDGET_KEY   13
+
+// size of the errnoFilter map, errno values are below this
+#define ERRNO_MAX           4096
+
+// how user stacks are captured
+#define STACK_MODE_FRAMES   0
+#define STACK_MODE_ID       1
+
+#define MAX_STACK_IDS       16384
+
+// values held in the pids map
+#define PID_FILTER_USER     1
+#define PID_FILTER_FOLLOWED 2
 
 #define CONFIG_INDEX        0
 #define PIDS_INDEX          1
 #define RUNSTATE_INDEX      2
 #define SYSCALL_INDEX       3
+#define SYSCALL_FLAGS_INDEX 4
+#define STACK_TRACES_INDEX  5
+#define SUMMARY_INDEX       6
+#define ERRNO_FILTER_INDEX  7
+#define STATS_INDEX         8
+#define IN_FLIGHT_INDEX     9
+#define PROCESSES_INDEX     10
+#define PROCESS_IMAGES_INDEX 11
+#define EXITED_PROCESSES_INDEX 12
+#define RINGBUF_INDEX       13
+
+#define SYSCALL_MAX         512
+
+// per syscall flags held in the syscallFlags map, the upper 16 bits
+// hold the 1 in N sample rate of the syscall (0 or 1 keeps every call)
+// and bits 8 to 13 which arguments are strings to copy in full. Bits 1
+// to 3 hold the index + 1 of the data buffer argument of read and write
+// like syscalls, bit 4 is set for the write ones. Bits 5 to 7 hold the
+// index + 1 of the sockaddr argument of network syscalls, bit 14 is set
+// when the kernel fills that sockaddr in
+#define SYSCALL_FLAG_TRACED (1 << 0)
+#define SYSCALL_PAYLOAD_ARG_SHIFT 1
+#define SYSCALL_PAYLOAD_ARG_MASK  0x7
+#define SYSCALL_FLAG_PAYLOAD_WRITE (1 << 4)
+#define SYSCALL_SOCKADDR_ARG_SHIFT 5
+#define SYSCALL_SOCKADDR_ARG_MASK  0x7
+#define SYSCALL_FLAG_SOCKADDR_OUT  (1 << 14)
+#define SYSCALL_STRING_ARGS_SHIFT 8
+#define SYSCALL_STRING_ARGS_MASK  0x3f
+#define SYSCALL_SAMPLE_SHIFT 16
+
+// counters held in the per CPU procmonStats map
+#define STAT_SAMPLED_OUT    0
+#define STAT_THROTTLED      1
+#define STAT_LOST           2
+#define STAT_IN_FLIGHT_FAILED 3
+#define STAT_PAYLOAD_DROPPED 4
+#define STATS_MAX           8
+
+// once the rate governor runs out of tokens only 1 in this many events is sent
+#define GOVERNOR_SAMPLE_RATE 16
+#define GOVERNOR_PERIOD_NS   1000000000ULL
+
+// buckets of the per CPU governor map
+#define GOVERNOR_EVENTS_KEY  0
+#define GOVERNOR_PAYLOAD_KEY 1
+#define GOVERNOR_MAX         2
 
 #define EBPF_RET_UNUSED     0
 
+#define MAX_STACK_BYTES     (MAX_STACK_FRAMES * 8)
+
+//
+// Socket address of a network syscall in a fixed layout. The port is in
+// network byte order, addr holds the IPv4 or IPv6 address and path the
+// path of unix sockets, starting with '@' for abstract ones
+//
+struct SocketAddress
+{
+    uint16_t family;
+    uint16_t port;
+    uint8_t addr[16];
+    char path[SOCKADDR_PATH_BYTES];
+};
+
+//
+// Events are sent to userland as a fixed header followed by only the
+// used part of data: userStackCount stack frames, bufferLength bytes of
+// arguments, stringsLength bytes of NUL terminated full length string
+// arguments, in argument order, payloadLength bytes of the data buffer
+// and then addressLength bytes holding a decoded SocketAddress. Use
+// SYSCALL_EVENT_SIZE to get the wire size.
+// In STACK_MODE_ID userStackCount is 0 and the frames are looked up
+// in the stackTraces map using userStackId instead. kernelStackId is the
+// id in the same map of the kernel stack the syscall last blocked or was
+// preempted in, -1 when it never left the CPU. Each sent event
+// stands for sampleRate calls. processStartTime is the startTime of the
+// ProcessRecord of the process, 0 if it was already running when
+// procmon started, so userland can tell recycled pids apart.
+//
 struct SyscallEvent
 {
     pid_t pid;
     uint32_t sysnum;
     uint64_t timestamp;
     uint64_t duration_ns;
-    uint64_t userStack[MAX_STACK_FRAMES];
-    uint64_t userStackCount;
     uint64_t ret;
     char comm[16];
-    unsigned char buffer [MAX_BUFFER];
+    uint32_t userStackCount;
+    uint32_t bufferLength;
+    int32_t userStackId;
+    uint32_t sampleRate;
+    uint32_t stringsLength;
+    uint32_t payloadLength;
+    uint32_t addressLength;
+    int32_t kernelStackId;
+    uint64_t processStartTime;
+    unsigned char data[MAX_STACK_BYTES + MAX_BUFFER + MAX_STRINGS_BYTES + MAX_PAYLOAD_BYTES + sizeof(struct SocketAddress)];
+};
+
+#define SYSCALL_EVENT_HEADER_SIZE   __builtin_offsetof(struct SyscallEvent, data)
+#define SYSCALL_EVENT_SIZE(event)   (SYSCALL_EVENT_HEADER_SIZE + (event)->userStackCount * 8 + (event)->bufferLength + (event)->stringsLength + (event)->payloadLength + (event)->addressLength)
+
+//
+// Summary mode aggregates completed syscalls per (tgid, syscall) in the
+// kernel instead of sending events. Latencies go into log2 buckets of
+// microseconds, the last bucket also holds everything slower.
+//
+#define MAX_SUMMARY_ENTRIES     10240
+#define SUMMARY_HISTOGRAM_SLOTS 24
+
+struct SyscallSummaryKey
+{
+    pid_t pid;
+    uint32_t sysnum;
+};
+
+struct SyscallSummaryStats
+{
+    uint64_t count;
+    uint64_t errors;
+    uint64_t totalDuration;
+    uint64_t histogram[SUMMARY_HISTOGRAM_SLOTS];
+};
+
+//
+// State kept from enter to exit of a traced syscall, keyed by pid_tgid.
+// The event itself is only built on exit, but the arguments are decoded
+// on enter into arguments: by exit a successful execve has replaced the
+// address space the pointers point into, and close or dup2 have released
+// the fd. The raw args are kept for what only exists once the call
+// returned. kernelStackId is updated each time the thread is switched
+// out during the syscall.
+//
+struct InFlightSyscall
+{
+    uint64_t timestamp;
+    uint32_t sysnum;
+    uint32_t sampleRate;
+    uint64_t args[6];
+    int32_t kernelStackId;
+    uint32_t argumentsLength;
+    uint32_t hasData;
+    unsigned char arguments[MAX_BUFFER];
+};
+
+//
+// Variable length parts of a traced syscall captured on enter, kept in a
+// separate table keyed by pid_tgid as they are too big to hold for every
+// syscall in flight. hasData is set in the InFlightSyscall when there is
+// an entry. strings holds the string arguments that are copied in full,
+// each NUL terminated, in argument order. payload holds the data buffer of
+// write like syscalls, copied before the caller can reuse it. address holds
+// the sockaddr passed in to connect, bind and the like, decoded while it is
+// still there; addressLength is 0 when there is none.
+//
+struct InFlightData
+{
+    uint32_t stringsLength;
+    uint32_t payloadLength;
+    uint32_t addressLength;
+    struct SocketAddress address;
+    unsigned char strings[MAX_STRINGS_BYTES];
+    unsigned char payload[MAX_PAYLOAD_BYTES];
+};
+
+//
+// A process forked or exec'd since procmon started, keyed by tgid.
+// startTime is taken at fork and again at each exec, as the process
+// turns into a different program.
+//
+struct ProcessRecord
+{
+    uint64_t startTime;
+    pid_t ppid;
+    uint32_t uid;
+};
+
+//
+// What a process exec'd, keyed by tgid, so it doesn't have to be read
+// from /proc after the fact. exe is the path passed to exec, argv the
+// arguments, each NUL terminated as in /proc/<pid>/cmdline, cut short at
+// PROCESS_ARGV_BYTES. argv is only read in the CO-RE objects, argvLength
+// is 0 in the others. startTime matches the ProcessRecord of the exec.
+// Forked children get a copy of their parent's.
+//
+struct ProcessImage
+{
+    uint64_t startTime;
+    uint32_t exeLength;
+    uint32_t argvLength;
+    char comm[16];
+    char exe[PROCESS_EXE_BYTES];
+    char argv[PROCESS_ARGV_BYTES];
+};
+
+// Token bucket of the rate governor, one per CPU
+struct GovernorState
+{
+    uint64_t tokens;
+    uint64_t lastRefill;
 };
 
 enum ProcmonArgTag
@@ -26,22 +26,83 @@
 #include "procmonEBPF_common.h"
 
 // create a map to hold the event as we build it - too big for stack
-// one entry per cpu
 struct {
-    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
     __type(key, uint32_t);
     __type(value, struct SyscallEvent);
-    __uint(max_entries, MAX_PROC);
+    __uint(max_entries, 1);
 } eventStorageMap SEC(".maps");
 
-// create a map to hold the syscall information
+// create a map to build the in flight entry of a syscall in - too big for stack
 struct {
-    __uint(type, BPF_MAP_TYPE_HASH);
-    __uint(max_entries, 10240);
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __type(key, uint32_t);
+    __type(value, struct InFlightSyscall);
+    __uint(max_entries, 1);
+} inFlightStorage SEC(".maps");
+
+// Syscalls in flight, keyed by pid_tgid. LRU so entries of syscalls that
+// never return can't fill the map up and block new ones
+struct {
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(max_entries, MAX_IN_FLIGHT);
     __type(key, uint64_t);
-    __type(value, struct SyscallEvent);
+    __type(value, struct InFlightSyscall);
 } syscallsMap SEC(".maps");
 
+// create a map to build the data captured on enter in - too big for stack
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __type(key, uint32_t);
+    __type(value, struct InFlightData);
+    __uint(max_entries, 1);
+} inFlightDataStorage SEC(".maps");
+
+// Data captured on enter of syscalls in flight, keyed by pid_tgid. Only
+// syscalls that have any hold an entry, so there are fewer than in
+// syscallsMap. LRU as entries are big and some syscalls never return
+struct {
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(max_entries, MAX_IN_FLIGHT_DATA);
+    __type(key, uint64_t);
+    __type(value, struct InFlightData);
+} inFlightData SEC(".maps");
+
+// Processes forked or exec'd since procmon started, keyed by tgid. LRU
+// so records of exited processes make room for new ones
+struct {
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(max_entries, MAX_PROCESSES);
+    __type(key, int);
+    __type(value, struct ProcessRecord);
+} processes SEC(".maps");
+
+// What the processes above exec'd, keyed by tgid. Fewer of them as they
+// are much bigger, processes missing here are looked up in /proc
+struct {
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(max_entries, MAX_PROCESS_IMAGES);
+    __type(key, int);
+    __type(value, struct ProcessImage);
+} processImages SEC(".maps");
+
+// Processes that exited, keyed by tgid with their start time, for userland
+// to drop them from its caches. It deletes the entries once read
+struct {
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(max_entries, MAX_EXITED_PROCESSES);
+    __type(key, int);
+    __type(value, uint64_t);
+} exitedProcesses SEC(".maps");
+
+// create a map to build the image of a process in - too big for stack
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __type(key, uint32_t);
+    __type(value, struct ProcessImage);
+    __uint(max_entries, 1);
+} processImageStorage SEC(".maps");
+
 // Procmon config
 struct {
     __uint(type, BPF_MAP_TYPE_ARRAY);
@@ -50,14 +111,24 @@ struct {
     __uint(max_entries, CONFIG_ITEMS);
 } configuration SEC(".maps");
 
-// Procmon PIDS
+// Procmon PIDS, keyed by tgid. Only consulted when the pid filter is
+// enabled in the configuration map
 struct {
-    __uint(type, BPF_MAP_TYPE_ARRAY);
-    __type(key, uint32_t);
-    __type(value, int);
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(map_flags, BPF_F_NO_PREALLOC);
+    __type(key, int);
+    __type(value, uint32_t);
     __uint(max_entries, MAX_PIDS);
 } pids SEC(".maps");
 
+// Children spawned by procmon (or by its children), keyed by tgid
+struct {
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __type(key, int);
+    __type(value, uint32_t);
+    __uint(max_entries, 64);
+} procmonChildren SEC(".maps");
+
 // Procmon runstate
 struct {
     __uint(type, BPF_MAP_TYPE_ARRAY);
@@ -74,4 +145,61 @@ struct {
     __uint(max_entries, 1000);
 } syscalls SEC(".maps");
 
+// Procmon per syscall flags, indexed by syscall number. Checked
+// before anything else so untraced syscalls bail out immediately
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __type(key, uint32_t);
+    __type(value, uint32_t);
+    __uint(max_entries, SYSCALL_MAX);
+} syscallFlags SEC(".maps");
+
+// Deduplicated user stacks, used in STACK_MODE_ID
+struct {
+    __uint(type, BPF_MAP_TYPE_STACK_TRACE);
+    __uint(key_size, sizeof(uint32_t));
+    __uint(value_size, MAX_STACK_BYTES);
+    __uint(max_entries, MAX_STACK_IDS);
+} stackTraces SEC(".maps");
+
+// Per CPU aggregates built in summary mode, summed up by userland
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_HASH);
+    __type(key, struct SyscallSummaryKey);
+    __type(value, struct SyscallSummaryStats);
+    __uint(max_entries, MAX_SUMMARY_ENTRIES);
+} syscallSummary SEC(".maps");
+
+// Errno values to keep when the errno filter is enabled, indexed by errno
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __type(key, uint32_t);
+    __type(value, uint32_t);
+    __uint(max_entries, ERRNO_MAX);
+} errnoFilter SEC(".maps");
+
+// Per CPU counters of events procmon chose not to send, see STAT_*
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __type(key, uint32_t);
+    __type(value, uint64_t);
+    __uint(max_entries, STATS_MAX);
+} procmonStats SEC(".maps");
+
+// Per CPU rate governor state, one bucket for events and one for payload bytes
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __type(key, uint32_t);
+    __type(value, struct GovernorState);
+    __uint(max_entries, GOVERNOR_MAX);
+} governor SEC(".maps");
+
+#ifdef PROCMON_RINGBUF
+// Shared event ring (5.8+), replaces the per-CPU perf buffers
+struct {
+    __uint(type, BPF_MAP_TYPE_RINGBUF);
+    __uint(max_entries, RINGBUF_SIZE);
+} eventRingBuffer SEC(".maps");
+#endif
+
 #endif
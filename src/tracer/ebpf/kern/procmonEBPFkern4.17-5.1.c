@@ -27,5 +27,6 @@
 
 #include "procmonGenericEntry_rawtp.c"
 #include "procmonGenericExit_rawtp.c"
+#include "procmonSchedProcess_tp.c"
 
 char _license[] SEC("license") = "GPL";
\ No newline at end of file
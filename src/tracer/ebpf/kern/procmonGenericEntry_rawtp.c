@@ -53,13 +53,61 @@
         bpf_probe_read((void*)dsc, size, src);
 
 
+// ------------------------------------------------------------------------------------------
+// ResolveFd
+//
+// Copies the name of what fd refers to in the current task into name, left empty when it
+// can't be resolved. Called on enter, close and dup2 have released or replaced the fd
+// by exit. Walking the fd table needs kernel struct layouts so this is only done in the
+// CO-RE objects.
+// ------------------------------------------------------------------------------------------
+__attribute__((always_inline))
+static inline void ResolveFd(int fd, unsigned char* name, unsigned int len)
+{
+#ifdef EBPF_CO_RE
+    struct task_struct* task = (struct task_struct*)bpf_get_current_task();
+    struct files_struct* files = BPF_CORE_READ(task, files);
+    if (files == NULL)
+        return;
+
+    struct fdtable* fdt = BPF_CORE_READ(files, fdt);
+    if (fdt == NULL || fd < 0 || fd >= BPF_CORE_READ(fdt, max_fds))
+        return;
+
+    struct file** fds = BPF_CORE_READ(fdt, fd);
+    struct file* file = NULL;
+    if (bpf_probe_read(&file, sizeof(file), &fds[fd]) != 0 || file == NULL)
+        return;
+
+    //
+    // Sockets and pipes have no meaningful dentry name
+    //
+    struct inode* inode = BPF_CORE_READ(file, f_inode);
+    umode_t mode = BPF_CORE_READ(inode, i_mode) & FD_MODE_MASK;
+    if (mode == FD_MODE_SOCKET && len >= sizeof("socket"))
+    {
+        __builtin_memcpy(name, "socket", sizeof("socket"));
+        return;
+    }
+    if (mode == FD_MODE_PIPE && len >= sizeof("pipe"))
+    {
+        __builtin_memcpy(name, "pipe", sizeof("pipe"));
+        return;
+    }
+
+    struct dentry* dentry = BPF_CORE_READ(file, f_path.dentry);
+    const unsigned char* dname = BPF_CORE_READ(dentry, d_name.name);
+    bpf_probe_read_str(name, len, dname);
+#endif
+}
+
 // ------------------------------------------------------------------------------------------
 // PopulateArguments
 //
 // Populates the event with the arguments for the syscall.
 // ------------------------------------------------------------------------------------------
 __attribute__((always_inline))
-static inline int PopulateArguments(enum ProcmonArgTag type, unsigned long arg, struct SyscallEvent * event, unsigned int* offset_ptr)
+static inline int PopulateArguments(enum ProcmonArgTag type, unsigned long arg, unsigned char* buffer, unsigned int* offset_ptr)
 {
     unsigned int len = 0;
     unsigned int str = 0;
@@ -82,9 +130,21 @@ static inline int PopulateArguments(enum ProcmonArgTag type, unsigned long arg,
     }
     else if (type == FD)
     {
+        //
+        // The fd number followed by the name of what it refers to
+        //
         len = MAX_BUFFER / 6;
-        str = 1;
-        char buff[len];
+        if (*offset_ptr + len >= MAX_BUFFER)
+            return -1;
+
+        unsigned char fdSlot[MAX_BUFFER / 6] = {};
+        int32_t fd = (int32_t)arg;
+        __builtin_memcpy(fdSlot, &fd, sizeof(fd));
+        ResolveFd(fd, fdSlot + sizeof(fd), sizeof(fdSlot) - sizeof(fd));
+
+        bpf_probe(buffer + (*offset_ptr & (MAX_BUFFER - 1)), len, fdSlot, 0)
+        *offset_ptr += len;
+        return 0;
     }
     else if (type == UINT32)
     {
@@ -102,12 +162,92 @@ static inline int PopulateArguments(enum ProcmonArgTag type, unsigned long arg,
     if (!src)
         return -1;
 
-    bpf_probe(event->buffer + *offset_ptr, len, (void *)src, str)
+    bpf_probe(buffer + (*offset_ptr & (MAX_BUFFER - 1)), len, (void *)src, str)
     *offset_ptr += len;
 
     return 0;
 }
 
+// ------------------------------------------------------------------------------------------
+// DecodeSocketAddress
+//
+// Decodes the user sockaddr at user into address. Returns 0 for families other than
+// AF_INET, AF_INET6 and AF_UNIX or when it can't be read
+// ------------------------------------------------------------------------------------------
+__attribute__((always_inline))
+static inline int DecodeSocketAddress(const unsigned char* user, struct SocketAddress* address)
+{
+    if (bpf_probe_read(&address->family, sizeof(address->family), user) != 0)
+    {
+        return 0;
+    }
+
+    if (address->family == SOCKADDR_FAMILY_INET)
+    {
+        // struct sockaddr_in: port, then the 4 byte address
+        return bpf_probe_read(&address->port, sizeof(address->port), user + 2) == 0 &&
+               bpf_probe_read(address->addr, 4, user + 4) == 0;
+    }
+
+    if (address->family == SOCKADDR_FAMILY_INET6)
+    {
+        // struct sockaddr_in6: port, flow info, then the 16 byte address
+        return bpf_probe_read(&address->port, sizeof(address->port), user + 2) == 0 &&
+               bpf_probe_read(address->addr, 16, user + 8) == 0;
+    }
+
+    if (address->family == SOCKADDR_FAMILY_UNIX)
+    {
+        // struct sockaddr_un: the path, abstract ones start with a NUL
+        if (bpf_probe_read_str(address->path, sizeof(address->path), user + 2) > 1)
+        {
+            return 1;
+        }
+
+        address->path[0] = '@';
+        return bpf_probe_read_str(address->path + 1, sizeof(address->path) - 1, user + 3) > 1;
+    }
+
+    return 0;
+}
+
+// ------------------------------------------------------------------------------------------
+// CaptureStrings
+//
+// Copies the string arguments flagged in stringArgs, such as paths, in full up to maxString
+// bytes each, NUL terminated and in argument order. Unreadable strings are kept empty to
+// keep the argument order.
+// ------------------------------------------------------------------------------------------
+__attribute__((always_inline))
+static inline void CaptureStrings(struct InFlightData* data, const unsigned long* args, uint32_t stringArgs, uint64_t maxString)
+{
+    unsigned long stringsLength = 0;
+
+    for (int i = 0; i < 6; i++)
+    {
+        if ((stringArgs & (1 << i)) == 0)
+        {
+            continue;
+        }
+
+        if (stringsLength >= MAX_STRING_BYTES)
+        {
+            break;
+        }
+
+        long len = bpf_probe_read_str(data->strings + stringsLength, maxString, (const void*)args[i]);
+        if (len <= 0)
+        {
+            data->strings[stringsLength] = 0;
+            len = 1;
+        }
+
+        stringsLength += len;
+    }
+
+    data->stringsLength = stringsLength;
+}
+
 // ------------------------------------------------------------------------------------------
 // set_eventArgs
 //
@@ -151,17 +291,97 @@ static inline uint64_t GetRunningState()
 
 
 // ------------------------------------------------------------------------------------------
-// MatchPidFilter
+// GetConfigItem
 //
-// Checks if the specified pid matches the pid filter
+// Returns the configuration item stored under key, 0 if it isn't set
+// ------------------------------------------------------------------------------------------
+__attribute__((always_inline))
+static inline uint64_t GetConfigItem(uint32_t key)
+{
+    uint64_t *item = (uint64_t*)bpf_map_lookup_elem(&configuration, &key);
+    if(item == NULL)
+    {
+        return 0;
+    }
+
+    return *item;
+}
+
+// ------------------------------------------------------------------------------------------
+// IncrementStat
+//
+// Bumps one of the per CPU STAT_* counters
+// ------------------------------------------------------------------------------------------
+__attribute__((always_inline))
+static inline void IncrementStat(uint32_t stat)
+{
+    uint64_t *counter = (uint64_t*)bpf_map_lookup_elem(&procmonStats, &stat);
+    if(counter != NULL)
+    {
+        (*counter)++;
+    }
+}
+
+// ------------------------------------------------------------------------------------------
+// TakeTokens
+//
+// Refills the per CPU token bucket under key for the time elapsed at rate tokens per second,
+// the bucket holds at most a second worth, and takes up to wanted tokens out of it. Returns
+// the number of tokens taken
 // ------------------------------------------------------------------------------------------
 __attribute__((always_inline))
-static inline int IsProcmon()
+static inline uint64_t TakeTokens(uint32_t key, uint64_t rate, uint64_t wanted)
 {
-    char comm[16] = {0};
-    bpf_get_current_comm(comm, sizeof(comm));
+    struct GovernorState* state = bpf_map_lookup_elem(&governor, &key);
+    if (state == NULL)
+    {
+        return wanted;
+    }
+
+    uint64_t now = bpf_ktime_get_ns();
+    uint64_t elapsed = now - state->lastRefill;
+    if (elapsed > GOVERNOR_PERIOD_NS)
+    {
+        elapsed = GOVERNOR_PERIOD_NS;
+    }
 
-    if (comm[0] == 'p' && comm[1] == 'r' && comm[2] == 'o' && comm[3] == 'c' && comm[4] == 'm' && comm[5] == 'o' && comm[6] == 'n')
+    uint64_t refill = elapsed * rate / GOVERNOR_PERIOD_NS;
+    if (refill > 0)
+    {
+        state->tokens += refill;
+        if (state->tokens > rate)
+        {
+            state->tokens = rate;
+        }
+        state->lastRefill = now;
+    }
+
+    if (wanted > state->tokens)
+    {
+        wanted = state->tokens;
+    }
+    state->tokens -= wanted;
+
+    return wanted;
+}
+
+// ------------------------------------------------------------------------------------------
+// IsProcmon
+//
+// Checks if the specified tgid is procmon, one of its threads or one of its children
+// ------------------------------------------------------------------------------------------
+__attribute__((always_inline))
+static inline int IsProcmon(int pid)
+{
+    if (pid == GetConfigItem(CONFIG_PID_KEY))
+    {
+        return 1;
+    }
+
+    //
+    // Only look for children once procmon has actually forked one
+    //
+    if (GetConfigItem(CONFIG_PROCMON_CHILDREN_KEY) != 0 && bpf_map_lookup_elem(&procmonChildren, &pid) != NULL)
     {
         return 1;
     }
@@ -177,39 +397,20 @@ static inline int IsProcmon()
 __attribute__((always_inline))
 static inline int MatchPidFilter(int pid)
 {
-    for(int i=0; i<MAX_PIDS; i++)
+    //
+    // No pid filter means "include all"
+    //
+    if(GetConfigItem(CONFIG_PID_FILTER_KEY) == 0)
     {
-        uint32_t key = i;
-        int* pidMapItem = (int*)bpf_map_lookup_elem(&pids, &key);
-        if(pidMapItem)
-        {
-            int foundPid = *pidMapItem;
-
-            if(foundPid == pid)
-            {
-                return 1;
-            }
-
-            if(foundPid == -1)
-            {
-                //
-                // if the first element is -1, then we are in "include all" mode
-                //
-                if(i == 0)
-                {
-                    return 1;
-                }
+        return 1;
+    }
 
-                break;              // we can bail early since -1 indicates we've reached the end of the pid items in the map
-            }
-        }
-        else
-        {
-            break;
-        }
+    if(bpf_map_lookup_elem(&pids, &pid) == NULL)
+    {
+        return 0;
     }
 
-    return 0;
+    return 1;
 }
 
 // ------------------------------------------------------------------------------------------
@@ -223,7 +424,7 @@ static inline int CheckFilters(int pid)
     //
     // Check if we are in procmon
     //
-    if(IsProcmon() == 1)
+    if(IsProcmon(pid) == 1)
     {
         return 0;
     }
@@ -252,56 +453,70 @@ static inline int CheckFilters(int pid)
 // ------------------------------------------------------------------------------------------
 // genericRawEnter
 //
-// Called during a syscall enter
+// Called during a syscall enter. The start time, the raw arguments and the arguments
+// decoded while the pointers and fds they refer to are still valid are kept in the in
+// flight table, the event is built on exit.
 // ------------------------------------------------------------------------------------------
 SEC("raw_tracepoint/sys_enter")
 __attribute__((flatten))
 int genericRawEnter(struct bpf_our_raw_tracepoint_args *ctx)
 {
     uint32_t syscall = ctx->args[1];
-    uint32_t cpuId = bpf_get_smp_processor_id();
     uint64_t pidTid = bpf_get_current_pid_tgid();
     int pid = pidTid >> 32;
-    struct pt_regs* regs = NULL;
 
     //
-    // Check all filters
+    // Bail out as early as possible if this syscall isn't traced
     //
-    if(CheckFilters(pid) == 0)
+    uint32_t* flags = bpf_map_lookup_elem(&syscallFlags, &syscall);
+    if (flags == NULL || (*flags & SYSCALL_FLAG_TRACED) == 0)
     {
         return EBPF_RET_UNUSED;
     }
+    uint32_t sampleRate = *flags >> SYSCALL_SAMPLE_SHIFT;
 
     //
-    // Get the syscall details
+    // Check all filters
     //
-    struct SyscallSchema* schema = bpf_map_lookup_elem(&syscalls, &syscall);
-    if(schema == NULL)
+    if(CheckFilters(pid) == 0)
     {
-        BPF_PRINTK("[genericRawEnter] Failed to get syscall schema %d.", syscall);
         return EBPF_RET_UNUSED;
     }
 
     //
-    // Get temp storage to build up the event
+    // Get temp storage to build up the in flight entry
     //
-    struct SyscallEvent* sysEntry = bpf_map_lookup_elem(&eventStorageMap, &cpuId);
-    if (!sysEntry)
+    uint32_t storageKey = 0;
+    struct InFlightSyscall* inFlight = bpf_map_lookup_elem(&inFlightStorage, &storageKey);
+    if (inFlight == NULL)
     {
-        BPF_PRINTK("[genericRawEnter] Failed to get storage for syscall event.");
+        BPF_PRINTK("[genericRawEnter] Failed to get storage for in flight syscall.");
         return EBPF_RET_UNUSED;
     }
 
+    inFlight->sysnum = syscall;
+    inFlight->sampleRate = 1;
+    inFlight->kernelStackId = -1;
+    inFlight->argumentsLength = 0;
+    inFlight->hasData = 0;
+
     //
-    // Populate the event
+    // Keep only 1 in sampleRate calls of sampled syscalls, summary mode
+    // counts every call
     //
-    sysEntry->pid = pid;
-    sysEntry->sysnum = ctx->args[1];
-    bpf_get_current_comm(&sysEntry->comm, sizeof(sysEntry->comm));
-    sysEntry->userStackCount = bpf_get_stack(ctx, &sysEntry->userStack, MAX_STACK_FRAMES * sizeof(uint64_t), BPF_F_USER_STACK) / sizeof(uint64_t);
-    sysEntry->timestamp = bpf_ktime_get_ns();
+    int summary = GetConfigItem(CONFIG_SUMMARY_MODE_KEY) != 0;
+    if (sampleRate > 1 && !summary)
+    {
+        if (bpf_get_prandom_u32() % sampleRate != 0)
+        {
+            IncrementStat(STAT_SAMPLED_OUT);
+            return EBPF_RET_UNUSED;
+        }
+
+        inFlight->sampleRate = sampleRate;
+    }
 
-    regs = (struct pt_regs *)ctx->args[0];
+    struct pt_regs* regs = (struct pt_regs *)ctx->args[0];
     unsigned long a[8];
     if (!set_eventArgs(a, regs))
     {
@@ -309,23 +524,129 @@ int genericRawEnter(struct bpf_our_raw_tracepoint_args *ctx)
         return EBPF_RET_UNUSED;
     }
 
-    unsigned int offset = 0;
     for (int i = 0; i < 6; i++)
     {
-        if(PopulateArguments(schema->types[i], a[i], sysEntry, &offset) || i >= schema->usedArgCount)
+        inFlight->args[i] = a[i];
+    }
+
+    //
+    // Summary mode only aggregates, there is nothing to decode
+    //
+    if (!summary)
+    {
+        struct SyscallSchema* schema = bpf_map_lookup_elem(&syscalls, &syscall);
+        if (schema == NULL)
         {
-            break;
+            BPF_PRINTK("[genericRawEnter] Failed to get syscall schema %d.", syscall);
+            return EBPF_RET_UNUSED;
+        }
+
+        unsigned int offset = 0;
+        for (int i = 0; i < 6; i++)
+        {
+            if(PopulateArguments(schema->types[i], a[i], inFlight->arguments, &offset) || i >= schema->usedArgCount)
+            {
+                break;
+            }
+        }
+        inFlight->argumentsLength = offset;
+
+        //
+        // String arguments such as paths are also copied in full, as the
+        // preview above is only a few bytes long, and so are the buffers of
+        // write like syscalls, which the caller may reuse once they return.
+        // Sockaddrs passed in are decoded for the same reason. They go in a
+        // separate table as only some syscalls have them
+        //
+        uint32_t stringArgs = (*flags >> SYSCALL_STRING_ARGS_SHIFT) & SYSCALL_STRING_ARGS_MASK;
+        uint64_t maxString = GetConfigItem(CONFIG_MAX_STRING_KEY);
+        if (maxString > MAX_STRING_BYTES)
+        {
+            maxString = MAX_STRING_BYTES;
+        }
+
+        //
+        // The length of the buffer is the argument following it
+        //
+        uint32_t payloadArg = (*flags >> SYSCALL_PAYLOAD_ARG_SHIFT) & SYSCALL_PAYLOAD_ARG_MASK;
+        uint64_t snaplen = 0;
+        if ((*flags & SYSCALL_FLAG_PAYLOAD_WRITE) && payloadArg > 0 && payloadArg < 6)
+        {
+            snaplen = GetConfigItem(CONFIG_SNAPLEN_WRITE_KEY);
+            if (snaplen > inFlight->args[payloadArg])
+            {
+                snaplen = inFlight->args[payloadArg];
+            }
+            if (snaplen > MAX_PAYLOAD_BYTES)
+            {
+                snaplen = MAX_PAYLOAD_BYTES;
+            }
+        }
+
+        //
+        // Sockaddrs the kernel fills in are only there on exit
+        //
+        uint32_t addressArg = (*flags >> SYSCALL_SOCKADDR_ARG_SHIFT) & SYSCALL_SOCKADDR_ARG_MASK;
+        int decodeAddress = addressArg > 0 && addressArg <= 6 && (*flags & SYSCALL_FLAG_SOCKADDR_OUT) == 0 &&
+                            inFlight->args[addressArg - 1] != 0;
+
+        if ((stringArgs != 0 && maxString > 0) || snaplen > 0 || decodeAddress)
+        {
+            struct InFlightData* data = bpf_map_lookup_elem(&inFlightDataStorage, &storageKey);
+            if (data != NULL)
+            {
+                data->stringsLength = 0;
+                data->payloadLength = 0;
+                data->addressLength = 0;
+
+                if (stringArgs != 0 && maxString > 0)
+                {
+                    CaptureStrings(data, a, stringArgs, maxString);
+                }
+
+                uint64_t budget = GetConfigItem(CONFIG_PAYLOAD_BUDGET_KEY);
+                if (snaplen > 0 && budget > 0)
+                {
+                    snaplen = TakeTokens(GOVERNOR_PAYLOAD_KEY, budget, snaplen);
+                    if (snaplen == 0)
+                    {
+                        IncrementStat(STAT_PAYLOAD_DROPPED);
+                    }
+                }
+
+                if (snaplen > 0 && snaplen <= MAX_PAYLOAD_BYTES &&
+                    bpf_probe_read(data->payload, snaplen, (const void*)inFlight->args[payloadArg - 1]) == 0)
+                {
+                    data->payloadLength = snaplen;
+                }
+
+                if (decodeAddress)
+                {
+                    __builtin_memset(&data->address, 0, sizeof(data->address));
+                    if (DecodeSocketAddress((const unsigned char*)inFlight->args[addressArg - 1], &data->address))
+                    {
+                        data->addressLength = sizeof(data->address);
+                    }
+                }
+
+                if (data->stringsLength > 0 || data->payloadLength > 0 || data->addressLength > 0)
+                {
+                    inFlight->hasData = bpf_map_update_elem(&inFlightData, &pidTid, data, BPF_ANY) == UPDATE_OKAY;
+                }
+            }
         }
     }
 
+    inFlight->timestamp = bpf_ktime_get_ns();
+
     //
-    // Store the event to be retrieved and updated on exit
+    // Store the state to be picked up on exit
     //
-    if (bpf_map_update_elem(&syscallsMap, &pidTid, sysEntry, BPF_ANY) != UPDATE_OKAY)
+    if (bpf_map_update_elem(&syscallsMap, &pidTid, inFlight, BPF_ANY) != UPDATE_OKAY)
     {
-        BPF_PRINTK("[genericRawEnter] Failed to update syscalls map\n");
+        IncrementStat(STAT_IN_FLIGHT_FAILED);
         return EBPF_RET_UNUSED;
     }
 
     return EBPF_RET_UNUSED;
-}
\ No newline at end of file
+}
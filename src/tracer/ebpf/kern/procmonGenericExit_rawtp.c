@@ -24,6 +24,158 @@
 #include <sysinternalsEBPF_helpers.c>
 #include "procmonEBPF_maps.h"
 
+// ------------------------------------------------------------------------------------------
+// Log2
+//
+// Returns floor(log2(v)) without loops so it also passes the older verifiers
+// ------------------------------------------------------------------------------------------
+__attribute__((always_inline))
+static inline uint32_t Log2(uint64_t v)
+{
+    uint32_t r = (v > 0xFFFFFFFF) << 5;
+    v >>= r;
+    uint32_t shift = (v > 0xFFFF) << 4;
+    v >>= shift;
+    r |= shift;
+    shift = (v > 0xFF) << 3;
+    v >>= shift;
+    r |= shift;
+    shift = (v > 0xF) << 2;
+    v >>= shift;
+    r |= shift;
+    shift = (v > 0x3) << 1;
+    v >>= shift;
+    r |= shift;
+    r |= (v >> 1);
+
+    return r;
+}
+
+// ------------------------------------------------------------------------------------------
+// UpdateSummary
+//
+// Adds the completed syscall to the per CPU aggregate for its (tgid, syscall)
+// ------------------------------------------------------------------------------------------
+__attribute__((always_inline))
+static inline void UpdateSummary(struct SyscallEvent* event)
+{
+    struct SyscallSummaryKey key = {};
+    key.pid = event->pid;
+    key.sysnum = event->sysnum;
+
+    struct SyscallSummaryStats* stats = bpf_map_lookup_elem(&syscallSummary, &key);
+    if (stats == NULL)
+    {
+        struct SyscallSummaryStats empty = {};
+        bpf_map_update_elem(&syscallSummary, &key, &empty, BPF_NOEXIST);
+        stats = bpf_map_lookup_elem(&syscallSummary, &key);
+        if (stats == NULL)
+        {
+            BPF_PRINTK("[genericRawExit] Failed to add summary entry\n");
+            return;
+        }
+    }
+
+    //
+    // Per CPU values, no need for atomics
+    //
+    uint32_t slot = Log2((event->duration_ns / 1000) | 1);
+    if (slot >= SUMMARY_HISTOGRAM_SLOTS)
+    {
+        slot = SUMMARY_HISTOGRAM_SLOTS - 1;
+    }
+
+    stats->count++;
+    stats->totalDuration += event->duration_ns;
+    stats->histogram[slot]++;
+    if ((int64_t)event->ret < 0)
+    {
+        stats->errors++;
+    }
+}
+
+// ------------------------------------------------------------------------------------------
+// MatchPredicates
+//
+// Checks the completed syscall against the duration and result code predicates
+// ------------------------------------------------------------------------------------------
+__attribute__((always_inline))
+static inline int MatchPredicates(struct SyscallEvent* event)
+{
+    if (event->duration_ns < GetConfigItem(CONFIG_MIN_DURATION_KEY))
+    {
+        return 0;
+    }
+
+    int64_t ret = (int64_t)event->ret;
+    if (GetConfigItem(CONFIG_ERRORS_ONLY_KEY) != 0 && ret >= 0)
+    {
+        return 0;
+    }
+
+    //
+    // Only keep the listed errno values
+    //
+    if (GetConfigItem(CONFIG_ERRNO_FILTER_KEY) != 0)
+    {
+        if (ret >= 0 || ret <= -ERRNO_MAX)
+        {
+            return 0;
+        }
+
+        uint32_t error = -ret;
+        uint32_t* match = bpf_map_lookup_elem(&errnoFilter, &error);
+        if (match == NULL || *match == 0)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+// ------------------------------------------------------------------------------------------
+// Govern
+//
+// Per CPU token bucket holding the event rate to CONFIG_RATE_LIMIT_KEY events per second.
+// While the bucket is empty only 1 in GOVERNOR_SAMPLE_RATE events is sent, with its
+// sample rate scaled up so counts can still be estimated
+// ------------------------------------------------------------------------------------------
+__attribute__((always_inline))
+static inline int Govern(struct SyscallEvent* event)
+{
+    uint64_t rate = GetConfigItem(CONFIG_RATE_LIMIT_KEY);
+    if (rate == 0 || TakeTokens(GOVERNOR_EVENTS_KEY, rate, 1) == 1)
+    {
+        return 1;
+    }
+
+    if (bpf_get_prandom_u32() % GOVERNOR_SAMPLE_RATE == 0)
+    {
+        event->sampleRate *= GOVERNOR_SAMPLE_RATE;
+        return 1;
+    }
+
+    IncrementStat(STAT_THROTTLED);
+    return 0;
+}
+
+// ------------------------------------------------------------------------------------------
+// DropInFlight
+//
+// Removes the in flight entry of the syscall along with the data it captured on enter
+// ------------------------------------------------------------------------------------------
+__attribute__((always_inline))
+static inline void DropInFlight(uint64_t pidTid, const struct InFlightSyscall* inFlight)
+{
+    if (inFlight->hasData)
+    {
+        bpf_map_delete_elem(&inFlightData, &pidTid);
+    }
+
+    bpf_map_delete_elem(&syscallsMap, &pidTid);
+}
+
 // ------------------------------------------------------------------------------------------
 // genericRawExit
 //
@@ -35,43 +187,252 @@ int genericRawExit(struct bpf_our_raw_tracepoint_args *ctx)
 {
     uint64_t pidTid = bpf_get_current_pid_tgid();
     const struct pt_regs *regs = (const struct pt_regs *)ctx->args[0];
-    int pid = pidTid >> 32;
 
     //
-    // Check all filters
+    // Look up the corresponding in flight syscall, the filters were already
+    // applied on enter so an in flight entry is all we need to check for
     //
-    if(CheckFilters(pid) == 0)
+    struct InFlightSyscall* inFlight = (struct InFlightSyscall*) bpf_map_lookup_elem(&syscallsMap, &pidTid);
+    if (inFlight == NULL)
     {
         return EBPF_RET_UNUSED;
     }
 
-
     //
-    // Look up the corresponding event
+    // Get temp storage to build up the event
     //
-    struct SyscallEvent* event = (struct SyscallEvent*) bpf_map_lookup_elem(&syscallsMap, &pidTid);
+    uint32_t storageKey = 0;
+    struct SyscallEvent* event = bpf_map_lookup_elem(&eventStorageMap, &storageKey);
     if (event == NULL)
     {
+        BPF_PRINTK("[genericRawExit] Failed to get storage for syscall event.");
+        DropInFlight(pidTid, inFlight);
         return EBPF_RET_UNUSED;
     }
 
     //
-    // Update event fields
+    // Fill in what the filters below look at first
     //
-    event->duration_ns = bpf_ktime_get_ns() - event->timestamp;
+    event->pid = pidTid >> 32;
+    event->sysnum = inFlight->sysnum;
+    event->timestamp = inFlight->timestamp;
+    event->duration_ns = bpf_ktime_get_ns() - inFlight->timestamp;
+    event->sampleRate = inFlight->sampleRate;
 
     if (bpf_probe_read(&event->ret, sizeof(int64_t), (void *)&SYSCALL_PT_REGS_RC(regs)) != 0)
     {
         BPF_PRINTK("[genericRawExit] Failed to get return code\n");
+        DropInFlight(pidTid, inFlight);
         return EBPF_RET_UNUSED;
     }
 
     //
-    // Send event
+    // In summary mode the event is only aggregated, never sent
     //
-    eventOutput((void*)ctx, &eventMap, BPF_F_CURRENT_CPU, event, sizeof(struct SyscallEvent));
+    if (GetConfigItem(CONFIG_SUMMARY_MODE_KEY) != 0)
+    {
+        UpdateSummary(event);
+        DropInFlight(pidTid, inFlight);
+        return EBPF_RET_UNUSED;
+    }
 
-    bpf_map_delete_elem(&syscallsMap, &pidTid);
+    //
+    // Drop uninteresting events and keep within the rate budget here
+    // rather than in userland
+    //
+    if (MatchPredicates(event) == 0 || Govern(event) == 0)
+    {
+        DropInFlight(pidTid, inFlight);
+        return EBPF_RET_UNUSED;
+    }
+
+    uint32_t sysnum = inFlight->sysnum;
+    bpf_get_current_comm(&event->comm, sizeof(event->comm));
+
+    int tgid = event->pid;
+    struct ProcessRecord* process = (struct ProcessRecord*) bpf_map_lookup_elem(&processes, &tgid);
+    event->processStartTime = process != NULL ? process->startTime : 0;
+
+    //
+    // The stack goes at the start of data, the arguments are packed right
+    // after the used frames so nothing but the populated bytes is sent.
+    // In stack id mode only the id of the deduplicated stack is sent.
+    //
+    long stackBytes = 0;
+    event->userStackId = -1;
+    if (GetConfigItem(CONFIG_STACK_MODE_KEY) == STACK_MODE_ID)
+    {
+        event->userStackId = bpf_get_stackid(ctx, &stackTraces, BPF_F_USER_STACK);
+    }
+    else
+    {
+        stackBytes = bpf_get_stack(ctx, event->data, MAX_STACK_BYTES, BPF_F_USER_STACK);
+        if (stackBytes < 0)
+        {
+            stackBytes = 0;
+        }
+        else if (stackBytes > MAX_STACK_BYTES)
+        {
+            stackBytes = MAX_STACK_BYTES;
+        }
+    }
+    event->userStackCount = stackBytes / sizeof(uint64_t);
+    event->kernelStackId = inFlight->kernelStackId;
+    stackBytes = event->userStackCount * sizeof(uint64_t);
+
+    //
+    // The arguments were decoded on enter, the whole preview is copied as
+    // a constant size is easier on the verifier, only offset bytes are sent
+    //
+    unsigned int offset = inFlight->argumentsLength & (MAX_BUFFER - 1);
+    if (stackBytes > MAX_STACK_BYTES)
+    {
+        stackBytes = MAX_STACK_BYTES;
+    }
+    bpf_probe_read(event->data + stackBytes, MAX_BUFFER, inFlight->arguments);
+    event->bufferLength = offset;
+
+    //
+    // String arguments captured in full on enter follow the arguments
+    //
+    uint32_t* flags = bpf_map_lookup_elem(&syscallFlags, &sysnum);
+    struct InFlightData* data = inFlight->hasData ? bpf_map_lookup_elem(&inFlightData, &pidTid) : NULL;
+    unsigned long stringsLength = 0;
+    if (data != NULL)
+    {
+        unsigned long stringsStart = stackBytes + offset;
+        if (stringsStart > MAX_STACK_BYTES + MAX_BUFFER)
+        {
+            stringsStart = MAX_STACK_BYTES + MAX_BUFFER;
+        }
+
+        stringsLength = data->stringsLength;
+        if (stringsLength == 0 || stringsLength > MAX_STRINGS_BYTES ||
+            bpf_probe_read(event->data + stringsStart, stringsLength, data->strings) != 0)
+        {
+            stringsLength = 0;
+        }
+    }
+    event->stringsLength = stringsLength;
+
+    //
+    // Data buffers of write like syscalls were copied on enter and are only
+    // trimmed to the bytes actually written. Those of read like syscalls are
+    // copied now that they have been filled in, up to the read snaplen and
+    // the bytes actually read, within the per CPU payload budget
+    //
+    event->payloadLength = 0;
+    uint32_t payloadArg = flags != NULL ? (*flags >> SYSCALL_PAYLOAD_ARG_SHIFT) & SYSCALL_PAYLOAD_ARG_MASK : 0;
+    if (payloadArg > 0 && payloadArg <= 6 && (int64_t)event->ret > 0)
+    {
+        unsigned long payloadStart = stackBytes + offset + stringsLength;
+        if (payloadStart > MAX_STACK_BYTES + MAX_BUFFER + MAX_STRINGS_BYTES)
+        {
+            payloadStart = MAX_STACK_BYTES + MAX_BUFFER + MAX_STRINGS_BYTES;
+        }
+
+        if (*flags & SYSCALL_FLAG_PAYLOAD_WRITE)
+        {
+            uint64_t snaplen = data != NULL ? data->payloadLength : 0;
+            if (snaplen > (uint64_t)event->ret)
+            {
+                snaplen = event->ret;
+            }
+
+            if (snaplen > 0 && snaplen <= MAX_PAYLOAD_BYTES &&
+                bpf_probe_read(event->data + payloadStart, snaplen, data->payload) == 0)
+            {
+                event->payloadLength = snaplen;
+            }
+        }
+        else
+        {
+            uint64_t snaplen = GetConfigItem(CONFIG_SNAPLEN_READ_KEY);
+            if (snaplen > (uint64_t)event->ret)
+            {
+                snaplen = event->ret;
+            }
+            if (snaplen > MAX_PAYLOAD_BYTES)
+            {
+                snaplen = MAX_PAYLOAD_BYTES;
+            }
+
+            uint64_t budget = GetConfigItem(CONFIG_PAYLOAD_BUDGET_KEY);
+            if (snaplen > 0 && budget > 0)
+            {
+                snaplen = TakeTokens(GOVERNOR_PAYLOAD_KEY, budget, snaplen);
+                if (snaplen == 0)
+                {
+                    IncrementStat(STAT_PAYLOAD_DROPPED);
+                }
+            }
+
+            if (snaplen > 0 && snaplen <= MAX_PAYLOAD_BYTES &&
+                bpf_probe_read(event->data + payloadStart, snaplen, (const void*)inFlight->args[payloadArg - 1]) == 0)
+            {
+                event->payloadLength = snaplen;
+            }
+        }
+    }
+
+    //
+    // The sockaddr of network syscalls is decoded into a fixed layout. One
+    // passed in was decoded on enter, one the kernel fills in is only there
+    // once the call succeeded
+    //
+    event->addressLength = 0;
+    uint32_t addressArg = flags != NULL ? (*flags >> SYSCALL_SOCKADDR_ARG_SHIFT) & SYSCALL_SOCKADDR_ARG_MASK : 0;
+    if (addressArg > 0 && addressArg <= 6)
+    {
+        unsigned long addressStart = stackBytes + offset + stringsLength + event->payloadLength;
+        if (addressStart > MAX_STACK_BYTES + MAX_BUFFER + MAX_STRINGS_BYTES + MAX_PAYLOAD_BYTES)
+        {
+            addressStart = MAX_STACK_BYTES + MAX_BUFFER + MAX_STRINGS_BYTES + MAX_PAYLOAD_BYTES;
+        }
+
+        if ((*flags & SYSCALL_FLAG_SOCKADDR_OUT) == 0)
+        {
+            if (data != NULL && data->addressLength == sizeof(data->address) &&
+                bpf_probe_read(event->data + addressStart, sizeof(data->address), &data->address) == 0)
+            {
+                event->addressLength = sizeof(data->address);
+            }
+        }
+        else if (inFlight->args[addressArg - 1] != 0 && (int64_t)event->ret >= 0)
+        {
+            struct SocketAddress address = {};
+            if (DecodeSocketAddress((const unsigned char*)inFlight->args[addressArg - 1], &address) &&
+                bpf_probe_read(event->data + addressStart, sizeof(address), &address) == 0)
+            {
+                event->addressLength = sizeof(address);
+            }
+        }
+    }
+
+    //
+    // Send only the header and the used part of the event
+    //
+    uint32_t size = SYSCALL_EVENT_SIZE(event);
+    if (size > sizeof(struct SyscallEvent))
+    {
+        size = sizeof(struct SyscallEvent);
+    }
+
+#ifdef PROCMON_RINGBUF
+    //
+    // bpf_ringbuf_reserve only takes a constant size, so variable length
+    // records are copied into the shared ring with bpf_ringbuf_output
+    //
+    if (bpf_ringbuf_output(&eventRingBuffer, event, size, 0) != 0)
+    {
+        // the ring is full, count it as userland won't see a lost record
+        IncrementStat(STAT_LOST);
+    }
+#else
+    eventOutput((void*)ctx, &eventMap, BPF_F_CURRENT_CPU, event, size);
+#endif
+
+    DropInFlight(pidTid, inFlight);
 
     return EBPF_RET_UNUSED;
 }
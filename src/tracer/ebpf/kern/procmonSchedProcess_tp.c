@@ -0,0 +1,257 @@
+/*
+    Procmon-for-Linux
+
+    Copyright (c) Microsoft Corporation
+
+    All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "procmonEBPF_common.h"
+#include <sysinternalsEBPF_helpers.c>
+#include "procmonEBPF_maps.h"
+
+#ifndef EBPF_CO_RE
+struct trace_event_raw_task_newtask
+{
+    uint64_t unused;            // common tracepoint fields
+    pid_t pid;
+    char comm[16];
+    unsigned long clone_flags;
+    short oom_score_adj;
+};
+
+struct trace_event_raw_sched_process_exec
+{
+    uint64_t unused;            // common tracepoint fields
+    uint32_t __data_loc_filename;
+    pid_t pid;
+    pid_t old_pid;
+};
+#endif
+
+// ------------------------------------------------------------------------------------------
+// procmonProcessFork
+//
+// Called in the parent when a task is created. Children of procmon are excluded from
+// tracing. If the parent is being traced and we are following children, the child is
+// added to the pid filter. New threads share the tgid of their parent, which the filters
+// already match on, so only real process forks are recorded, in the processes map too.
+// ------------------------------------------------------------------------------------------
+SEC("tracepoint/task/task_newtask")
+int procmonProcessFork(struct trace_event_raw_task_newtask *ctx)
+{
+    int parent = bpf_get_current_pid_tgid() >> 32;
+
+    if(ctx->clone_flags & CLONE_THREAD_FLAG)
+    {
+        return EBPF_RET_UNUSED;
+    }
+
+    //
+    // Records are left for the LRU to evict rather than dropped on exit,
+    // events of the process may still be queued then
+    //
+    int forked = ctx->pid;
+    struct ProcessRecord record = {
+        .startTime = bpf_ktime_get_ns(),
+        .ppid = parent,
+        .uid = (uint32_t)bpf_get_current_uid_gid()
+    };
+    bpf_map_update_elem(&processes, &forked, &record, BPF_ANY);
+
+    //
+    // The child runs the same program as its parent until it execs
+    //
+    struct ProcessImage* parentImage = bpf_map_lookup_elem(&processImages, &parent);
+    if(parentImage != NULL)
+    {
+        uint32_t storageKey = 0;
+        struct ProcessImage* image = bpf_map_lookup_elem(&processImageStorage, &storageKey);
+        if(image != NULL && bpf_probe_read(image, sizeof(*image), parentImage) == 0)
+        {
+            image->startTime = record.startTime;
+            bpf_map_update_elem(&processImages, &forked, image, BPF_ANY);
+        }
+    }
+
+    if(IsProcmon(parent) == 1)
+    {
+        int child = ctx->pid;
+        uint32_t value = 1;
+        bpf_map_update_elem(&procmonChildren, &child, &value, BPF_ANY);
+
+        uint32_t key = CONFIG_PROCMON_CHILDREN_KEY;
+        uint64_t enabled = 1;
+        bpf_map_update_elem(&configuration, &key, &enabled, BPF_ANY);
+        return EBPF_RET_UNUSED;
+    }
+
+    if(GetConfigItem(CONFIG_FOLLOW_CHILDREN_KEY) == 0 || GetConfigItem(CONFIG_PID_FILTER_KEY) == 0)
+    {
+        return EBPF_RET_UNUSED;
+    }
+
+    if(bpf_map_lookup_elem(&pids, &parent) == NULL)
+    {
+        return EBPF_RET_UNUSED;
+    }
+
+    int child = ctx->pid;
+    uint32_t value = PID_FILTER_FOLLOWED;
+    if (bpf_map_update_elem(&pids, &child, &value, BPF_NOEXIST) != UPDATE_OKAY)
+    {
+        BPF_PRINTK("[procmonProcessFork] Failed to follow child %d\n", child);
+    }
+
+    return EBPF_RET_UNUSED;
+}
+
+// ------------------------------------------------------------------------------------------
+// procmonProcessExec
+//
+// Called when a process execs. It gets a new start time so that the events from before
+// and after the exec are attributed to the right program, and what it exec'd is kept
+// while the new program's arguments are still there.
+// ------------------------------------------------------------------------------------------
+SEC("tracepoint/sched/sched_process_exec")
+int procmonProcessExec(struct trace_event_raw_sched_process_exec *ctx)
+{
+    int tgid = bpf_get_current_pid_tgid() >> 32;
+
+    struct ProcessRecord record = {
+        .startTime = bpf_ktime_get_ns(),
+        .ppid = 0,
+        .uid = (uint32_t)bpf_get_current_uid_gid()
+    };
+
+    struct ProcessRecord* forked = (struct ProcessRecord*) bpf_map_lookup_elem(&processes, &tgid);
+    if(forked != NULL)
+    {
+        record.ppid = forked->ppid;
+    }
+
+    bpf_map_update_elem(&processes, &tgid, &record, BPF_ANY);
+
+    uint32_t storageKey = 0;
+    struct ProcessImage* image = bpf_map_lookup_elem(&processImageStorage, &storageKey);
+    if(image == NULL)
+    {
+        return EBPF_RET_UNUSED;
+    }
+
+    image->startTime = record.startTime;
+    image->exeLength = 0;
+    image->argvLength = 0;
+    bpf_get_current_comm(image->comm, sizeof(image->comm));
+
+    long exeLength = bpf_probe_read_str(image->exe, sizeof(image->exe), (const char*)ctx + (ctx->__data_loc_filename & 0xFFFF));
+    if(exeLength > 0)
+    {
+        image->exeLength = exeLength - 1;
+    }
+
+#ifdef EBPF_CO_RE
+    struct task_struct* task = (struct task_struct*)bpf_get_current_task();
+    struct mm_struct* mm = BPF_CORE_READ(task, mm);
+    unsigned long argStart = mm != NULL ? BPF_CORE_READ(mm, arg_start) : 0;
+    unsigned long argvLength = mm != NULL ? BPF_CORE_READ(mm, arg_end) - argStart : 0;
+    if(argvLength > PROCESS_ARGV_BYTES)
+    {
+        argvLength = PROCESS_ARGV_BYTES;
+    }
+
+    if(argStart != 0 && argvLength > 0 && argvLength <= PROCESS_ARGV_BYTES &&
+       bpf_probe_read(image->argv, argvLength, (const void*)argStart) == 0)
+    {
+        image->argvLength = argvLength;
+    }
+#endif
+
+    bpf_map_update_elem(&processImages, &tgid, image, BPF_ANY);
+
+    return EBPF_RET_UNUSED;
+}
+
+// ------------------------------------------------------------------------------------------
+// procmonProcessExit
+//
+// Called when a task exits. Children we started following (or procmon's own children)
+// are dropped so a recycled pid isn't traced or excluded by accident. The exit or
+// exit_group call of the task never returns, so its in flight entry goes too. When the
+// main thread exits userland is told the process is gone.
+// ------------------------------------------------------------------------------------------
+SEC("tracepoint/sched/sched_process_exit")
+int procmonProcessExit(void *ctx)
+{
+    uint64_t pidTid = bpf_get_current_pid_tgid();
+    int tid = (uint32_t)pidTid;
+    int tgid = pidTid >> 32;
+
+    bpf_map_delete_elem(&syscallsMap, &pidTid);
+    bpf_map_delete_elem(&inFlightData, &pidTid);
+
+    if(tid == tgid)
+    {
+        struct ProcessRecord* record = (struct ProcessRecord*) bpf_map_lookup_elem(&processes, &tgid);
+        uint64_t startTime = record != NULL ? record->startTime : 0;
+        bpf_map_update_elem(&exitedProcesses, &tgid, &startTime, BPF_ANY);
+    }
+
+    if(GetConfigItem(CONFIG_PROCMON_CHILDREN_KEY) != 0)
+    {
+        bpf_map_delete_elem(&procmonChildren, &tid);
+    }
+
+    if(GetConfigItem(CONFIG_FOLLOW_CHILDREN_KEY) == 0)
+    {
+        return EBPF_RET_UNUSED;
+    }
+
+    uint32_t *value = bpf_map_lookup_elem(&pids, &tid);
+    if(value != NULL && *value == PID_FILTER_FOLLOWED)
+    {
+        bpf_map_delete_elem(&pids, &tid);
+    }
+
+    return EBPF_RET_UNUSED;
+}
+
+// ------------------------------------------------------------------------------------------
+// procmonSchedSwitch
+//
+// Called when the current task is switched out. If it is in the middle of a traced syscall
+// the kernel stack it blocked or was preempted in is recorded, the stack at syscall exit
+// wouldn't tell where the time went. Only attached when kernel stacks are asked for.
+// ------------------------------------------------------------------------------------------
+SEC("tracepoint/sched/sched_switch")
+int procmonSchedSwitch(void *ctx)
+{
+    uint64_t pidTid = bpf_get_current_pid_tgid();
+    struct InFlightSyscall* inFlight = (struct InFlightSyscall*) bpf_map_lookup_elem(&syscallsMap, &pidTid);
+    if(inFlight == NULL)
+    {
+        return EBPF_RET_UNUSED;
+    }
+
+    int32_t stackId = bpf_get_stackid(ctx, &stackTraces, 0);
+    if(stackId >= 0)
+    {
+        inFlight->kernelStackId = stackId;
+    }
+
+    return EBPF_RET_UNUSED;
+}
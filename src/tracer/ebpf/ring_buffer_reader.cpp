@@ -0,0 +1,222 @@
+/*
+    Procmon-for-Linux
+
+    Copyright (c) Microsoft Corporation
+
+    All rights reserved.
+
+    MIT License
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "ring_buffer_reader.h"
+#include "../../logging/easylogging++.h"
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <linux/bpf.h>
+
+#ifndef BPF_RINGBUF_BUSY_BIT
+#define BPF_RINGBUF_BUSY_BIT    (1U << 31)
+#define BPF_RINGBUF_DISCARD_BIT (1U << 30)
+#define BPF_RINGBUF_HDR_SZ      8
+#endif
+
+//--------------------------------------------------------------------
+//
+// ~RingBufferReader
+//
+// Destructor for the ring buffer reader.
+//
+//--------------------------------------------------------------------
+RingBufferReader::~RingBufferReader()
+{
+    Close();
+}
+
+//--------------------------------------------------------------------
+//
+// Map
+//
+// Maps the ring buffer map identified by fd. size must match the
+// max_entries the map was created with.
+//
+//--------------------------------------------------------------------
+bool RingBufferReader::Map(int fd, size_t size, RingBufferCallback cb, void *cbCookie)
+{
+    mapFd = fd;
+    ringSize = size;
+    mask = size - 1;
+    callback = cb;
+    cookie = cbCookie;
+    pageSize = sysconf(_SC_PAGESIZE);
+
+    void* consumer = mmap(NULL, pageSize, PROT_READ | PROT_WRITE, MAP_SHARED, mapFd, 0);
+    if (consumer == MAP_FAILED)
+    {
+        LOG(ERROR) << "Failed to map ring buffer consumer page: " << strerror(errno);
+        return false;
+    }
+    consumerPos = static_cast<uint64_t*>(consumer);
+
+    //
+    // The data area is mapped twice back to back by the kernel so
+    // records that wrap around the end can be read contiguously
+    //
+    void* producer = mmap(NULL, pageSize + 2 * ringSize, PROT_READ, MAP_SHARED, mapFd, pageSize);
+    if (producer == MAP_FAILED)
+    {
+        LOG(ERROR) << "Failed to map ring buffer data pages: " << strerror(errno);
+        Close();
+        return false;
+    }
+    producerPos = static_cast<uint64_t*>(producer);
+    data = static_cast<uint8_t*>(producer) + pageSize;
+
+    return true;
+}
+
+//--------------------------------------------------------------------
+//
+// Open
+//
+// Maps the ring buffer map identified by fd and registers it for Poll
+// to wait on.
+//
+//--------------------------------------------------------------------
+bool RingBufferReader::Open(int fd, size_t size, RingBufferCallback cb, void *cbCookie)
+{
+    if (!Map(fd, size, cb, cbCookie))
+    {
+        return false;
+    }
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0)
+    {
+        LOG(ERROR) << "Failed to create ring buffer epoll instance: " << strerror(errno);
+        Close();
+        return false;
+    }
+
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, mapFd, &event) < 0)
+    {
+        LOG(ERROR) << "Failed to add ring buffer to epoll: " << strerror(errno);
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------------
+//
+// Consume
+//
+// Hands every committed record to the callback and releases the
+// space back to the producer. Returns the number of records consumed.
+//
+//--------------------------------------------------------------------
+int RingBufferReader::Consume()
+{
+    int count = 0;
+    bool gotData;
+    uint64_t cons = __atomic_load_n(consumerPos, __ATOMIC_ACQUIRE);
+
+    do
+    {
+        gotData = false;
+        uint64_t prod = __atomic_load_n(producerPos, __ATOMIC_ACQUIRE);
+
+        while (cons < prod)
+        {
+            uint32_t* header = reinterpret_cast<uint32_t*>(data + (cons & mask));
+            uint32_t len = __atomic_load_n(header, __ATOMIC_ACQUIRE);
+
+            //
+            // Record has been reserved but not committed yet
+            //
+            if (len & BPF_RINGBUF_BUSY_BIT)
+            {
+                return count;
+            }
+
+            gotData = true;
+            uint32_t recordLen = len & ~(BPF_RINGBUF_BUSY_BIT | BPF_RINGBUF_DISCARD_BIT);
+            cons += (recordLen + BPF_RINGBUF_HDR_SZ + 7) & ~7ULL;
+
+            if ((len & BPF_RINGBUF_DISCARD_BIT) == 0)
+            {
+                callback(cookie, reinterpret_cast<uint8_t*>(header) + BPF_RINGBUF_HDR_SZ, recordLen);
+                count++;
+            }
+
+            __atomic_store_n(consumerPos, cons, __ATOMIC_RELEASE);
+        }
+    } while (gotData);
+
+    return count;
+}
+
+//--------------------------------------------------------------------
+//
+// Poll
+//
+// Waits up to timeoutMs for data and consumes everything available.
+// Returns the number of records consumed or -1 on error.
+//
+//--------------------------------------------------------------------
+int RingBufferReader::Poll(int timeoutMs)
+{
+    if (epollFd < 0)
+    {
+        return -1;
+    }
+
+    struct epoll_event event;
+    int ret = epoll_wait(epollFd, &event, 1, timeoutMs);
+    if (ret < 0)
+    {
+        return errno == EINTR ? 0 : -1;
+    }
+
+    return Consume();
+}
+
+//--------------------------------------------------------------------
+//
+// Close
+//
+// Unmaps the ring buffer.
+//
+//--------------------------------------------------------------------
+void RingBufferReader::Close()
+{
+    if (epollFd >= 0)
+    {
+        close(epollFd);
+        epollFd = -1;
+    }
+
+    if (producerPos != nullptr)
+    {
+        munmap(producerPos, pageSize + 2 * ringSize);
+        producerPos = nullptr;
+        data = nullptr;
+    }
+
+    if (consumerPos != nullptr)
+    {
+        munmap(consumerPos, pageSize);
+        consumerPos = nullptr;
+    }
+}
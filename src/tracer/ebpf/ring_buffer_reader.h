@@ -0,0 +1,59 @@
+/*
+    Procmon-for-Linux
+
+    Copyright (c) Microsoft Corporation
+
+    All rights reserved.
+
+    MIT License
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+//
+// Callback invoked for every committed record in the ring
+//
+typedef void (*RingBufferCallback)(void *cbCookie, void *data, uint32_t size);
+
+//
+// Consumer side of a BPF_MAP_TYPE_RINGBUF map. The ring is shared by all
+// CPUs so records are delivered in the order they were reserved.
+//
+class RingBufferReader
+{
+private:
+    int mapFd = -1;
+    int epollFd = -1;
+    uint64_t mask = 0;
+    size_t pageSize = 0;
+    size_t ringSize = 0;
+
+    // consumer position page (read/write) and producer position page
+    // followed by the data pages mapped twice (read only)
+    uint64_t *consumerPos = nullptr;
+    uint64_t *producerPos = nullptr;
+    uint8_t *data = nullptr;
+
+    RingBufferCallback callback = nullptr;
+    void *cookie = nullptr;
+
+public:
+    RingBufferReader() {};
+    ~RingBufferReader();
+
+    // Map only maps the ring, Open also lets Poll wait for records
+    bool Map(int fd, size_t size, RingBufferCallback cb, void *cbCookie);
+    bool Open(int fd, size_t size, RingBufferCallback cb, void *cbCookie);
+    int Poll(int timeoutMs);
+    int Consume();
+    void Close();
+};
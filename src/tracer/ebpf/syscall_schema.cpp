@@ -38,3 +38,23 @@ std::vector<std::string> Utils::Linux64PointerSycalls = {
         "shmat",
         "getcwd"
     };
+
+// Syscalls whose data buffer can be captured, true for the ones that send data
+std::map<std::string, bool> Utils::PayloadSyscalls = {
+        {"read", false},
+        {"pread64", false},
+        {"recvfrom", false},
+        {"write", true},
+        {"pwrite64", true},
+        {"sendto", true}
+    };
+
+// Index of the sockaddr argument of network syscalls, true for the ones where the kernel fills it in
+std::map<std::string, std::pair<int, bool>> Utils::SocketAddressSyscalls = {
+        {"connect", {1, false}},
+        {"bind", {1, false}},
+        {"accept", {1, true}},
+        {"accept4", {1, true}},
+        {"sendto", {4, false}},
+        {"recvfrom", {4, true}}
+    };
@@ -32,18 +32,68 @@
     public:
         static std::map<std::string, ProcmonArgTag> ArgTypeStringToArgTag;
         static std::vector<std::string> Linux64PointerSycalls;
+        static std::map<std::string, bool> PayloadSyscalls;
+        static std::map<std::string, std::pair<int, bool>> SocketAddressSyscalls;
 
         static int GetSyscallNumberForName(const std::string& name)
         {
-            for(const auto& syscall : syscalls)
+            return SyscallNumberForName(name);
+        }
+
+        // Name of a syscall number for display, the number itself if it has none
+        static std::string GetSyscallName(int number)
+        {
+            const char* name = SyscallNameForNumber(number);
+            return name != nullptr ? name : std::to_string(number);
+        }
+
+        // Index in schemas of the schema of each syscall number, -1 for the
+        // numbers without one, so schemas can be found without comparing names
+        static std::vector<int> IndexSyscallSchema(const std::vector<SyscallSchema>& schemas)
+        {
+            std::vector<int> indexes(SYSCALL_NUMBER_COUNT, -1);
+            for (size_t i = 0; i < schemas.size(); i++)
             {
-                if (syscall.name == name)
+                int number = SyscallNumberForName(schemas[i].syscallName);
+                if (number >= 0)
                 {
-                    return syscall.number;
+                    indexes[number] = i;
                 }
             }
 
-            return -1;
+            return indexes;
+        }
+
+        // String arguments, such as paths, that are captured in full rather than
+        // just previewed. Buffers are left out as they aren't strings.
+        static bool IsStringArg(const SyscallSchema& schema, int arg)
+        {
+            return schema.types[arg] == ProcmonArgTag::CONST_CHAR_PTR && std::strcmp(schema.argNames[arg], "buf") != 0;
+        }
+
+        // Index of the data buffer argument of read and write like syscalls, -1 for
+        // other syscalls. write is set for the ones that send data.
+        static int GetPayloadArg(const SyscallSchema& schema, bool& write)
+        {
+            auto payload = PayloadSyscalls.find(schema.syscallName);
+            if (payload == PayloadSyscalls.end() || schema.usedArgCount < 2)
+                return -1;
+
+            // the buffer always follows the fd
+            write = payload->second;
+            return 1;
+        }
+
+        // Index of the sockaddr argument of network syscalls, -1 for other syscalls.
+        // filled is set for the ones where the kernel fills the sockaddr in.
+        static int GetSocketAddressArg(const SyscallSchema& schema, bool& filled)
+        {
+            auto address = SocketAddressSyscalls.find(schema.syscallName);
+            if (address == SocketAddressSyscalls.end() || address->second.first >= schema.usedArgCount)
+                return -1;
+
+            filled = address->second.second;
+            return address->second.first;
         }
 
         static ProcmonArgTag GetArgTagForArg(const std::string &argumentName, const std::string &argumentType)
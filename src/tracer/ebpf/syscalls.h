@@ -2,6 +2,11 @@
 #ifndef SYSCALL_H
 #define SYSCALL_H
 
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
 struct SyscallInfo {
     int number;
     std::string category;
@@ -364,4 +369,543 @@ const std::vector<SyscallInfo> syscalls = {
     {456, "common", "futex_requeue", "sys_futex_requeue"},
 };
 
+constexpr int SYSCALL_NUMBER_COUNT = 457;
+
+constexpr const char* syscallNames[SYSCALL_NUMBER_COUNT] = {
+    "read",
+    "write",
+    "open",
+    "close",
+    "stat",
+    "fstat",
+    "lstat",
+    "poll",
+    "lseek",
+    "mmap",
+    "mprotect",
+    "munmap",
+    "brk",
+    "rt_sigaction",
+    "rt_sigprocmask",
+    "rt_sigreturn",
+    "ioctl",
+    "pread64",
+    "pwrite64",
+    "readv",
+    "writev",
+    "access",
+    "pipe",
+    "select",
+    "sched_yield",
+    "mremap",
+    "msync",
+    "mincore",
+    "madvise",
+    "shmget",
+    "shmat",
+    "shmctl",
+    "dup",
+    "dup2",
+    "pause",
+    "nanosleep",
+    "getitimer",
+    "alarm",
+    "setitimer",
+    "getpid",
+    "sendfile",
+    "socket",
+    "connect",
+    "accept",
+    "sendto",
+    "recvfrom",
+    "sendmsg",
+    "recvmsg",
+    "shutdown",
+    "bind",
+    "listen",
+    "getsockname",
+    "getpeername",
+    "socketpair",
+    "setsockopt",
+    "getsockopt",
+    "clone",
+    "fork",
+    "vfork",
+    "execve",
+    "exit",
+    "wait4",
+    "kill",
+    "uname",
+    "semget",
+    "semop",
+    "semctl",
+    "shmdt",
+    "msgget",
+    "msgsnd",
+    "msgrcv",
+    "msgctl",
+    "fcntl",
+    "flock",
+    "fsync",
+    "fdatasync",
+    "truncate",
+    "ftruncate",
+    "getdents",
+    "getcwd",
+    "chdir",
+    "fchdir",
+    "rename",
+    "mkdir",
+    "rmdir",
+    "creat",
+    "link",
+    "unlink",
+    "symlink",
+    "readlink",
+    "chmod",
+    "fchmod",
+    "chown",
+    "fchown",
+    "lchown",
+    "umask",
+    "gettimeofday",
+    "getrlimit",
+    "getrusage",
+    "sysinfo",
+    "times",
+    "ptrace",
+    "getuid",
+    "syslog",
+    "getgid",
+    "setuid",
+    "setgid",
+    "geteuid",
+    "getegid",
+    "setpgid",
+    "getppid",
+    "getpgrp",
+    "setsid",
+    "setreuid",
+    "setregid",
+    "getgroups",
+    "setgroups",
+    "setresuid",
+    "getresuid",
+    "setresgid",
+    "getresgid",
+    "getpgid",
+    "setfsuid",
+    "setfsgid",
+    "getsid",
+    "capget",
+    "capset",
+    "rt_sigpending",
+    "rt_sigtimedwait",
+    "rt_sigqueueinfo",
+    "rt_sigsuspend",
+    "sigaltstack",
+    "utime",
+    "mknod",
+    nullptr,
+    "personality",
+    "ustat",
+    "statfs",
+    "fstatfs",
+    "sysfs",
+    "getpriority",
+    "setpriority",
+    "sched_setparam",
+    "sched_getparam",
+    "sched_setscheduler",
+    "sched_getscheduler",
+    "sched_get_priority_max",
+    "sched_get_priority_min",
+    "sched_rr_get_interval",
+    "mlock",
+    "munlock",
+    "mlockall",
+    "munlockall",
+    "vhangup",
+    "modify_ldt",
+    "pivot_root",
+    "_sysctl",
+    "prctl",
+    "arch_prctl",
+    "adjtimex",
+    "setrlimit",
+    "chroot",
+    "sync",
+    "acct",
+    "settimeofday",
+    "mount",
+    "umount2",
+    "swapon",
+    "swapoff",
+    "reboot",
+    "sethostname",
+    "setdomainname",
+    "iopl",
+    "ioperm",
+    nullptr,
+    "init_module",
+    "delete_module",
+    nullptr,
+    nullptr,
+    "quotactl",
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    "gettid",
+    "readahead",
+    "setxattr",
+    "lsetxattr",
+    "fsetxattr",
+    "getxattr",
+    "lgetxattr",
+    "fgetxattr",
+    "listxattr",
+    "llistxattr",
+    "flistxattr",
+    "removexattr",
+    "lremovexattr",
+    "fremovexattr",
+    "tkill",
+    "time",
+    "futex",
+    "sched_setaffinity",
+    "sched_getaffinity",
+    nullptr,
+    "io_setup",
+    "io_destroy",
+    "io_getevents",
+    "io_submit",
+    "io_cancel",
+    nullptr,
+    nullptr,
+    "epoll_create",
+    nullptr,
+    nullptr,
+    "remap_file_pages",
+    "getdents64",
+    "set_tid_address",
+    "restart_syscall",
+    "semtimedop",
+    "fadvise64",
+    "timer_create",
+    "timer_settime",
+    "timer_gettime",
+    "timer_getoverrun",
+    "timer_delete",
+    "clock_settime",
+    "clock_gettime",
+    "clock_getres",
+    "clock_nanosleep",
+    "exit_group",
+    "epoll_wait",
+    "epoll_ctl",
+    "tgkill",
+    "utimes",
+    nullptr,
+    "mbind",
+    "set_mempolicy",
+    "get_mempolicy",
+    "mq_open",
+    "mq_unlink",
+    "mq_timedsend",
+    "mq_timedreceive",
+    "mq_notify",
+    "mq_getsetattr",
+    "kexec_load",
+    "waitid",
+    "add_key",
+    "request_key",
+    "keyctl",
+    "ioprio_set",
+    "ioprio_get",
+    "inotify_init",
+    "inotify_add_watch",
+    "inotify_rm_watch",
+    "migrate_pages",
+    "openat",
+    "mkdirat",
+    "mknodat",
+    "fchownat",
+    "futimesat",
+    "newfstatat",
+    "unlinkat",
+    "renameat",
+    "linkat",
+    "symlinkat",
+    "readlinkat",
+    "fchmodat",
+    "faccessat",
+    "pselect6",
+    "ppoll",
+    "unshare",
+    "set_robust_list",
+    "get_robust_list",
+    "splice",
+    "tee",
+    "sync_file_range",
+    "vmsplice",
+    "move_pages",
+    "utimensat",
+    "epoll_pwait",
+    "signalfd",
+    "timerfd_create",
+    "eventfd",
+    "fallocate",
+    "timerfd_settime",
+    "timerfd_gettime",
+    "accept4",
+    "signalfd4",
+    "eventfd2",
+    "epoll_create1",
+    "dup3",
+    "pipe2",
+    "inotify_init1",
+    "preadv",
+    "pwritev",
+    "rt_tgsigqueueinfo",
+    "perf_event_open",
+    "recvmmsg",
+    "fanotify_init",
+    "fanotify_mark",
+    "prlimit64",
+    "name_to_handle_at",
+    "open_by_handle_at",
+    "clock_adjtime",
+    "syncfs",
+    "sendmmsg",
+    "setns",
+    "getcpu",
+    "process_vm_readv",
+    "process_vm_writev",
+    "kcmp",
+    "finit_module",
+    "sched_setattr",
+    "sched_getattr",
+    "renameat2",
+    "seccomp",
+    "getrandom",
+    "memfd_create",
+    "kexec_file_load",
+    "bpf",
+    "execveat",
+    "userfaultfd",
+    "membarrier",
+    "mlock2",
+    "copy_file_range",
+    "preadv2",
+    "pwritev2",
+    "pkey_mprotect",
+    "pkey_alloc",
+    "pkey_free",
+    "statx",
+    "io_pgetevents",
+    "rseq",
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    "pidfd_send_signal",
+    "io_uring_setup",
+    "io_uring_enter",
+    "io_uring_register",
+    "open_tree",
+    "move_mount",
+    "fsopen",
+    "fsconfig",
+    "fsmount",
+    "fspick",
+    "pidfd_open",
+    "clone3",
+    "close_range",
+    "openat2",
+    "pidfd_getfd",
+    "faccessat2",
+    "process_madvise",
+    "epoll_pwait2",
+    "mount_setattr",
+    "quotactl_fd",
+    "landlock_create_ruleset",
+    "landlock_add_rule",
+    "landlock_restrict_self",
+    "memfd_secret",
+    "process_mrelease",
+    "futex_waitv",
+    "set_mempolicy_home_node",
+    "cachestat",
+    "fchmodat2",
+    "map_shadow_stack",
+    "futex_wake",
+    "futex_wait",
+    "futex_requeue",
+};
+
+constexpr uint32_t SYSCALL_HASH_SEEDS = 128;
+
+constexpr uint16_t syscallHashSeeds[SYSCALL_HASH_SEEDS] = {
+    3, 1, 3, 4, 10, 10, 4, 1, 4, 12, 1, 3, 2, 7, 1, 2,
+    3, 1, 12, 1, 3, 0, 0, 1, 1, 5, 5, 9, 5, 1, 6, 1,
+    4, 5, 1, 1, 6, 13, 9, 3, 5, 5, 5, 3, 3, 1, 4, 3,
+    5, 1, 4, 4, 1, 4, 3, 2, 3, 3, 9, 7, 1, 8, 7, 5,
+    3, 2, 3, 3, 5, 3, 1, 1, 1, 26, 20, 4, 9, 2, 4, 10,
+    0, 1, 4, 3, 1, 2, 5, 2, 3, 8, 14, 4, 2, 6, 2, 1,
+    8, 9, 3, 8, 8, 1, 3, 2, 0, 5, 2, 1, 7, 8, 1, 0,
+    4, 2, 2, 0, 2, 10, 2, 0, 1, 1, 7, 0, 1, 1, 15, 3,
+};
+
+constexpr uint32_t SYSCALL_HASH_SLOTS = 512;
+
+constexpr int16_t syscallHashSlots[SYSCALL_HASH_SLOTS] = {
+    425, 187, 267, -1, -1, 32, 207, -1, 117, 450, -1, -1, -1, 78, 26, 240,
+    -1, 219, 108, 166, 118, -1, -1, 50, -1, -1, -1, -1, 93, -1, 234, -1,
+    82, -1, 51, -1, 299, 221, 198, 284, 152, 312, -1, 302, -1, -1, 305, 168,
+    449, 145, -1, 148, -1, -1, -1, -1, 239, -1, 28, -1, 222, 126, -1, -1,
+    71, 193, -1, 75, 261, 83, 438, -1, -1, -1, 1, 41, 84, -1, 272, 60,
+    -1, 298, 186, 311, 333, -1, -1, -1, 428, 315, 102, -1, 154, 79, -1, 223,
+    -1, 429, -1, 2, -1, 308, 65, 318, 94, 165, 121, -1, 252, -1, 36, 27,
+    115, 159, -1, 156, -1, 427, 80, 25, 146, 441, 282, 228, 432, 246, 0, -1,
+    -1, 294, 289, 107, 231, 45, 225, 12, -1, -1, 67, 224, 201, 33, 90, 274,
+    453, -1, 230, 323, -1, -1, 265, -1, 14, -1, 309, 216, 18, 144, 435, 125,
+    20, 91, 141, 56, 89, -1, 317, 48, 127, -1, -1, 210, 142, 287, 87, 439,
+    130, -1, -1, 6, -1, 220, -1, 5, 209, 31, 266, 162, 30, -1, 191, -1,
+    -1, 103, -1, -1, 81, -1, 4, 151, 158, 202, 256, -1, 15, -1, 259, -1,
+    16, 55, -1, -1, 38, 46, -1, 77, 313, -1, -1, 160, -1, 227, 306, 275,
+    -1, -1, 245, 437, -1, 280, 120, 163, 63, -1, 9, 195, 424, 444, 213, 104,
+    247, -1, -1, 314, 47, 164, 301, -1, 37, 155, 42, 171, 23, 249, -1, 101,
+    11, 190, -1, -1, 113, -1, -1, 328, 124, -1, 238, -1, 57, -1, -1, 307,
+    250, 327, -1, 129, 69, 283, 35, 197, 300, 440, 109, 268, -1, 194, 132, 131,
+    -1, -1, 133, 153, 72, 248, 448, 258, -1, 310, 204, 136, 167, 76, 326, 128,
+    -1, -1, 331, 150, -1, -1, 175, 455, 242, 244, -1, 122, 58, 54, 254, -1,
+    -1, 278, -1, 297, -1, 64, -1, 29, 285, 189, 255, -1, -1, 218, 442, 208,
+    44, 273, 251, 196, 192, 99, 140, 321, 43, -1, 49, 138, 106, -1, 21, 110,
+    291, 66, 92, -1, 320, 264, 206, 217, 277, -1, -1, 39, 257, 123, -1, -1,
+    86, 436, 295, 445, 443, -1, 304, 95, 22, 430, 139, 271, 143, 188, 293, 232,
+    62, 24, -1, -1, 34, 332, -1, 53, -1, 281, 119, 276, -1, 260, -1, 452,
+    200, 114, 111, 330, 447, -1, -1, -1, 3, 97, -1, 286, 40, 105, 112, 52,
+    324, 253, 325, -1, 270, 290, -1, 116, 59, 85, 235, 426, 319, 199, 226, 203,
+    135, 149, -1, -1, -1, 10, -1, 7, 434, -1, -1, 334, -1, 137, 262, 303,
+    -1, 296, 433, -1, 269, -1, 279, 169, -1, 161, -1, -1, 431, -1, -1, 88,
+    -1, 100, -1, 243, 96, -1, 173, 13, -1, -1, 329, 74, -1, 237, 456, 68,
+    446, 98, -1, 316, 70, 229, 288, -1, -1, 147, 170, -1, 172, -1, -1, 19,
+    8, 451, 176, 61, 241, 454, 322, 17, -1, 233, -1, 157, 73, 292, 263, 179,
+};
+
+constexpr uint32_t SyscallNameHash(std::string_view name, uint32_t seed)
+{
+    uint32_t hash = 2166136261u ^ seed;
+    for (char c : name)
+    {
+        hash = (hash ^ (uint8_t)c) * 16777619u;
+    }
+    return hash;
+}
+
+// Name of a syscall number, nullptr if there isn't one
+constexpr const char* SyscallNameForNumber(int number)
+{
+    return number >= 0 && number < SYSCALL_NUMBER_COUNT ? syscallNames[number] : nullptr;
+}
+
+// Number of a syscall name, -1 if there isn't one
+constexpr int SyscallNumberForName(std::string_view name)
+{
+    uint32_t seed = syscallHashSeeds[SyscallNameHash(name, 0) % SYSCALL_HASH_SEEDS];
+    int number = syscallHashSlots[SyscallNameHash(name, seed) % SYSCALL_HASH_SLOTS];
+    return number >= 0 && name == syscallNames[number] ? number : -1;
+}
+
+static_assert(SyscallNumberForName("read") == 0);
+static_assert(SyscallNumberForName("futex_requeue") == 456);
+
 #endif // SYSCALL_H
@@ -0,0 +1,176 @@
+/*
+    Procmon-for-Linux
+
+    Copyright (c) Microsoft Corporation
+
+    All rights reserved.
+
+    MIT License
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "ring_buffer_reader.h"
+
+// easylogging's CHECK would replace Catch's
+#define ELPP_NO_CHECK_MACROS
+#include "../../logging/easylogging++.h"
+
+INITIALIZE_EASYLOGGINGPP
+
+#define BUSY_BIT    (1U << 31)
+#define DISCARD_BIT (1U << 30)
+
+//
+// Stands in for a BPF_MAP_TYPE_RINGBUF map with a memfd laid out the
+// way the kernel maps the ring: the consumer page, the producer page,
+// then the data pages twice. The kernel maps the same data pages twice,
+// here each byte is written to both copies instead.
+//
+class FakeRingBuffer
+{
+private:
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    uint8_t* file = nullptr;
+    size_t fileSize = 0;
+
+    uint64_t* consumerPos() { return reinterpret_cast<uint64_t*>(file); }
+    uint64_t* producerPos() { return reinterpret_cast<uint64_t*>(file + pageSize); }
+
+    void WriteData(uint64_t position, const void* bytes, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            uint64_t offset = (position + i) & (ringSize - 1);
+            data[offset] = data[offset + ringSize] = static_cast<const uint8_t*>(bytes)[i];
+        }
+    }
+
+public:
+    int fd = -1;
+    size_t ringSize;
+    uint8_t* data = nullptr;
+
+    explicit FakeRingBuffer(size_t size) : ringSize(size)
+    {
+        fd = memfd_create("ringbuf", MFD_CLOEXEC);
+        fileSize = 2 * pageSize + 2 * ringSize;
+        REQUIRE(ftruncate(fd, fileSize) == 0);
+        file = static_cast<uint8_t*>(mmap(NULL, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+        REQUIRE(file != MAP_FAILED);
+        data = file + 2 * pageSize;
+    }
+
+    ~FakeRingBuffer()
+    {
+        munmap(file, fileSize);
+        close(fd);
+    }
+
+    uint64_t Consumed() { return *consumerPos(); }
+
+    // Reserves a record at the producer position and returns where it starts
+    uint64_t Reserve(const std::string& text, uint32_t flags = BUSY_BIT)
+    {
+        uint64_t position = *producerPos();
+        uint32_t header[2] = {static_cast<uint32_t>(text.size()) | flags, 0};
+        WriteData(position, header, sizeof(header));
+        WriteData(position + sizeof(header), text.data(), text.size());
+        *producerPos() = position + ((sizeof(header) + text.size() + 7) & ~7ULL);
+        return position;
+    }
+
+    void Commit(uint64_t position, uint32_t flags = 0)
+    {
+        uint32_t header;
+        memcpy(&header, &data[position & (ringSize - 1)], sizeof(header));
+        header = (header & ~(BUSY_BIT | DISCARD_BIT)) | flags;
+        WriteData(position, &header, sizeof(header));
+    }
+
+    void Write(const std::string& text) { Commit(Reserve(text)); }
+
+    // Moves both positions, as if that much had been written and read
+    void Skip(uint64_t bytes)
+    {
+        *producerPos() += bytes;
+        *consumerPos() += bytes;
+    }
+};
+
+static void CollectRecord(void *cbCookie, void *data, uint32_t size)
+{
+    static_cast<std::vector<std::string>*>(cbCookie)->emplace_back(static_cast<char*>(data), size);
+}
+
+TEST_CASE("ring buffer reader consumes committed records", "[RingBufferReader]") {
+
+    FakeRingBuffer ring(4096);
+    std::vector<std::string> records;
+    RingBufferReader reader;
+    REQUIRE(reader.Map(ring.fd, ring.ringSize, CollectRecord, &records));
+
+    SECTION("Records come back in order and free up their space") {
+        ring.Write("first");
+        ring.Write("");
+        ring.Write("the third one");
+
+        CHECK(reader.Consume() == 3);
+        CHECK(records == std::vector<std::string>({"first", "", "the third one"}));
+        CHECK(ring.Consumed() == 16 + 8 + 24);
+
+        CHECK(reader.Consume() == 0);
+        ring.Write("later");
+        CHECK(reader.Consume() == 1);
+        CHECK(records.back() == "later");
+    }
+
+    SECTION("Discarded records are skipped") {
+        ring.Write("kept");
+        ring.Commit(ring.Reserve("dropped"), DISCARD_BIT);
+        ring.Write("kept too");
+
+        CHECK(reader.Consume() == 2);
+        CHECK(records == std::vector<std::string>({"kept", "kept too"}));
+        CHECK(ring.Consumed() == 16 + 16 + 16);
+    }
+
+    SECTION("A record still being written holds back the ones after it") {
+        ring.Write("before");
+        uint64_t busy = ring.Reserve("busy");
+        ring.Write("after");
+
+        CHECK(reader.Consume() == 1);
+        CHECK(records == std::vector<std::string>({"before"}));
+        CHECK(ring.Consumed() == busy);
+
+        ring.Commit(busy);
+        CHECK(reader.Consume() == 2);
+        CHECK(records == std::vector<std::string>({"before", "busy", "after"}));
+    }
+
+    SECTION("A record wrapping around the end is read in one piece") {
+        ring.Skip(ring.ringSize - 16);
+        std::string wrapping = "this record goes past the end of the ring";
+        ring.Write(wrapping);
+        ring.Write("next");
+
+        CHECK(reader.Consume() == 2);
+        CHECK(records == std::vector<std::string>({wrapping, "next"}));
+        CHECK(ring.Consumed() == ring.ringSize - 16 + 56 + 16);
+    }
+}
@@ -20,10 +20,136 @@
 #include <functional>
 #include <memory>
 #include <map>
+#include <string>
+#include <vector>
 
 #include "../common/event.h"
 #include "../storage/storage_engine.h"
 
+// Options controlling what the tracer collects
+struct TracerOptions
+{
+    // Automatically trace children forked by the traced pids
+    bool followChildren = false;
+
+    // Send a stack id per event and look the frames up once per unique stack
+    bool stackIds = false;
+
+    // Also capture the kernel stack a syscall blocked in
+    bool kernelStacks = false;
+
+    // Aggregate per (pid, syscall) in the kernel instead of sending events
+    bool summary = false;
+
+    // Only send syscalls that took at least this long
+    uint64_t minDurationNs = 0;
+
+    // Only send syscalls that failed
+    bool errorsOnly = false;
+
+    // Only send syscalls that failed with one of these errno values
+    std::vector<int> errnos;
+
+    // 1 in N sample rate per syscall name
+    std::map<std::string, uint32_t> sampleRates;
+
+    // Per CPU budget of events per second, 0 for unlimited
+    uint64_t rateLimit = 0;
+
+    // Bytes of each string argument such as a path to capture in full, 0 for only the preview
+    uint32_t maxStringLength = 4096;
+
+    // Bytes of the data buffers of read and write like syscalls to capture, 0 for none
+    uint32_t snaplenRead = 0;
+    uint32_t snaplenWrite = 0;
+
+    // Per CPU budget of captured data buffer bytes per second, 0 for unlimited
+    uint64_t payloadBudget = 1024 * 1024;
+
+    // Threads decoding events, each fed by the events of a subset of the CPUs
+    uint32_t decoders = 1;
+};
+
+// Counters of events the tracer chose not to send
+struct TracerStats
+{
+    // Dropped by per syscall sampling
+    uint64_t sampledOut = 0;
+
+    // Dropped by the rate governor
+    uint64_t throttled = 0;
+
+    // Dropped because the in flight table was full
+    uint64_t inFlightFailed = 0;
+
+    // Data buffers left out of events once the payload budget ran out
+    uint64_t payloadDropped = 0;
+
+    // Lost because userland didn't keep up, in total and per CPU
+    uint64_t lost = 0;
+    std::vector<uint64_t> lostPerCpu;
+
+    // Nanoseconds spent decoding, merging the decoders' batches and storing
+    uint64_t decodeNs = 0;
+    uint64_t mergeNs = 0;
+    uint64_t storeNs = 0;
+
+    // Nanoseconds decoding waited for the writer to free up a batch
+    uint64_t writeWaitNs = 0;
+};
+
+// Operators are warned once more than this percentage of events is lost
+#define LOST_EVENTS_WARNING_PERCENT 1
+
+// True when lost events make up more than LOST_EVENTS_WARNING_PERCENT of all events
+inline bool LossRateExceeded(uint64_t lost, uint64_t captured)
+{
+    return lost * 100 > (lost + captured) * LOST_EVENTS_WARNING_PERCENT;
+}
+
+// Aggregate for one (pid, syscall) collected in summary mode
+struct SyscallSummary
+{
+    int pid = 0;
+    std::string syscall;
+    uint64_t count = 0;
+    uint64_t errors = 0;
+    uint64_t totalDuration = 0;
+
+    // log2 buckets of the duration in microseconds
+    std::vector<uint64_t> histogram;
+
+    // Upper bound in microseconds of the bucket holding the given percentile
+    uint64_t PercentileUs(double percentile) const
+    {
+        uint64_t target = (uint64_t)(count * percentile / 100.0);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < histogram.size(); i++)
+        {
+            seen += histogram[i];
+            if (seen > target || seen == count)
+            {
+                return 2ULL << i;
+            }
+        }
+
+        return 0;
+    }
+};
+
+// A syscall a thread has entered but not yet returned from
+struct BlockedSyscall
+{
+    int pid = 0;
+    int tid = 0;
+    std::string comm;
+    std::string syscall;
+    std::string arguments;
+
+    // Time spent in the syscall so far
+    uint64_t blockedNs = 0;
+};
+
 class ITracerEngine
 {
 protected:
@@ -42,12 +168,21 @@ public:
     virtual void AddEvent(std::vector<Event> eventsToTrace) {};
 
     virtual void AddPids(std::vector<int> pidsToTrace) {};
+    virtual void RemovePids(std::vector<int> pidsToRemove) {};
 
     virtual void RemoveEvent(Event eventToRemove) {};
     virtual void RemoveEvent(std::vector<Event> eventsToRemove) {};
     virtual void SetRunState(int runState) { RunState = runState; }
     virtual int GetRunState() { return RunState; }
     virtual void Cancel() {}
+
+    // Per (pid, syscall) aggregates, sorted by count. Empty unless in summary mode
+    virtual std::vector<SyscallSummary> GetSummary() { return {}; }
+
+    virtual TracerStats GetStats() { return {}; }
+
+    // Syscalls currently in flight, longest blocked first
+    virtual std::vector<BlockedSyscall> GetBlockedSyscalls() { return {}; }
 };
 
 #endif // TRACER_ENGINE_H
\ No newline at end of file